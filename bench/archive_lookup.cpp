@@ -0,0 +1,111 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Path lookups per second in a synthetic PSARC with many entries, straight against the archive's
+// name table (Psarc::FindFile) and through sceFiosFileExistsSync, which adds the merged mount
+// index and the op bookkeeping. Also prints how far entries sit from their home slot, which is
+// what a lookup pays beyond the one digest compare.
+//
+// Usage: archive_lookup [entries, default 100000] [lookups, default 1000000]
+// Built by `make host` as build/host/bench/archive_lookup; the archive is created in $FIOS2_APP0
+// (default /tmp).
+
+#include "fios2.h"
+#include "psarc.h"
+#include "psarc_writer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include <orbis/libkernel.h>
+
+using namespace Fios2;
+using namespace Fios2::Test;
+
+// Spread over a few hundred directories, like a game's asset tree.
+static std::string EntryName(u32 i) {
+    return "data/level" + std::to_string(i % 64) + "/pack" + std::to_string(i % 397) + "/asset" +
+           std::to_string(i) + ".bin";
+}
+
+template <typename Fn>
+static void Time(const char* name, u64 lookups, Fn&& fn) {
+    const auto start = std::chrono::steady_clock::now();
+    u64 found = 0;
+    for (u64 i = 0; i < lookups; ++i) {
+        found += fn(i);
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    std::printf("%-28s %12.0f lookups/s %8.1f ns/lookup (%llu found)\n", name, lookups / seconds,
+                seconds * 1e9 / lookups, static_cast<unsigned long long>(found));
+}
+
+int main(int argc, char** argv) {
+    const u32 num_entries = argc > 1 ? std::strtoul(argv[1], nullptr, 0) : 100000;
+    const u64 lookups = argc > 2 ? std::strtoull(argv[2], nullptr, 0) : 1000000;
+    if (!std::getenv("FIOS2_APP0")) {
+        setenv("FIOS2_APP0", "/tmp", 1);
+    }
+    const std::string app0 = std::getenv("FIOS2_APP0");
+    std::vector<FixtureFile> files(num_entries);
+    for (u32 i = 0; i < num_entries; ++i) {
+        files[i].name = EntryName(i);
+    }
+    WritePsarc(app0 + "/lookup_bench.psarc", files, 64_KB, 0);
+
+    std::vector<std::string> hits(4096), misses(4096);
+    for (u32 i = 0; i < hits.size(); ++i) {
+        const u32 index = static_cast<u32>((i * 2654435761ull) % num_entries);
+        hits[i] = "/app0/lookup/" + EntryName(index);
+        misses[i] = "/app0/lookup/" + EntryName(index) + ".missing";
+    }
+
+    // The archive's own name table.
+    const s64 index_size = Psarc::GetIndexSize("/app0/lookup_bench.psarc");
+    Psarc::Archive* archive = nullptr;
+    if (Psarc::Mount("/app0/lookup_bench.psarc", "/app0/lookup", &archive) != ORBIS_OK) {
+        std::printf("mount failed\n");
+        return 1;
+    }
+    const u32 mask = archive->num_slots - 1;
+    u64 used = 0, total_distance = 0, max_distance = 0;
+    for (u32 i = 0; i < archive->num_slots; ++i) {
+        const Psarc::NameSlot& slot = archive->slots[i];
+        if (slot.digest != u128{}) {
+            const u64 distance = (i - static_cast<u32>(slot.digest[0])) & mask;
+            ++used;
+            total_distance += distance;
+            max_distance = std::max(max_distance, distance);
+        }
+    }
+    std::printf("%u entries, %llu names in %u slots, %.1f MB index, probe distance avg %.2f max "
+                "%llu\n",
+                num_entries, static_cast<unsigned long long>(used), archive->num_slots,
+                index_size / double(1_MB), total_distance / double(used),
+                static_cast<unsigned long long>(max_distance));
+    Time("Psarc::FindFile hit", lookups,
+         [&](u64 i) { return Psarc::FindFile(*archive, hits[i % hits.size()]) >= 0; });
+    Time("Psarc::FindFile miss", lookups,
+         [&](u64 i) { return Psarc::FindFile(*archive, misses[i % misses.size()]) >= 0; });
+    Psarc::Close(archive);
+
+    // The same lookups through the public API.
+    std::vector<u8> mount_buffer(index_size > 0 ? index_size : 0);
+    OrbisFiosFH fh = -1;
+    sceFiosArchiveMountSync(nullptr, &fh, "/app0/lookup_bench.psarc", "/app0/lookup",
+                            {mount_buffer.data(), mount_buffer.size()}, nullptr);
+    Time("sceFiosFileExistsSync hit", lookups / 10,
+         [&](u64 i) { return sceFiosFileExistsSync(nullptr, hits[i % hits.size()].c_str()); });
+    Time("sceFiosFileExistsSync miss", lookups / 10,
+         [&](u64 i) { return sceFiosFileExistsSync(nullptr, misses[i % misses.size()].c_str()); });
+    sceFiosArchiveUnmountSync(nullptr, fh);
+
+    unlink((app0 + "/lookup_bench.psarc").c_str());
+    return 0;
+}
@@ -0,0 +1,123 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Decompression throughput versus sceFiosArchiveSetDecompressorThreadCount: one large file in a
+// zlib and an LZMA PSARC, read front to back in 4 MB sceFiosFHPreadSync calls at 1, 2, 4 and 8
+// threads. The archive stays in the host page cache, so this measures decompression, not disk.
+// Then the same file in 64 KB sceFiosFHReadSync calls, on demand and through a handle stream.
+//
+// Usage: decompress [file size in MB, default 64]
+// Built by `make host` as build/host/bench/decompress; archives are created in $FIOS2_APP0 (default
+// /tmp).
+
+#include "config.h"
+#include "fios2.h"
+#include "psarc_writer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include <orbis/libkernel.h>
+
+using namespace Fios2;
+using namespace Fios2::Test;
+
+constexpr u64 READ_SIZE = 4_MB;
+constexpr u64 SMALL_READ_SIZE = 64_KB;
+constexpr u32 BLOCK_SIZE = 64_KB;
+
+// Compresses to roughly a third, about what game assets do.
+static std::vector<u8> MakeAssetData(u64 size) {
+    std::vector<u8> data(size);
+    u32 state = 1;
+    for (u64 i = 0; i < size; ++i) {
+        state = state * 1103515245u + 12345u;
+        data[i] = (state >> 16) % 3 == 0 ? static_cast<u8>(state >> 24) : static_cast<u8>(i / 16);
+    }
+    return data;
+}
+
+static void Run(const char* name, const char* path, u64 size) {
+    std::vector<u8> buf(READ_SIZE);
+    for (s32 threads : {1, 2, 4, 8}) {
+        sceFiosArchiveSetDecompressorThreadCount(threads);
+        OrbisFiosFH fh = -1;
+        sceFiosFHOpenSync(nullptr, &fh, path, nullptr);
+        const auto start = std::chrono::steady_clock::now();
+        u64 total = 0;
+        while (total < size) {
+            OrbisFiosSize ret = sceFiosFHPreadSync(nullptr, fh, buf.data(), READ_SIZE, total);
+            if (ret <= 0) {
+                break;
+            }
+            total += ret;
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        sceFiosFHCloseSync(nullptr, fh);
+
+        const double seconds = std::chrono::duration<double>(elapsed).count();
+        std::printf("%-5s %d thread%s %8.1f MB/s\n", name, threads, threads == 1 ? " " : "s",
+                    total / seconds / 1_MB);
+    }
+}
+
+// Small sequential reads, where each block used to be read and decompressed while the game waited.
+static void RunSmallReads(const char* name, const char* path, u64 size) {
+    std::vector<u8> buf(SMALL_READ_SIZE);
+    for (u64 stream_blocks : {0, 8}) {
+        Config::Get().stream_blocks = stream_blocks;
+        OrbisFiosFH fh = -1;
+        sceFiosFHOpenSync(nullptr, &fh, path, nullptr);
+        const auto start = std::chrono::steady_clock::now();
+        u64 total = 0;
+        while (total < size) {
+            OrbisFiosSize ret = sceFiosFHReadSync(nullptr, fh, buf.data(), SMALL_READ_SIZE);
+            if (ret <= 0) {
+                break;
+            }
+            total += ret;
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        sceFiosFHCloseSync(nullptr, fh);
+
+        const double seconds = std::chrono::duration<double>(elapsed).count();
+        std::printf("%-5s %s %8.1f MB/s\n", name, stream_blocks ? "stream   " : "on demand",
+                    total / seconds / 1_MB);
+    }
+}
+
+int main(int argc, char** argv) {
+    const u64 size = (argc > 1 ? std::strtoull(argv[1], nullptr, 0) : 64) * 1_MB;
+    if (!std::getenv("FIOS2_APP0")) {
+        setenv("FIOS2_APP0", "/tmp", 1);
+    }
+    const std::string app0 = std::getenv("FIOS2_APP0");
+    const std::vector<FixtureFile> files = {{"asset.bin", MakeAssetData(size)}};
+    WritePsarc(app0 + "/decompress_bench_zlib.psarc", files, BLOCK_SIZE, 0, false);
+    WritePsarc(app0 + "/decompress_bench_lzma.psarc", files, BLOCK_SIZE, 0, true);
+
+    std::vector<u8> mount_buffer(1_MB);
+    OrbisFiosFH zlib_fh = -1, lzma_fh = -1;
+    sceFiosArchiveMountSync(nullptr, &zlib_fh, "/app0/decompress_bench_zlib.psarc", "/app0/zlib",
+                            {mount_buffer.data(), mount_buffer.size() / 2}, nullptr);
+    sceFiosArchiveMountSync(nullptr, &lzma_fh, "/app0/decompress_bench_lzma.psarc", "/app0/lzma",
+                            {mount_buffer.data() + mount_buffer.size() / 2,
+                             mount_buffer.size() / 2},
+                            nullptr);
+
+    std::printf("%llu MB file, %llu KB blocks, %llu MB reads, %ld CPUs\n", size / 1_MB,
+                BLOCK_SIZE / 1_KB, READ_SIZE / 1_MB, sysconf(_SC_NPROCESSORS_ONLN));
+    Run("zlib", "/app0/zlib/asset.bin", size);
+    Run("lzma", "/app0/lzma/asset.bin", size);
+    sceFiosArchiveSetDecompressorThreadCount(1);
+    RunSmallReads("zlib", "/app0/zlib/asset.bin", size);
+    RunSmallReads("lzma", "/app0/lzma/asset.bin", size);
+
+    unlink((app0 + "/decompress_bench_zlib.psarc").c_str());
+    unlink((app0 + "/decompress_bench_lzma.psarc").c_str());
+    return 0;
+}
@@ -0,0 +1,289 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Cost of the sceFios* entry points games call most: each benchmark runs one call (or an async
+// call and its sceFiosOpWait and sceFiosOpDelete) in a loop on 1, 2, 4, 8 and 16 threads for a
+// fixed time, against a generated tree of small files and one large one, and reports throughput
+// and latency percentiles. Everything stays in the host page cache, so this measures the library,
+// not the disk.
+//
+// Output is CSV, one row per benchmark and thread count, to diff between builds:
+//   benchmark,threads,ops,ops_per_sec,mean_us,p50_us,p90_us,p99_us,max_us
+//
+// Usage: fios_calls [-t max threads, default 16] [-d seconds per run, default 0.5] [filter]
+//   filter  only run benchmarks whose name contains it
+// Built by `make host` as build/host/bench/fios_calls; the tree is created in $FIOS2_APP0 (default
+// /tmp).
+
+#include "fios2.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <orbis/libkernel.h>
+
+using namespace Fios2;
+using Clock = std::chrono::steady_clock;
+
+constexpr u32 NUM_DIRS = 16;
+constexpr u32 FILES_PER_DIR = 64;
+constexpr u64 SMALL_FILE_SIZE = 4_KB;
+constexpr u64 LARGE_FILE_SIZE = 64_MB;
+constexpr u32 READV_BUFFERS = 4;
+constexpr u64 READV_BUFFER_SIZE = 16_KB;
+
+// Per-thread state a benchmark's call works on.
+struct Context {
+    u32 rng;
+    OrbisFiosFH fh = -1; // the large file, opened for each thread
+    std::vector<u8> buffer;
+
+    u32 Random() {
+        rng = rng * 1103515245u + 12345u;
+        return rng >> 8;
+    }
+};
+
+struct Benchmark {
+    std::string name;
+    std::function<void(Context&)> call;
+    u64 buffer_size = 0; // of Context::buffer
+};
+
+static std::string SmallPath(u32 index) {
+    return "/app0/fios_bench/dir" + std::to_string(index / FILES_PER_DIR % NUM_DIRS) + "/file" +
+           std::to_string(index % FILES_PER_DIR) + ".bin";
+}
+
+static void CreateTree(const std::string& root) {
+    mkdir(root.c_str(), 0755);
+    std::vector<u8> data(LARGE_FILE_SIZE);
+    for (u64 i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<u8>(i * 31 + 7);
+    }
+    for (u32 dir = 0; dir < NUM_DIRS; ++dir) {
+        const std::string dir_path = root + "/dir" + std::to_string(dir);
+        mkdir(dir_path.c_str(), 0755);
+        for (u32 file = 0; file < FILES_PER_DIR; ++file) {
+            const std::string path = dir_path + "/file" + std::to_string(file) + ".bin";
+            FILE* f = std::fopen(path.c_str(), "wb");
+            std::fwrite(data.data(), 1, SMALL_FILE_SIZE, f);
+            std::fclose(f);
+        }
+    }
+    FILE* f = std::fopen((root + "/large.bin").c_str(), "wb");
+    std::fwrite(data.data(), 1, data.size(), f);
+    std::fclose(f);
+}
+
+static void RemoveTree(const std::string& root) {
+    for (u32 dir = 0; dir < NUM_DIRS; ++dir) {
+        const std::string dir_path = root + "/dir" + std::to_string(dir);
+        for (u32 file = 0; file < FILES_PER_DIR; ++file) {
+            unlink((dir_path + "/file" + std::to_string(file) + ".bin").c_str());
+        }
+        rmdir(dir_path.c_str());
+    }
+    unlink((root + "/large.bin").c_str());
+    rmdir(root.c_str());
+}
+
+// The small file paths, built up front so building them isn't timed.
+static std::vector<std::string> small_paths;
+static std::vector<std::string> missing_paths;
+
+static const char* SmallFile(Context& ctx) {
+    return small_paths[ctx.Random() % small_paths.size()].c_str();
+}
+
+// Block-aligned offset in the large file a read of length bytes fits at.
+static OrbisFiosOffset LargeOffset(Context& ctx, u64 length) {
+    const u64 slots = (LARGE_FILE_SIZE - length) / 4_KB + 1;
+    return static_cast<OrbisFiosOffset>(ctx.Random() % slots * 4_KB);
+}
+
+static void WaitAndDelete(OrbisFiosOp op) {
+    sceFiosOpWait(op);
+    sceFiosOpDelete(op);
+}
+
+static std::vector<Benchmark> MakeBenchmarks() {
+    std::vector<Benchmark> benchmarks = {
+        {"ExistsSync/hit", [](Context& ctx) { sceFiosExistsSync(nullptr, SmallFile(ctx)); }},
+        {"ExistsSync/miss",
+         [](Context& ctx) {
+             sceFiosExistsSync(nullptr,
+                               missing_paths[ctx.Random() % missing_paths.size()].c_str());
+         }},
+        {"FileGetSizeSync",
+         [](Context& ctx) { sceFiosFileGetSizeSync(nullptr, SmallFile(ctx)); }},
+        {"StatSync",
+         [](Context& ctx) {
+             OrbisFiosStat stat{};
+             sceFiosStatSync(nullptr, SmallFile(ctx), &stat);
+         }},
+        {"FHOpenSync+FHCloseSync",
+         [](Context& ctx) {
+             OrbisFiosFH fh = -1;
+             if (sceFiosFHOpenSync(nullptr, &fh, SmallFile(ctx), nullptr) == ORBIS_OK) {
+                 sceFiosFHCloseSync(nullptr, fh);
+             }
+         }},
+    };
+    for (u64 size : {4_KB, 64_KB, 1_MB, 16_MB}) {
+        const std::string suffix = size < 1_MB ? std::to_string(size / 1_KB) + "K"
+                                               : std::to_string(size / 1_MB) + "M";
+        benchmarks.push_back({"FHPreadSync/" + suffix, [size](Context& ctx) {
+                                  sceFiosFHPreadSync(nullptr, ctx.fh, ctx.buffer.data(), size,
+                                                     LargeOffset(ctx, size));
+                              },
+                              size});
+    }
+    benchmarks.push_back({"FHReadvSync/4x16K", [](Context& ctx) {
+                              OrbisFiosBuffer iov[READV_BUFFERS];
+                              for (u32 i = 0; i < READV_BUFFERS; ++i) {
+                                  iov[i] = {ctx.buffer.data() + i * READV_BUFFER_SIZE,
+                                            READV_BUFFER_SIZE};
+                              }
+                              if (sceFiosFHReadvSync(nullptr, ctx.fh, iov, READV_BUFFERS) <
+                                  static_cast<OrbisFiosSize>(READV_BUFFERS * READV_BUFFER_SIZE)) {
+                                  sceFiosFHSeek(ctx.fh, 0, OrbisFiosWhence::Set);
+                              }
+                          },
+                          READV_BUFFERS * READV_BUFFER_SIZE});
+    // Async calls with the wait and delete a game follows them with.
+    benchmarks.push_back({"Exists+OpWait", [](Context& ctx) {
+                              bool exists;
+                              WaitAndDelete(sceFiosExists(nullptr, SmallFile(ctx), &exists));
+                          }});
+    benchmarks.push_back({"FileGetSize+OpWait", [](Context& ctx) {
+                              WaitAndDelete(sceFiosFileGetSize(nullptr, SmallFile(ctx)));
+                          }});
+    benchmarks.push_back({"Stat+OpWait", [](Context& ctx) {
+                              OrbisFiosStat stat{};
+                              WaitAndDelete(sceFiosStat(nullptr, SmallFile(ctx), &stat));
+                          }});
+    benchmarks.push_back({"FHOpen+OpWait+FHClose", [](Context& ctx) {
+                              OrbisFiosFH fh = -1;
+                              WaitAndDelete(sceFiosFHOpen(nullptr, &fh, SmallFile(ctx), nullptr));
+                              if (fh >= 0) {
+                                  WaitAndDelete(sceFiosFHClose(nullptr, fh));
+                              }
+                          }});
+    for (u64 size : {4_KB, 1_MB}) {
+        const std::string suffix = size < 1_MB ? std::to_string(size / 1_KB) + "K"
+                                               : std::to_string(size / 1_MB) + "M";
+        benchmarks.push_back({"FHPread+OpWait/" + suffix, [size](Context& ctx) {
+                                  WaitAndDelete(sceFiosFHPread(nullptr, ctx.fh, ctx.buffer.data(),
+                                                               size, LargeOffset(ctx, size)));
+                              },
+                              size});
+    }
+    return benchmarks;
+}
+
+static void Run(const Benchmark& benchmark, u32 num_threads, double seconds) {
+    std::vector<std::vector<u32>> latencies(num_threads); // ns
+    std::atomic<u32> ready{0};
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> threads;
+    for (u32 t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t] {
+            Context ctx{t * 2654435761u + 1};
+            ctx.buffer.resize(benchmark.buffer_size);
+            sceFiosFHOpenSync(nullptr, &ctx.fh, "/app0/fios_bench/large.bin", nullptr);
+            std::vector<u32>& times = latencies[t];
+            times.reserve(1 << 20);
+            benchmark.call(ctx); // warm up
+            ready.fetch_add(1);
+            while (ready.load() < num_threads + 1) {
+                std::this_thread::yield();
+            }
+            while (!stop.load(std::memory_order_relaxed)) {
+                const auto begin = Clock::now();
+                benchmark.call(ctx);
+                const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    Clock::now() - begin)
+                                    .count();
+                times.push_back(static_cast<u32>(std::min<s64>(ns, UINT32_MAX)));
+            }
+            sceFiosFHCloseSync(nullptr, ctx.fh);
+        });
+    }
+    while (ready.load() < num_threads) {
+        std::this_thread::yield();
+    }
+    const auto start = Clock::now();
+    ready.fetch_add(1);
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop.store(true);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<u32> all;
+    for (const std::vector<u32>& times : latencies) {
+        all.insert(all.end(), times.begin(), times.end());
+    }
+    std::sort(all.begin(), all.end());
+    double sum = 0;
+    for (u32 ns : all) {
+        sum += ns;
+    }
+    auto percentile = [&](double p) {
+        return all.empty() ? 0 : all[std::min<size_t>(all.size() - 1, all.size() * p)] / 1e3;
+    };
+    std::printf("%s,%u,%zu,%.0f,%.3f,%.3f,%.3f,%.3f,%.3f\n", benchmark.name.c_str(), num_threads,
+                all.size(), all.size() / elapsed, all.empty() ? 0 : sum / all.size() / 1e3,
+                percentile(0.5), percentile(0.9), percentile(0.99),
+                all.empty() ? 0 : all.back() / 1e3);
+    std::fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    u32 max_threads = 16;
+    double seconds = 0.5;
+    std::string filter;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-t" && i + 1 < argc) {
+            max_threads = static_cast<u32>(std::strtoul(argv[++i], nullptr, 0));
+        } else if (arg == "-d" && i + 1 < argc) {
+            seconds = std::strtod(argv[++i], nullptr);
+        } else {
+            filter = arg;
+        }
+    }
+    if (!std::getenv("FIOS2_APP0")) {
+        setenv("FIOS2_APP0", "/tmp", 1);
+    }
+    const std::string root = std::string(std::getenv("FIOS2_APP0")) + "/fios_bench";
+    CreateTree(root);
+    for (u32 i = 0; i < NUM_DIRS * FILES_PER_DIR; ++i) {
+        small_paths.push_back(SmallPath(i));
+        missing_paths.push_back(SmallPath(i) + ".missing");
+    }
+
+    std::printf("benchmark,threads,ops,ops_per_sec,mean_us,p50_us,p90_us,p99_us,max_us\n");
+    for (const Benchmark& benchmark : MakeBenchmarks()) {
+        if (benchmark.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        for (u32 threads = 1; threads <= max_threads; threads *= 2) {
+            Run(benchmark, threads, seconds);
+        }
+    }
+
+    RemoveTree(root);
+    return 0;
+}
@@ -0,0 +1,83 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Cost of a log call on the calling thread: a LOG_DEBUG with an integer and a path, queued for the
+// writer thread, against formatting the same line on the calling thread the way every call used to.
+// Calls are timed in batches that fit in a thread's ring, with the ring written out in between, so
+// nothing is dropped. Output is discarded unless $FIOS2_LOG is set. Then the same call with its
+// category's level above Debug, and a LOG_ERROR past its call site's rate limit, whose arguments
+// (here building a string) are never evaluated.
+//
+// Usage: logging [calls, default 1000000]
+// Built by `make host` as build/host/bench/logging.
+
+#include "logging.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace Fios2;
+
+constexpr u64 BATCH = 500;
+
+template <typename F>
+static double NsPerCall(u64 calls, F&& log) {
+    std::chrono::nanoseconds total{0};
+    for (u64 done = 0; done < calls; done += BATCH) {
+        const auto start = std::chrono::steady_clock::now();
+        for (u64 i = 0; i < BATCH; ++i) {
+            log(done + i);
+        }
+        total += std::chrono::steady_clock::now() - start;
+        Log::Flush();
+    }
+    return std::chrono::duration<double, std::nano>(total).count() / calls;
+}
+
+template <typename F>
+static double NsPerSkippedCall(u64 calls, F&& log) {
+    const auto start = std::chrono::steady_clock::now();
+    for (u64 i = 0; i < calls; ++i) {
+        log(i);
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / calls;
+}
+
+int main(int argc, char** argv) {
+    const u64 calls = argc > 1 ? std::strtoull(argv[1], nullptr, 0) : 1000000;
+    const std::string path = "/app0/data/level03/textures.bin";
+    Log::SetRateLimit(0);
+
+    const double sync = NsPerCall(calls, [&](u64 i) {
+        const std::string message = FormatLog("read {:#x} bytes of {}", i, path);
+        const std::string line = fmt::format("[Homebrew] {}:{} <{}> {}: {}\n", __FILE__, __LINE__,
+                                             "Debug", __func__, message);
+        sceKernelDebugOutText(0, line.c_str());
+    });
+    const double queued =
+        NsPerCall(calls, [&](u64 i) { LOG_DEBUG(Cache, "read {:#x} bytes of {}", i, path); });
+    const double no_args = NsPerCall(calls, [](u64) { LOG_DEBUG(Cache, "called"); });
+
+    Log::SetLevel(Log::Category::Cache, Log::Level::Info);
+    const u64 skipped_calls = calls * 100;
+    const double disabled = NsPerSkippedCall(skipped_calls, [&](u64 i) {
+        LOG_DEBUG(Cache, "read {:#x} bytes of {}", i, path + std::to_string(i));
+    });
+    Log::SetRateLimit(1);
+    const double limited = NsPerSkippedCall(skipped_calls, [&](u64 i) {
+        LOG_ERROR(Cache, "read {:#x} bytes of {}", i, path + std::to_string(i));
+    });
+    Log::SetRateLimit(0);
+    Log::Flush();
+
+    std::printf("%llu calls: %.1f ns/call formatted on the caller, %.1f ns/call queued, "
+                "%.1f ns/call queued without arguments\n",
+                static_cast<unsigned long long>(calls), sync, queued, no_args);
+    std::printf("%llu calls: %.2f ns/call below the category's level, %.2f ns/call past the rate "
+                "limit\n",
+                static_cast<unsigned long long>(skipped_calls), disabled, limited);
+    return 0;
+}
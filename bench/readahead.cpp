@@ -0,0 +1,92 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Replays a streaming reader: one large file read front to back in 4 KB sceFiosFHReadSync calls,
+// first with readahead disabled, then enabled.
+//
+// Usage: readahead [file size in MB, default 256]
+// Built by `make host` as build/host/bench/readahead; the test file is created in $FIOS2_APP0
+// (default /tmp).
+
+#include "config.h"
+#include "fios2.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace Fios2;
+
+constexpr u64 READ_SIZE = 4_KB;
+
+static void CreateTestFile(const std::string& path, u64 size) {
+    std::vector<u8> chunk(1_MB);
+    for (u64 i = 0; i < chunk.size(); ++i) {
+        chunk[i] = static_cast<u8>(i * 31 + 7);
+    }
+    FILE* f = std::fopen(path.c_str(), "wb");
+    for (u64 written = 0; written < size; written += chunk.size()) {
+        std::fwrite(chunk.data(), 1, chunk.size(), f);
+    }
+    std::fclose(f);
+}
+
+// Evicts the file from the host page cache so every run starts cold.
+static void DropPageCache(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+static void Run(const char* name, const std::string& host_path, u64 size) {
+    DropPageCache(host_path);
+    sceFiosCacheFlushSync(nullptr);
+    Fios2ExtCacheStats before{}, after{};
+    fios2ExtGetCacheStats(&before);
+
+    OrbisFiosFH fh = -1;
+    sceFiosFHOpenSync(nullptr, &fh, "/app0/readahead_bench.bin", nullptr);
+    std::vector<u8> buf(READ_SIZE);
+    u64 total = 0;
+    const auto start = std::chrono::steady_clock::now();
+    while (total < size) {
+        OrbisFiosSize ret = sceFiosFHReadSync(nullptr, fh, buf.data(), READ_SIZE);
+        if (ret <= 0) {
+            break;
+        }
+        total += ret;
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    sceFiosFHCloseSync(nullptr, fh);
+
+    fios2ExtGetCacheStats(&after);
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    std::printf("%-14s %8.1f MB/s %8.2f us/read  cache hits %5.1f%%\n", name,
+                total / seconds / 1_MB, seconds * 1e6 / (total / READ_SIZE),
+                100.0 * (after.hitBytes - before.hitBytes) / total);
+}
+
+int main(int argc, char** argv) {
+    const u64 size = (argc > 1 ? std::strtoull(argv[1], nullptr, 0) : 256) * 1_MB;
+    if (!std::getenv("FIOS2_APP0")) {
+        setenv("FIOS2_APP0", "/tmp", 1);
+    }
+    const std::string host_path = std::string(std::getenv("FIOS2_APP0")) + "/readahead_bench.bin";
+    CreateTestFile(host_path, size);
+
+    std::printf("sequential %llu-byte reads over %llu MB\n",
+                static_cast<unsigned long long>(READ_SIZE),
+                static_cast<unsigned long long>(size / 1_MB));
+    Config::Get().readahead = false;
+    Run("readahead off", host_path, size);
+    Config::Get().readahead = true;
+    Run("readahead on", host_path, size);
+
+    unlink(host_path.c_str());
+    return 0;
+}
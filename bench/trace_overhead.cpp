@@ -0,0 +1,91 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Cost of access tracing on the read path: 4 KB sceFiosFHPreadSync calls at random offsets of a
+// file in the host page cache, before and after the trace is started, then the trace is flushed
+// and its size checked against the number of reads. Recording alone is timed on its own too, since
+// the difference between the two runs is within the noise of the reads themselves.
+//
+// Usage: trace_overhead [reads, default 200000]
+// Built by `make host` as build/host/bench/trace_overhead; files are created in $FIOS2_APP0
+// (default /tmp).
+
+#include "fios2.h"
+#include "trace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <orbis/libkernel.h>
+
+using namespace Fios2;
+
+constexpr u64 FILE_SIZE = 16_MB;
+constexpr u64 READ_SIZE = 4_KB;
+
+static double NsPerRead(OrbisFiosFH fh, u64 reads) {
+    std::vector<u8> buf(READ_SIZE);
+    u32 state = 1;
+    const auto start = std::chrono::steady_clock::now();
+    for (u64 i = 0; i < reads; ++i) {
+        state = state * 1103515245u + 12345u;
+        const u64 offset = (state % (FILE_SIZE / READ_SIZE)) * READ_SIZE;
+        sceFiosFHPreadSync(nullptr, fh, buf.data(), READ_SIZE, offset);
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / reads;
+}
+
+int main(int argc, char** argv) {
+    const u64 reads = argc > 1 ? std::strtoull(argv[1], nullptr, 0) : 200000;
+    if (!std::getenv("FIOS2_APP0")) {
+        setenv("FIOS2_APP0", "/tmp", 1);
+    }
+    const std::string app0 = std::getenv("FIOS2_APP0");
+    const std::string data_path = app0 + "/trace_bench.bin";
+    const std::string trace_path = app0 + "/trace_bench.trace";
+    std::vector<u8> data(FILE_SIZE, 0x5a);
+    FILE* f = std::fopen(data_path.c_str(), "wb");
+    std::fwrite(data.data(), 1, data.size(), f);
+    std::fclose(f);
+    unlink(trace_path.c_str());
+
+    OrbisFiosFH fh = -1;
+    sceFiosFHOpenSync(nullptr, &fh, "/app0/trace_bench.bin", nullptr);
+    NsPerRead(fh, reads / 10); // warm up
+    const double off = NsPerRead(fh, reads);
+    Trace::Start("/app0/trace_bench.trace");
+    const double on = NsPerRead(fh, reads);
+    fios2ExtFlushTrace();
+    sceFiosFHCloseSync(nullptr, fh);
+
+    // Kept under what the flusher drains in one interval, so nothing is dropped.
+    const u32 path = Trace::Intern("/app0/trace_bench.bin");
+    const u64 records = 4000;
+    const auto start = std::chrono::steady_clock::now();
+    for (u64 i = 0; i < records; ++i) {
+        Trace::OnRead(path, i * READ_SIZE, READ_SIZE);
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    const double record = std::chrono::duration<double, std::nano>(elapsed).count() / records;
+    fios2ExtFlushTrace();
+
+    struct stat st {};
+    stat(trace_path.c_str(), &st);
+    std::printf("%llu reads of %llu KB: %.1f ns/read untraced, %.1f ns/read traced (%+.1f%%)\n",
+                static_cast<unsigned long long>(reads),
+                static_cast<unsigned long long>(READ_SIZE / 1_KB), off, on, (on - off) / off * 100);
+    std::printf("recording alone: %.1f ns/read (%.1f%% of an untraced read), %.1f MB trace "
+                "(%.1f bytes/read)\n",
+                record, record / off * 100, st.st_size / 1e6,
+                double(st.st_size) / (reads + records));
+
+    unlink(data_path.c_str());
+    unlink(trace_path.c_str());
+    return 0;
+}
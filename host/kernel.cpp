@@ -0,0 +1,186 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// POSIX implementation of the sceKernel* calls declared in host/orbis/libkernel.h.
+//
+// Game paths under /app0 are redirected to $FIOS2_APP0 (default /tmp). Log output is dropped
+// unless $FIOS2_LOG is set, so it doesn't skew benchmarks. Errors come back as the console's
+// 0x8002xxxx codes, FreeBSD and Linux share the errno values the library looks at.
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+
+// Linux's values, before orbis/libkernel.h replaces them with FreeBSD's.
+constexpr int HOST_O_APPEND = O_APPEND;
+constexpr int HOST_O_CREAT = O_CREAT;
+constexpr int HOST_O_TRUNC = O_TRUNC;
+constexpr int HOST_O_EXCL = O_EXCL;
+constexpr int HOST_O_DIRECTORY = O_DIRECTORY;
+
+#include "fios2.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <orbis/libkernel.h>
+
+static std::string HostPath(const char* path) {
+    if (std::strncmp(path, "/app0", 5) == 0 && (path[5] == '/' || path[5] == '\0')) {
+        const char* app0 = std::getenv("FIOS2_APP0");
+        return std::string(app0 ? app0 : "/tmp") + (path + 5);
+    }
+    return path;
+}
+
+static int Error() {
+    return static_cast<int>(0x80020000u + static_cast<unsigned>(errno));
+}
+
+template <typename T>
+static T Check(T ret) {
+    return ret < 0 ? Error() : ret;
+}
+
+static void ToKernelStat(const struct stat& st, OrbisKernelStat* sb) {
+    _OrbisKernelStat& out = *reinterpret_cast<_OrbisKernelStat*>(sb);
+    out = {};
+    out.st_dev = static_cast<u32>(st.st_dev);
+    out.st_ino = static_cast<u32>(st.st_ino);
+    out.st_mode = static_cast<u16>(st.st_mode);
+    out.st_nlink = static_cast<u16>(st.st_nlink);
+    out.st_uid = st.st_uid;
+    out.st_gid = st.st_gid;
+    out.st_atim = {st.st_atim.tv_sec, st.st_atim.tv_nsec};
+    out.st_mtim = {st.st_mtim.tv_sec, st.st_mtim.tv_nsec};
+    out.st_ctim = {st.st_ctim.tv_sec, st.st_ctim.tv_nsec};
+    out.st_birthtim = out.st_ctim;
+    out.st_size = st.st_size;
+    out.st_blocks = st.st_blocks;
+    out.st_blksize = static_cast<u32>(st.st_blksize);
+}
+
+extern "C" {
+
+int sceKernelOpen(const char* path, int flags, int mode) {
+    int host_flags = flags & O_ACCMODE;
+    host_flags |= flags & O_APPEND ? HOST_O_APPEND : 0;
+    host_flags |= flags & O_CREAT ? HOST_O_CREAT : 0;
+    host_flags |= flags & O_TRUNC ? HOST_O_TRUNC : 0;
+    host_flags |= flags & O_EXCL ? HOST_O_EXCL : 0;
+    host_flags |= flags & O_DIRECTORY ? HOST_O_DIRECTORY : 0;
+    return Check(open(HostPath(path).c_str(), host_flags | O_CLOEXEC, mode));
+}
+
+int sceKernelClose(int fd) {
+    return Check(close(fd));
+}
+
+int64_t sceKernelRead(int fd, void* buf, size_t size) {
+    return Check<int64_t>(read(fd, buf, size));
+}
+
+int64_t sceKernelWrite(int fd, const void* buf, size_t size) {
+    return Check<int64_t>(write(fd, buf, size));
+}
+
+int64_t sceKernelPread(int fd, void* buf, size_t size, off_t offset) {
+    return Check<int64_t>(pread(fd, buf, size, offset));
+}
+
+int64_t sceKernelPreadv(int fd, OrbisKernelIovec* iov, int iovcnt, off_t offset) {
+    static_assert(sizeof(OrbisKernelIovec) == sizeof(iovec));
+    return Check<int64_t>(preadv(fd, reinterpret_cast<iovec*>(iov), iovcnt, offset));
+}
+
+off_t sceKernelLseek(int fd, off_t offset, int whence) {
+    return Check(lseek(fd, offset, whence));
+}
+
+int sceKernelStat(const char* path, OrbisKernelStat* sb) {
+    struct stat st;
+    if (stat(HostPath(path).c_str(), &st) < 0) {
+        return Error();
+    }
+    ToKernelStat(st, sb);
+    return ORBIS_OK;
+}
+
+int sceKernelFstat(int fd, OrbisKernelStat* sb) {
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        return Error();
+    }
+    ToKernelStat(st, sb);
+    return ORBIS_OK;
+}
+
+// Repacks Linux dirent64 records as FreeBSD's struct dirent. Those are never larger, so reading at
+// most size bytes of the former always fits.
+int sceKernelGetdents(int fd, char* buf, int size) {
+    std::vector<char> host(size);
+    const long read = syscall(SYS_getdents64, fd, host.data(), host.size());
+    if (read < 0) {
+        return Error();
+    }
+    int out = 0;
+    for (long offset = 0; offset < read;) {
+        // u64 ino, s64 off, u16 reclen, u8 type, then the NUL-terminated name.
+        const char* entry = host.data() + offset;
+        u64 ino;
+        u16 host_reclen;
+        std::memcpy(&ino, entry, sizeof(ino));
+        std::memcpy(&host_reclen, entry + 16, sizeof(host_reclen));
+        const char* name = entry + 19;
+        offset += host_reclen;
+
+        const size_t namlen = std::min<size_t>(std::strlen(name), 255);
+        const u16 reclen = static_cast<u16>((8 + namlen + 1 + 3) & ~size_t{3});
+        const u32 fileno = static_cast<u32>(ino);
+        char* record = buf + out;
+        std::memcpy(record, &fileno, sizeof(fileno));
+        std::memcpy(record + 4, &reclen, sizeof(reclen));
+        record[6] = entry[18];
+        record[7] = static_cast<char>(namlen);
+        std::memcpy(record + 8, name, namlen);
+        std::memset(record + 8 + namlen, 0, reclen - 8 - namlen);
+        out += reclen;
+    }
+    return out;
+}
+
+int sceKernelMmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset,
+                  void** res) {
+    void* mapping = mmap(addr, length, prot, flags, fd, offset);
+    if (mapping == MAP_FAILED) {
+        return Error();
+    }
+    *res = mapping;
+    return ORBIS_OK;
+}
+
+int sceKernelMunmap(void* addr, size_t length) {
+    return Check(munmap(addr, length));
+}
+
+int sceKernelDebugOutText(int channel, const char* text) {
+    static const bool enabled = std::getenv("FIOS2_LOG") != nullptr;
+    if (enabled) {
+        std::fputs(text, stderr);
+    }
+    return ORBIS_OK;
+}
+
+void sceSysUtilSendSystemNotificationWithText(int type, const char* message) {
+    std::fprintf(stderr, "notification: %s\n", message);
+}
+
+} // extern "C"
@@ -0,0 +1,52 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Host stand-in for the parts of OpenOrbis' <orbis/libkernel.h> the library uses, implemented on
+// POSIX in host/kernel.cpp, so the library can be built and replayed against on Linux. Never part
+// of the console build.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/types.h>
+
+#define ORBIS_OK 0
+
+// The library passes sceKernelOpen the console's FreeBSD open flags, some of which have other
+// values on Linux. host/kernel.cpp translates them back.
+#undef O_APPEND
+#undef O_CREAT
+#undef O_TRUNC
+#undef O_EXCL
+#undef O_DIRECTORY
+#define O_APPEND 0x0008
+#define O_CREAT 0x0200
+#define O_TRUNC 0x0400
+#define O_EXCL 0x0800
+#define O_DIRECTORY 0x20000
+
+typedef struct OrbisKernelStat OrbisKernelStat; // the library's _OrbisKernelStat
+
+typedef struct OrbisKernelIovec {
+    void* base;
+    size_t len;
+} OrbisKernelIovec;
+
+extern "C" {
+int sceKernelOpen(const char* path, int flags, int mode);
+int sceKernelClose(int fd);
+int64_t sceKernelRead(int fd, void* buf, size_t size);
+int64_t sceKernelWrite(int fd, const void* buf, size_t size);
+int64_t sceKernelPread(int fd, void* buf, size_t size, off_t offset);
+int64_t sceKernelPreadv(int fd, OrbisKernelIovec* iov, int iovcnt, off_t offset);
+off_t sceKernelLseek(int fd, off_t offset, int whence);
+int sceKernelStat(const char* path, OrbisKernelStat* sb);
+int sceKernelFstat(int fd, OrbisKernelStat* sb);
+int sceKernelGetdents(int fd, char* buf, int size);
+int sceKernelMmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset,
+                  void** res);
+int sceKernelMunmap(void* addr, size_t length);
+int sceKernelDebugOutText(int channel, const char* text);
+}
@@ -19,10 +19,10 @@ void assert_fail_impl() {
 
 extern "C"
 void __cxa_thread_atexit_impl() {
-    // LOG_INFO("Atexit called");
+    // LOG_INFO(General, "Atexit called");
 }
 
 void assert_fail_debug_msg(const char* msg) {
-    LOG_CRITICAL("Assertion failed: {}", msg);
+    LOG_CRITICAL(General, "Assertion failed: {}", msg);
     assert_fail_impl();
 }
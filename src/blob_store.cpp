@@ -0,0 +1,117 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "blob_store.h"
+#include "cache.h"
+#include "config.h"
+#include "logging.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <fcntl.h>
+
+#include <orbis/libkernel.h>
+
+namespace Fios2::BlobStore {
+
+// Entries pack the arena offset into bits 32-62 (see Config::MAX_BLOB_STORE_SIZE) and the size
+// into the low bits. Written once under
+// State::mutex, then read without a lock.
+constexpr u64 ENTRY_PRESENT = 1ULL << 63;
+
+// Heap allocated and never freed, see IoQueue::State.
+struct State {
+    std::mutex mutex;
+    std::unique_ptr<u8[]> arena; // Config blob_store_size bytes, allocated on first load
+    u64 arena_used = 0;
+    std::unique_ptr<std::atomic<u64>[]> entries; // indexed by Cache::GetFileIndex
+    // Files already found not to fit, so they aren't retried on every open.
+    std::unique_ptr<std::atomic<bool>[]> rejected;
+};
+
+State& state = *new State();
+std::atomic<bool> initialized{false};
+
+const u8* Find(const Cache::File* file, u64* pSize) {
+    if (!initialized.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    const u64 entry = state.entries[Cache::GetFileIndex(file)].load(std::memory_order_acquire);
+    if ((entry & ENTRY_PRESENT) == 0) {
+        return nullptr;
+    }
+    *pSize = static_cast<u32>(entry);
+    return state.arena.get() + ((entry & ~ENTRY_PRESENT) >> 32);
+}
+
+const u8* Load(const Cache::File* file, u64* pSize) {
+    if (const u8* data = Find(file, pSize)) {
+        return data;
+    }
+    const Config::Options& options = Config::Get();
+    const u64 size = Cache::GetFileSize(file);
+    if (!options.blob_store || size > options.blob_max_file_size) {
+        return nullptr;
+    }
+    const u32 index = Cache::GetFileIndex(file);
+    if (initialized.load(std::memory_order_acquire) &&
+        state.rejected[index].load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+
+    std::scoped_lock l{state.mutex};
+    if (!state.arena) [[unlikely]] {
+        LOG_INFO(Cache, "Allocating {:#x} byte blob store", options.blob_store_size);
+        state.arena.reset(new u8[options.blob_store_size]);
+        state.entries.reset(new std::atomic<u64>[Cache::MAX_FILES]{});
+        state.rejected.reset(new std::atomic<bool>[Cache::MAX_FILES]{});
+        initialized.store(true, std::memory_order_release);
+    }
+    u64 entry = state.entries[index].load(std::memory_order_relaxed);
+    if (entry & ENTRY_PRESENT) {
+        *pSize = static_cast<u32>(entry);
+        return state.arena.get() + ((entry & ~ENTRY_PRESENT) >> 32);
+    }
+    if (state.arena_used + size > options.blob_store_size) {
+        LOG_WARNING(Cache, "Blob store full, not storing {}", Cache::GetFilePath(file));
+        state.rejected[index].store(true, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    u8* data = state.arena.get() + state.arena_used;
+    s32 fd = sceKernelOpen(Cache::GetFilePath(file).c_str(), O_RDONLY, 0);
+    s64 ret = fd < 0 ? fd : sceKernelPread(fd, data, size, 0);
+    if (fd >= 0) {
+        sceKernelClose(fd);
+    }
+    if (ret != static_cast<s64>(size)) {
+        LOG_ERROR(Cache, "Failed to load {} into the blob store: {:#x}", Cache::GetFilePath(file),
+                  ret);
+        state.rejected[index].store(true, std::memory_order_relaxed);
+        return nullptr;
+    }
+    entry = ENTRY_PRESENT | state.arena_used << 32 | size;
+    state.arena_used += size;
+    state.entries[index].store(entry, std::memory_order_release);
+    *pSize = size;
+    return data;
+}
+
+void LoadManifest(const char* path) {
+    u32 loaded = 0;
+    const bool found = Config::ForEachLine(path, [&loaded](std::string_view line) {
+        u64 size;
+        const Cache::File* file = Cache::GetFile(std::string(line));
+        if (file && Load(file, &size)) {
+            ++loaded;
+        }
+    });
+    if (found) {
+        LOG_INFO(Cache, "Loaded {} files from {} into the blob store", loaded, path);
+    }
+}
+
+} // namespace Fios2::BlobStore
@@ -0,0 +1,28 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "types.h"
+
+namespace Fios2::Cache {
+struct File;
+}
+
+namespace Fios2::BlobStore {
+
+// Optional list of files to load at startup, one /app0 path per line, '#' starts a comment.
+constexpr const char* MANIFEST_PATH = "/app0/sce_module/fios2_blobs.txt";
+
+// Lock-free lookup by file ID. Returns the file's contents and stores its size in *pSize, or
+// nullptr if the file isn't in the store. The memory stays valid for the lifetime of the process.
+const u8* Find(const Cache::File* file, u64* pSize);
+
+// Like Find, but reads the file into the store first if it fits under the size threshold and there
+// is room left in the arena.
+const u8* Load(const Cache::File* file, u64* pSize);
+
+// Loads every file listed in the manifest at path, if it exists.
+void LoadManifest(const char* path);
+
+} // namespace Fios2::BlobStore
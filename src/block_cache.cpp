@@ -0,0 +1,98 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "block_cache.h"
+#include "config.h"
+
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace Fios2::BlockCache {
+
+struct Block {
+    std::unique_ptr<u8[]> data;
+    u32 size;
+    std::list<u64>::iterator lru_it;
+};
+
+// Heap allocated and never freed, see Cache::State.
+struct State {
+    std::mutex mutex;
+    std::unordered_map<u64, Block> blocks;
+    std::list<u64> lru; // most recently used at the front
+    Stats stats{};
+};
+
+State& state = *new State();
+
+static u64 BlockKey(u32 archive_id, u32 block) {
+    return static_cast<u64>(archive_id) << 32 | block;
+}
+
+// Must be called with state.mutex held.
+static void Erase(std::unordered_map<u64, Block>::iterator it) {
+    state.stats.resident_bytes -= it->second.size;
+    state.lru.erase(it->second.lru_it);
+    state.blocks.erase(it);
+}
+
+bool Read(u32 archive_id, u32 block, void* pBuf, u64 offset, u64 length) {
+    if (Config::Get().block_cache_size == 0) {
+        return false;
+    }
+    std::scoped_lock l{state.mutex};
+    auto it = state.blocks.find(BlockKey(archive_id, block));
+    if (it == state.blocks.end()) {
+        ++state.stats.misses;
+        return false;
+    }
+    Block& b = it->second;
+    std::memcpy(pBuf, b.data.get() + offset, length);
+    state.lru.splice(state.lru.begin(), state.lru, b.lru_it);
+    ++state.stats.hits;
+    state.stats.hit_bytes += length;
+    return true;
+}
+
+void Insert(u32 archive_id, u32 block, const void* pData, u32 size) {
+    const u64 budget = Config::Get().block_cache_size;
+    if (size > budget) {
+        return;
+    }
+    std::unique_ptr<u8[]> data(new u8[size]);
+    std::memcpy(data.get(), pData, size);
+
+    const u64 key = BlockKey(archive_id, block);
+    std::scoped_lock l{state.mutex};
+    if (state.blocks.find(key) != state.blocks.end()) {
+        return; // another thread decompressed it too
+    }
+    while (!state.lru.empty() && state.stats.resident_bytes + size > budget) {
+        Erase(state.blocks.find(state.lru.back()));
+        ++state.stats.evicted_blocks;
+    }
+    state.lru.push_front(key);
+    state.blocks.emplace(key, Block{std::move(data), size, state.lru.begin()});
+    state.stats.resident_bytes += size;
+}
+
+void Drop(u32 archive_id) {
+    std::scoped_lock l{state.mutex};
+    for (auto it = state.blocks.begin(); it != state.blocks.end();) {
+        auto next = std::next(it);
+        if (it->first >> 32 == archive_id) {
+            Erase(it);
+        }
+        it = next;
+    }
+}
+
+Stats GetStats() {
+    std::scoped_lock l{state.mutex};
+    return state.stats;
+}
+
+} // namespace Fios2::BlockCache
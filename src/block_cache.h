@@ -0,0 +1,33 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "types.h"
+
+namespace Fios2::BlockCache {
+
+// Decompressed archive blocks, keyed by (archive ID, block index) and kept within
+// Config::block_cache_size with LRU eviction, so small reads landing in the same compressed block
+// only decompress it once.
+
+struct Stats {
+    u64 hits;           // block lookups served from the cache
+    u64 misses;         // block lookups that had to decompress
+    u64 hit_bytes;      // bytes copied out of cached blocks
+    u64 evicted_blocks; // blocks dropped to stay within the budget
+    u64 resident_bytes;
+};
+
+// Copies [offset, offset + length) of the block into pBuf if it is cached. Counts a hit or a miss.
+bool Read(u32 archive_id, u32 block, void* pBuf, u64 offset, u64 length);
+
+// Caches a copy of a freshly decompressed block of size bytes.
+void Insert(u32 archive_id, u32 block, const void* pData, u32 size);
+
+// Drops every cached block of an archive.
+void Drop(u32 archive_id);
+
+Stats GetStats();
+
+} // namespace Fios2::BlockCache
@@ -0,0 +1,376 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "cache.h"
+#include "fios2.h"
+#include "fios2_error.h"
+#include "io_queue.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <fcntl.h>
+
+#include <orbis/libkernel.h>
+
+namespace Fios2::Cache {
+
+// Open-addressing table of interned files. Slots are only ever filled (under State::mutex), never
+// cleared, so lookups can probe it without taking a lock. Kept at most half full so probe sequences
+// stay short.
+constexpr u32 FILE_TABLE_SIZE = 2 * MAX_FILES;
+
+struct File {
+    std::string path;
+    u32 index;
+    s64 size;
+    u64 num_blocks;
+    // One bit per block, set while the block is resident. Written under State::mutex, read
+    // lock-free by the residency queries.
+    std::unique_ptr<std::atomic<u64>[]> residency;
+};
+
+struct Block {
+    File* file;
+    std::unique_ptr<u8[]> data;
+    u32 size;
+    bool prefetched; // loaded by a prefetch rather than a demand read
+    bool used;       // a read has been served from it since it was loaded
+    std::list<u64>::iterator lru_it;
+};
+
+// Heap allocated and never freed, prefetch jobs may still be running during static destruction.
+struct State {
+    std::mutex mutex;
+    std::atomic<File*> files[FILE_TABLE_SIZE]{};
+    u32 num_files = 0;
+    std::unordered_map<u64, Block> blocks;
+    std::list<u64> lru; // most recently used at the front
+    u64 resident_bytes = 0;
+    Stats stats{};
+};
+
+State& state = *new State();
+
+static u64 BlockKey(const File* file, u64 block) {
+    return static_cast<u64>(file->index) << 32 | block;
+}
+
+static u32 BlockBytes(const File* file, u64 block) {
+    return static_cast<u32>(std::min<u64>(BLOCK_SIZE, file->size - block * BLOCK_SIZE));
+}
+
+static void SetResident(File* file, u64 block) {
+    file->residency[block / 64].fetch_or(1ULL << (block % 64), std::memory_order_release);
+}
+
+static void ClearResident(File* file, u64 block) {
+    file->residency[block / 64].fetch_and(~(1ULL << (block % 64)), std::memory_order_release);
+}
+
+static bool IsResident(const File* file, u64 block) {
+    return file->residency[block / 64].load(std::memory_order_acquire) & (1ULL << (block % 64));
+}
+
+// Checks blocks [first, last] a bitmap word at a time.
+static bool RangeResident(const File* file, u64 first, u64 last) {
+    for (u64 word = first / 64; word <= last / 64; ++word) {
+        u64 mask = ~0ULL;
+        if (word == first / 64) {
+            mask &= ~0ULL << (first % 64);
+        }
+        if (word == last / 64) {
+            mask &= ~0ULL >> (63 - last % 64);
+        }
+        if ((file->residency[word].load(std::memory_order_acquire) & mask) != mask) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static u32 FileSlot(const std::string& path) {
+    return static_cast<u32>(std::hash<std::string>{}(path)) & (FILE_TABLE_SIZE - 1);
+}
+
+File* FindFile(const std::string& path) {
+    for (u32 slot = FileSlot(path);; slot = (slot + 1) & (FILE_TABLE_SIZE - 1)) {
+        File* file = state.files[slot].load(std::memory_order_acquire);
+        if (file == nullptr || file->path == path) {
+            return file;
+        }
+    }
+}
+
+File* GetFile(const std::string& path) {
+    if (File* file = FindFile(path)) {
+        return file;
+    }
+    _OrbisKernelStat stat{};
+    if (sceKernelStat(path.c_str(), (OrbisKernelStat*)&stat) != ORBIS_OK) {
+        return nullptr;
+    }
+    std::scoped_lock l{state.mutex};
+    u32 slot = FileSlot(path);
+    for (;; slot = (slot + 1) & (FILE_TABLE_SIZE - 1)) {
+        File* file = state.files[slot].load(std::memory_order_relaxed);
+        if (file == nullptr) {
+            break;
+        }
+        if (file->path == path) {
+            return file; // interned by another thread while we were in sceKernelStat
+        }
+    }
+    if (state.num_files >= MAX_FILES) {
+        LOG_ERROR(Cache, "File table full, not caching {}", path);
+        return nullptr;
+    }
+    File* file = new File{path, state.num_files++, stat.st_size,
+                          (static_cast<u64>(stat.st_size) + BLOCK_SIZE - 1) / BLOCK_SIZE};
+    file->residency.reset(new std::atomic<u64>[(file->num_blocks + 63) / 64]{});
+    state.files[slot].store(file, std::memory_order_release);
+    return file;
+}
+
+s64 GetFileSize(const File* file) {
+    return file->size;
+}
+
+const std::string& GetFilePath(const File* file) {
+    return file->path;
+}
+
+u32 GetFileIndex(const File* file) {
+    return file->index;
+}
+
+// Must be called with state.mutex held.
+static void EvictFor(u64 bytes) {
+    while (!state.lru.empty() && state.resident_bytes + bytes > MEMORY_BUDGET) {
+        auto it = state.blocks.find(state.lru.back());
+        Block& block = it->second;
+        if (block.prefetched && !block.used) {
+            state.stats.prefetch_evicted_bytes += block.size;
+        }
+        ClearResident(block.file, it->first & 0xFFFFFFFF);
+        state.resident_bytes -= block.size;
+        state.lru.pop_back();
+        state.blocks.erase(it);
+    }
+}
+
+static s32 LoadBlock(File* file, s32 fd, u64 block, bool prefetched) {
+    const u64 key = BlockKey(file, block);
+    {
+        std::scoped_lock l{state.mutex};
+        auto it = state.blocks.find(key);
+        if (it != state.blocks.end()) {
+            state.lru.splice(state.lru.begin(), state.lru, it->second.lru_it);
+            return ORBIS_OK;
+        }
+    }
+
+    const u32 size = BlockBytes(file, block);
+    std::unique_ptr<u8[]> data(new u8[size]);
+    s64 ret = sceKernelPread(fd, data.get(), size, block * BLOCK_SIZE);
+    if (ret != size) {
+        LOG_ERROR(Cache, "Failed to load block {} of {}: {:#x}", block, file->path, ret);
+        return ret < 0 ? static_cast<s32>(ret) : ORBIS_FIOS_ERROR_EOF;
+    }
+
+    std::scoped_lock l{state.mutex};
+    if (state.blocks.find(key) != state.blocks.end()) {
+        return ORBIS_OK; // someone else loaded it while we were reading
+    }
+    EvictFor(size);
+    state.lru.push_front(key);
+    state.blocks.emplace(key,
+                         Block{file, std::move(data), size, prefetched, false, state.lru.begin()});
+    SetResident(file, block);
+    state.resident_bytes += size;
+    if (prefetched) {
+        state.stats.prefetched_bytes += size;
+    }
+    return ORBIS_OK;
+}
+
+static s32 LoadRange(File* file, u64 offset, u64 length, bool yield) {
+    const u64 end = std::min<u64>(offset + length, file->size);
+    if (offset >= end) {
+        return ORBIS_OK;
+    }
+    s32 fd = sceKernelOpen(file->path.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        LOG_ERROR(Cache, "Failed to open {} for prefetch: {:#x}", file->path, fd);
+        return fd;
+    }
+    s32 ret = ORBIS_OK;
+    for (u64 block = offset / BLOCK_SIZE; block <= (end - 1) / BLOCK_SIZE; ++block) {
+        if (yield) {
+            IoQueue::YieldToDemand();
+        }
+        ret = LoadBlock(file, fd, block, true);
+        if (ret != ORBIS_OK) {
+            break;
+        }
+    }
+    sceKernelClose(fd);
+    return ret;
+}
+
+static s64 CopyResident(File* file, void* pBuf, u64 length, u64 offset, bool demand_hit) {
+    if (length == 0) {
+        return 0;
+    }
+    if (offset >= static_cast<u64>(file->size)) {
+        return -1;
+    }
+    const u64 end = std::min<u64>(offset + length, file->size);
+    const u64 first = offset / BLOCK_SIZE;
+    const u64 last = (end - 1) / BLOCK_SIZE;
+    if (!RangeResident(file, first, last)) {
+        return -1; // common case, decided without touching the lock
+    }
+
+    std::scoped_lock l{state.mutex};
+    // Blocks can still have been evicted between the bitmap check and taking the lock.
+    if (!RangeResident(file, first, last)) {
+        return -1;
+    }
+    u8* out = static_cast<u8*>(pBuf);
+    for (u64 block = first; block <= last; ++block) {
+        Block& b = state.blocks.find(BlockKey(file, block))->second;
+        const u64 block_start = block * BLOCK_SIZE;
+        const u64 from = std::max(offset, block_start);
+        const u64 to = std::min(end, block_start + b.size);
+        std::memcpy(out, b.data.get() + (from - block_start), to - from);
+        out += to - from;
+        if (b.prefetched && !b.used) {
+            state.stats.prefetch_used_bytes += b.size;
+        }
+        b.used = true;
+        state.lru.splice(state.lru.begin(), state.lru, b.lru_it);
+    }
+    if (demand_hit) {
+        state.stats.hit_bytes += end - offset;
+    }
+    return end - offset;
+}
+
+s64 Read(File* file, void* pBuf, u64 length, u64 offset) {
+    return CopyResident(file, pBuf, length, offset, true);
+}
+
+s64 ReadThrough(File* file, s32 fd, void* pBuf, u64 length, u64 offset) {
+    const u64 end = std::min<u64>(offset + length, file->size);
+    if (offset >= end) {
+        return -1;
+    }
+    for (u64 block = offset / BLOCK_SIZE; block <= (end - 1) / BLOCK_SIZE; ++block) {
+        if (!IsResident(file, block) && LoadBlock(file, fd, block, false) != ORBIS_OK) {
+            return -1;
+        }
+    }
+    return CopyResident(file, pBuf, length, offset, false);
+}
+
+static void SubmitLoad(File* file, u64 offset, u64 length, bool yield,
+                       std::function<void(s32)> onDone) {
+    if (length > MEMORY_BUDGET) {
+        LOG_WARNING(Cache, "Prefetch of {:#x} bytes of {} exceeds the cache budget, truncating",
+                    length, file->path);
+        length = MEMORY_BUDGET;
+    }
+    IoQueue::Submit(IoQueue::Priority::Prefetch,
+                    [file, offset, length, yield, onDone = std::move(onDone)] {
+                        s32 ret = LoadRange(file, offset, length, yield);
+                        if (onDone) {
+                            onDone(ret);
+                        }
+                    });
+}
+
+void Prefetch(File* file, u64 offset, u64 length, std::function<void(s32)> onDone) {
+    SubmitLoad(file, offset, length, true, std::move(onDone));
+}
+
+void Readahead(File* file, u64 offset, u64 length) {
+    // Readahead exists to serve the demand reads of the stream that triggered it, backing off
+    // from those would only make it fall behind.
+    SubmitLoad(file, offset, length, false, {});
+}
+
+s32 PrefetchSync(File* file, u64 offset, u64 length) {
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    bool done = false;
+    s32 result = ORBIS_OK;
+    Prefetch(file, offset, length, [&](s32 ret) {
+        std::scoped_lock l{done_mutex};
+        result = ret;
+        done = true;
+        done_cv.notify_one();
+    });
+    std::unique_lock l{done_mutex};
+    done_cv.wait(l, [&] { return done; });
+    return result;
+}
+
+bool Contains(const File* file, u64 offset, u64 length) {
+    if (offset >= static_cast<u64>(file->size)) {
+        return false; // nothing there to be resident, including any range of an empty file
+    }
+    const u64 end = std::min<u64>(offset + length, file->size);
+    if (offset >= end) {
+        return true;
+    }
+    return RangeResident(file, offset / BLOCK_SIZE, (end - 1) / BLOCK_SIZE);
+}
+
+void Flush(File* file, u64 offset, u64 length) {
+    const u64 end = std::min<u64>(offset + length, file->size);
+    if (offset >= end) {
+        return;
+    }
+    std::scoped_lock l{state.mutex};
+    for (u64 block = offset / BLOCK_SIZE; block <= (end - 1) / BLOCK_SIZE; ++block) {
+        if (!IsResident(file, block)) {
+            continue;
+        }
+        auto it = state.blocks.find(BlockKey(file, block));
+        Block& b = it->second;
+        if (b.prefetched && !b.used) {
+            state.stats.prefetch_evicted_bytes += b.size;
+        }
+        ClearResident(file, block);
+        state.resident_bytes -= b.size;
+        state.lru.erase(b.lru_it);
+        state.blocks.erase(it);
+    }
+}
+
+void FlushAll() {
+    std::scoped_lock l{state.mutex};
+    for (auto& [key, block] : state.blocks) {
+        if (block.prefetched && !block.used) {
+            state.stats.prefetch_evicted_bytes += block.size;
+        }
+        ClearResident(block.file, key & 0xFFFFFFFF);
+    }
+    state.blocks.clear();
+    state.lru.clear();
+    state.resident_bytes = 0;
+}
+
+Stats GetStats() {
+    std::scoped_lock l{state.mutex};
+    return state.stats;
+}
+
+} // namespace Fios2::Cache
@@ -0,0 +1,68 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "types.h"
+
+#include <functional>
+#include <string>
+
+namespace Fios2::Cache {
+
+constexpr u64 BLOCK_SIZE = 64_KB;
+constexpr u64 MEMORY_BUDGET = 64_MB;
+constexpr u32 MAX_FILES = 128 * 1024;
+
+struct File;
+
+struct Stats {
+    u64 hit_bytes;              // bytes served to reads from resident blocks
+    u64 prefetched_bytes;       // bytes brought in by prefetch
+    u64 prefetch_used_bytes;    // prefetched bytes that a read later hit
+    u64 prefetch_evicted_bytes; // prefetched bytes evicted before any read touched them
+};
+
+// Interns a resolved (/app0/...) path. The returned pointer stays valid for the lifetime of the
+// process; nullptr means the file does not exist.
+File* GetFile(const std::string& path);
+
+// Lock-free lookup of an already interned path, never touches the filesystem.
+File* FindFile(const std::string& path);
+
+s64 GetFileSize(const File* file);
+const std::string& GetFilePath(const File* file);
+
+// Dense ID of an interned file, below MAX_FILES.
+u32 GetFileIndex(const File* file);
+
+// Copies [offset, offset + length) into pBuf if every block touched by the range is resident.
+// Returns the number of bytes copied (clamped at end of file), or -1 on a miss.
+s64 Read(File* file, void* pBuf, u64 length, u64 offset);
+
+// Loads any missing blocks of the range through fd, then serves the read from the cache. Returns
+// -1 if a block could not be loaded (or was evicted again before the copy).
+s64 ReadThrough(File* file, s32 fd, void* pBuf, u64 length, u64 offset);
+
+// Queues a low-priority background read of the range into the cache. onDone, if set, is called
+// from the worker thread with ORBIS_OK or the first kernel error once the range has been loaded.
+void Prefetch(File* file, u64 offset, u64 length, std::function<void(s32)> onDone = {});
+
+// Readahead on behalf of a streaming handle. Queued like a prefetch, but doesn't back off while
+// demand reads are in flight.
+void Readahead(File* file, u64 offset, u64 length);
+
+// Same as Prefetch, but blocks until the range is resident (or failed to load).
+s32 PrefetchSync(File* file, u64 offset, u64 length);
+
+// Lock-free residency check, true if every block touched by the range is resident. False for a
+// range that starts at or past the end of the file.
+bool Contains(const File* file, u64 offset, u64 length);
+
+// Drops every resident block touched by the range.
+void Flush(File* file, u64 offset, u64 length);
+void FlushAll();
+
+Stats GetStats();
+
+} // namespace Fios2::Cache
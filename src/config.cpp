@@ -0,0 +1,163 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "config.h"
+#include "logging.h"
+
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <fcntl.h>
+
+#include <orbis/libkernel.h>
+
+namespace Fios2::Config {
+
+Options& Get() {
+    static Options& options = *new Options();
+    return options;
+}
+
+static std::string_view Trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+static bool ParseBool(std::string_view value) {
+    return value == "1" || value == "true" || value == "on" || value == "yes";
+}
+
+// Accepts decimal or 0x-prefixed hex, with an optional K/M/G suffix.
+static u64 ParseSize(std::string_view value) {
+    std::string str(value);
+    char* end = nullptr;
+    u64 size = std::strtoull(str.c_str(), &end, 0);
+    switch (*end) {
+    case 'K':
+    case 'k':
+        return size * 1_KB;
+    case 'M':
+    case 'm':
+        return size * 1_MB;
+    case 'G':
+    case 'g':
+        return size * 1_GB;
+    default:
+        return size;
+    }
+}
+
+static void Apply(Options& options, std::string_view key, std::string_view value) {
+    if (key == "readahead") {
+        options.readahead = ParseBool(value);
+    } else if (key == "readahead_max_window") {
+        options.readahead_max_window = ParseSize(value);
+    } else if (key == "mmap") {
+        options.mmap = ParseBool(value);
+    } else if (key == "mmap_threshold") {
+        options.mmap_threshold = ParseSize(value);
+    } else if (key == "chunked_reads") {
+        options.chunked_reads = ParseBool(value);
+    } else if (key == "chunked_read_threshold") {
+        options.chunked_read_threshold = ParseSize(value);
+    } else if (key == "chunk_size") {
+        options.chunk_size = ParseSize(value);
+    } else if (key == "blob_store") {
+        options.blob_store = ParseBool(value);
+    } else if (key == "blob_max_file_size") {
+        options.blob_max_file_size = ParseSize(value);
+    } else if (key == "blob_store_size") {
+        options.blob_store_size = ParseSize(value);
+        if (options.blob_store_size > MAX_BLOB_STORE_SIZE) {
+            LOG_WARNING(General, "blob_store_size {} is too large, using {:#x}", value,
+                        MAX_BLOB_STORE_SIZE);
+            options.blob_store_size = MAX_BLOB_STORE_SIZE;
+        }
+    } else if (key == "block_cache_size") {
+        options.block_cache_size = ParseSize(value);
+    } else if (key == "stream_blocks") {
+        options.stream_blocks = ParseSize(value);
+    } else if (key == "verify_archives") {
+        options.verify_archives = value == "mount" ? Verify::Mount
+                                  : value == "lazy" ? Verify::Lazy
+                                                    : Verify::Off;
+    } else if (key == "trace_path") {
+        options.trace_path = value;
+    } else if (key == "trace_calls") {
+        options.trace_calls = ParseBool(value);
+    } else if (key == "log_level" || key.substr(0, 10) == "log_level.") {
+        // log_level sets every category, log_level.<category> one of them.
+        Log::Level level;
+        Log::Category category;
+        if (!Log::ParseLevel(value, level)) {
+            LOG_WARNING(General, "Unknown log level: {}", value);
+            return;
+        }
+        if (key == "log_level") {
+            Log::SetLevel(level);
+        } else if (Log::ParseCategory(key.substr(10), category)) {
+            Log::SetLevel(category, level);
+        } else {
+            LOG_WARNING(General, "Unknown log category: {}", key.substr(10));
+            return;
+        }
+    } else if (key == "log_rate_limit") {
+        Log::SetRateLimit(static_cast<u32>(ParseSize(value)));
+    } else if (key == "override_dir") {
+        options.override_dir = value;
+        while (options.override_dir.size() > 1 && options.override_dir.back() == '/') {
+            options.override_dir.pop_back();
+        }
+    } else {
+        LOG_WARNING(General, "Unknown config key: {}", key);
+        return;
+    }
+    LOG_INFO(General, "{} = {}", key, value);
+}
+
+bool ForEachLine(const char* path, const std::function<void(std::string_view)>& fn) {
+    s32 fd = sceKernelOpen(path, O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    std::string text;
+    char buf[4096];
+    s64 ret;
+    while ((ret = sceKernelRead(fd, buf, sizeof(buf))) > 0) {
+        text.append(buf, ret);
+    }
+    sceKernelClose(fd);
+
+    std::string_view rest = text;
+    while (!rest.empty()) {
+        auto eol = rest.find('\n');
+        std::string_view line = rest.substr(0, eol);
+        rest = eol == std::string_view::npos ? std::string_view{} : rest.substr(eol + 1);
+
+        line = Trim(line.substr(0, line.find('#')));
+        if (!line.empty()) {
+            fn(line);
+        }
+    }
+    return true;
+}
+
+void Load(const char* path) {
+    Options& options = Get();
+    const bool found = ForEachLine(path, [&options](std::string_view line) {
+        auto eq = line.find('=');
+        if (eq != std::string_view::npos) {
+            Apply(options, Trim(line.substr(0, eq)), Trim(line.substr(eq + 1)));
+        }
+    });
+    if (found) {
+        LOG_INFO(General, "Loaded config from {}", path);
+    }
+}
+
+} // namespace Fios2::Config
@@ -0,0 +1,71 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "types.h"
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace Fios2::Config {
+
+// Optional per-game overrides, one "key = value" per line, '#' starts a comment.
+constexpr const char* CONFIG_PATH = "/app0/sce_module/fios2.ini";
+
+// Larger blob_store_size values are clamped to this, BlobStore packs arena offsets into 31 bits.
+constexpr u64 MAX_BLOB_STORE_SIZE = 2_GB;
+
+enum class Verify : u8 {
+    Off,
+    Mount, // decode every block of an archive when it is mounted
+    Lazy,  // check the TOC on mount and each block the first time it is read
+};
+
+struct Options {
+    bool readahead = true;
+    u64 readahead_max_window = 4_MB;
+    // Map read-only files of at least mmap_threshold bytes at open and serve reads from the mapping.
+    bool mmap = false;
+    u64 mmap_threshold = 64_MB;
+    // Split reads of at least chunked_read_threshold bytes into chunk_size pieces that run
+    // concurrently on the I/O workers.
+    bool chunked_reads = true;
+    u64 chunked_read_threshold = 4_MB;
+    u64 chunk_size = 1_MB;
+    // Keep whole files of at most blob_max_file_size bytes in one blob_store_size arena, so opening
+    // and reading them never reaches the kernel.
+    bool blob_store = false;
+    u64 blob_max_file_size = 4_KB;
+    u64 blob_store_size = 16_MB;
+    // Budget for decompressed archive blocks kept around for reads that only touch part of one,
+    // 0 disables the cache.
+    u64 block_cache_size = 8_MB;
+    // Decompressed blocks kept ready ahead of a handle that reads an archive file sequentially,
+    // see Psarc::Stream. 0 decompresses every block on demand.
+    u64 stream_blocks = 8;
+    // Loose files under this directory (e.g. /app0/mods) replace the archive files they line up
+    // with, see Override. Empty disables overrides.
+    std::string override_dir;
+    // Integrity checks of mounted archives, see Psarc::VerifyEntries. Off costs nothing.
+    Verify verify_archives = Verify::Off;
+    // Record every read into this file (e.g. /data/fios2.trace) for tools/trace_manifest, see
+    // Trace. Empty disables tracing.
+    std::string trace_path;
+    // Record every sceFios* call into the trace too, for tools/fios_replay.
+    bool trace_calls = false;
+};
+
+// Loaded on first FIOS call, defaults are used if the config file doesn't exist. Only change these
+// while no FIOS calls are in flight.
+Options& Get();
+
+void Load(const char* path);
+
+// Calls fn with every line of the text file at path, '#' comments and surrounding whitespace
+// stripped, skipping lines left empty. Shared by the config and the blob store manifest. Returns
+// false if the file can't be opened.
+bool ForEachLine(const char* path, const std::function<void(std::string_view)>& fn);
+
+} // namespace Fios2::Config
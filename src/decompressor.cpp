@@ -0,0 +1,187 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "decompressor.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Fios2::Decompressor {
+
+// Scratch buffers kept for reuse, enough for every pool thread and a caller each to hold two.
+constexpr u32 MAX_SCRATCH_BUFFERS = 2 * MAX_THREADS;
+
+// One ParallelFor call. Each slot owns a range of task indices packed as begin | end << 32; the
+// owner takes from the front, thieves from the back, both with a CAS on the whole range.
+struct Job {
+    const std::function<void(u32)>* task;
+    u32 num_slots;
+    std::atomic<u64> ranges[MAX_THREADS];
+    std::atomic<u32> next_slot{1}; // slot 0 is the caller's
+    std::atomic<u32> tasks_left;
+};
+
+// Heap allocated and never freed, see IoQueue::State.
+struct State {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::shared_ptr<Job>> jobs;
+    u32 num_workers = 0;
+    std::atomic<u32> thread_count{1};
+
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+
+    std::mutex scratch_mutex;
+    std::vector<std::vector<u8>> scratch; // free Scratch buffers
+};
+
+State& state = *new State();
+
+static bool TakeFront(std::atomic<u64>& range, u32* pIndex) {
+    u64 value = range.load(std::memory_order_relaxed);
+    while (static_cast<u32>(value) < static_cast<u32>(value >> 32)) {
+        if (range.compare_exchange_weak(value, value + 1, std::memory_order_acq_rel)) {
+            *pIndex = static_cast<u32>(value);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool TakeBack(std::atomic<u64>& range, u32* pIndex) {
+    u64 value = range.load(std::memory_order_relaxed);
+    while (static_cast<u32>(value) < static_cast<u32>(value >> 32)) {
+        if (range.compare_exchange_weak(value, value - (1ULL << 32), std::memory_order_acq_rel)) {
+            *pIndex = static_cast<u32>(value >> 32) - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void RunSlot(Job& job, u32 slot) {
+    while (true) {
+        u32 index;
+        bool found = TakeFront(job.ranges[slot], &index);
+        for (u32 i = 1; !found && i < job.num_slots; ++i) {
+            found = TakeBack(job.ranges[(slot + i) % job.num_slots], &index);
+        }
+        if (!found) {
+            return;
+        }
+        (*job.task)(index);
+        if (job.tasks_left.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::scoped_lock l{state.done_mutex};
+            state.done_cv.notify_all();
+        }
+    }
+}
+
+static void WorkerLoop() {
+    while (true) {
+        std::shared_ptr<Job> job;
+        u32 slot;
+        {
+            std::unique_lock l{state.mutex};
+            state.cv.wait(l, [] { return !state.jobs.empty(); });
+            job = state.jobs.front();
+            slot = job->next_slot.fetch_add(1, std::memory_order_relaxed);
+            if (slot + 1 >= job->num_slots) {
+                state.jobs.pop_front(); // every slot is taken
+            }
+        }
+        if (slot < job->num_slots) {
+            RunSlot(*job, slot);
+        }
+    }
+}
+
+void SetThreadCount(u32 count) {
+    count = std::clamp<u32>(count, 1, MAX_THREADS);
+    LOG_INFO(Archive, "Decompressor thread count: {}", count);
+    state.thread_count.store(count, std::memory_order_relaxed);
+}
+
+u32 GetThreadCount() {
+    return state.thread_count.load(std::memory_order_relaxed);
+}
+
+void ParallelFor(u32 count, const std::function<void(u32)>& task) {
+    ParallelFor(count, GetThreadCount(), task);
+}
+
+void ParallelFor(u32 count, u32 threads, const std::function<void(u32)>& task) {
+    const u32 num_slots = std::min({threads, MAX_THREADS, count});
+    if (num_slots <= 1) {
+        for (u32 i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->task = &task;
+    job->num_slots = num_slots;
+    job->tasks_left.store(count, std::memory_order_relaxed);
+    for (u32 slot = 0; slot < num_slots; ++slot) {
+        const u64 begin = static_cast<u64>(count) * slot / num_slots;
+        const u64 end = static_cast<u64>(count) * (slot + 1) / num_slots;
+        job->ranges[slot].store(begin | end << 32, std::memory_order_relaxed);
+    }
+    {
+        std::scoped_lock l{state.mutex};
+        while (state.num_workers < num_slots - 1) {
+            std::thread(WorkerLoop).detach();
+            ++state.num_workers;
+        }
+        state.jobs.push_back(job);
+    }
+    for (u32 i = 1; i < num_slots; ++i) {
+        state.cv.notify_one();
+    }
+
+    RunSlot(*job, 0);
+    {
+        std::unique_lock l{state.done_mutex};
+        state.done_cv.wait(
+            l, [&job] { return job->tasks_left.load(std::memory_order_acquire) == 0; });
+    }
+    // Workers that never got to it don't need to any more.
+    std::scoped_lock l{state.mutex};
+    auto it = std::find(state.jobs.begin(), state.jobs.end(), job);
+    if (it != state.jobs.end()) {
+        state.jobs.erase(it);
+    }
+}
+
+void Scratch::Resize(u64 size) {
+    if (!pooled) {
+        pooled = true;
+        std::scoped_lock l{state.scratch_mutex};
+        if (!state.scratch.empty()) {
+            buffer.swap(state.scratch.back());
+            state.scratch.pop_back();
+        }
+    }
+    buffer.resize(size);
+}
+
+Scratch::~Scratch() {
+    if (!pooled) {
+        return;
+    }
+    std::scoped_lock l{state.scratch_mutex};
+    if (state.scratch.size() < MAX_SCRATCH_BUFFERS) {
+        state.scratch.push_back(std::move(buffer));
+    }
+}
+
+} // namespace Fios2::Decompressor
@@ -0,0 +1,53 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "types.h"
+
+#include <functional>
+#include <vector>
+
+namespace Fios2::Decompressor {
+
+constexpr u32 MAX_THREADS = 16;
+
+// Number of threads (including the caller) that work on one read's blocks.
+// sceFiosArchiveSetDecompressorThreadCount; defaults to 1, which decompresses on the caller only.
+void SetThreadCount(u32 count);
+u32 GetThreadCount();
+
+// Calls task(i) for every i in [0, count), spread across the pool with the calling thread taking
+// part, and returns once all of them have finished. Each participant starts on its own contiguous
+// share of the indices and steals from the back of the others' once it runs out.
+void ParallelFor(u32 count, const std::function<void(u32)>& task);
+
+// Same with up to threads participants instead of GetThreadCount(), for one-off work that should
+// use every core, like verifying an archive on mount.
+void ParallelFor(u32 count, u32 threads, const std::function<void(u32)>& task);
+
+// Scratch memory for reading and decompressing blocks, taken from a shared pool on first use and
+// handed back on destruction. A read doesn't allocate once the pool is warm, and unlike a
+// thread_local buffer nothing is left behind by threads that exit.
+class Scratch {
+public:
+    Scratch() = default;
+    explicit Scratch(u64 size) {
+        Resize(size);
+    }
+    ~Scratch();
+
+    Scratch(const Scratch&) = delete;
+    Scratch& operator=(const Scratch&) = delete;
+
+    void Resize(u64 size);
+    u8* Data() {
+        return buffer.data();
+    }
+
+private:
+    std::vector<u8> buffer;
+    bool pooled = false; // buffer came from the pool and goes back to it
+};
+
+} // namespace Fios2::Decompressor
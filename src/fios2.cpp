@@ -2,17 +2,36 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 
 #include "assert.h"
+#include "blob_store.h"
+#include "block_cache.h"
+#include "cache.h"
+#include "config.h"
+#include "decompressor.h"
 #include "fios2.h"
 #include "fios2_error.h"
+#include "io_queue.h"
 #include "logging.h"
+#include "mount_table.h"
+#include "override.h"
+#include "psarc.h"
+#include "psarc_stream.h"
+#include "readahead.h"
+#include "single_flight.h"
+#include "trace.h"
 #include "types.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
 #include <unordered_map>
 #include <vector>
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <orbis/libkernel.h>
 
@@ -29,16 +48,72 @@ OrbisFiosOp op_count = 0;
 std::unordered_map<OrbisFiosOp, s32>* op_return_codes_map = nullptr;
 std::unordered_map<OrbisFiosOp, OrbisFiosSize>* op_io_return_codes_map = nullptr;
 
-std::unordered_map<OrbisFiosFH, std::string>* fh_path_map = nullptr;
+// A large read split into chunks that run on the I/O workers. Stays in pending_reads until its last
+// chunk lands, then its result moves to op_io_return_codes_map.
+struct PendingRead {
+    OrbisFiosOpAttr attr;
+    OrbisFiosFH fh;
+    u64 length; // clamped to the end of the file
+    std::atomic<u64> done_bytes{0};
+    std::atomic<u32> chunks_left{0};
+    std::mutex failure_mutex;
+    u64 failed_at = ~0ULL; // bytes into the read where the first failed chunk stopped
+    s64 error = 0;         // kernel error of that chunk, 0 if it hit end of file
+};
+
+std::unordered_map<OrbisFiosOp, std::shared_ptr<PendingRead>>* pending_reads = nullptr;
+// Signalled (with m held) whenever a pending read completes or a handle's last read in flight
+// finishes. Never destroyed, for the same reason as the I/O queue state.
+std::condition_variable& op_done_cv = *new std::condition_variable();
+
+struct FileHandle {
+    std::string path;            // as passed by the game
+    Cache::File* file = nullptr; // resolved on first cached access
+    OrbisFiosOffset position = 0;
+    Readahead readahead;
+    // Whole-file read-only mapping for large files when mmap mode is on, unmapped by
+    // sceFiosFHClose. Blob store handles point this into the blob arena instead.
+    const u8* mapping = nullptr;
+    u64 mapping_size = 0;
+    bool blob = false; // virtual handle with no kernel descriptor behind it
+    // File inside a mounted archive, also a virtual handle. Keeps the archive open past an unmount.
+    std::shared_ptr<Psarc::Archive> archive;
+    u32 entry = 0;
+    // Set once the handle has read its archive file sequentially for a while, dropped on the first
+    // read that isn't.
+    std::shared_ptr<Psarc::Stream> stream;
+    u64 stream_next = 0; // where the next read continues the sequence
+    u32 stream_streak = 0;
+    u32 trace_path = Trace::NO_PATH; // interned at open while a trace is being recorded
+    // Reads still using the handle: chunked reads, and reads that dropped m for their I/O.
+    // sceFiosFHClose waits for them, so they never see the handle erased or read a closed
+    // descriptor, or one already reused by another open.
+    u32 reads_in_flight = 0;
+
+    bool IsVirtual() const {
+        return blob || archive != nullptr;
+    }
+};
+
+// Blob store, archive file and archive mount handles are numbered from here up, well clear of
+// kernel descriptors.
+constexpr OrbisFiosFH VIRTUAL_FH_BASE = 0x10000000;
+OrbisFiosFH virtual_fh_count = 0;
+
+std::unordered_map<OrbisFiosFH, FileHandle>* fh_table = nullptr;
 std::unordered_map<OrbisFiosDH, std::string>* dh_path_map = nullptr;
 
 std::unordered_map<std::string, _OrbisKernelStat>* file_stat_map = nullptr;
 
 const char* ToApp0(const char* _arc) {
     static thread_local std::string result;
+    if (const std::string* loose = Override::Find(_arc)) {
+        result = *loose;
+        return result.c_str();
+    }
     std::string arc(_arc);
     if(!(arc.find("/app") == 0 || arc.find("arc") == 0)) {
-        LOG_CRITICAL("Path with unknown base: {}", arc);
+        LOG_CRITICAL(Paths, "Path with unknown base: {}", arc);
     }
     auto first_slash = arc.find('/');
     if (first_slash == std::string::npos || first_slash == 0) {
@@ -49,268 +124,949 @@ const char* ToApp0(const char* _arc) {
 }
 
 void EnsureMapsInitialized() {
-    if (op_return_codes_map == nullptr) [[unlikely]] {
-        LOG_INFO("Initializing maps");
+    // Two threads can make their first FIOS call at the same time.
+    static std::once_flag once;
+    std::call_once(once, [] {
+        LOG_INFO(General, "Initializing maps");
         op_return_codes_map = new std::unordered_map<OrbisFiosOp, s32>();
         op_io_return_codes_map = new std::unordered_map<OrbisFiosOp, OrbisFiosSize>();
-        fh_path_map = new std::unordered_map<OrbisFiosFH, std::string>();
+        pending_reads = new std::unordered_map<OrbisFiosOp, std::shared_ptr<PendingRead>>();
+        fh_table = new std::unordered_map<OrbisFiosFH, FileHandle>();
         dh_path_map = new std::unordered_map<OrbisFiosDH, std::string>();
         file_stat_map = new std::unordered_map<std::string, _OrbisKernelStat>();
-    }
+        Config::Load(Config::CONFIG_PATH);
+        if (Config::Get().blob_store) {
+            BlobStore::LoadManifest(BlobStore::MANIFEST_PATH);
+        }
+        if (!Config::Get().trace_path.empty()) {
+            Trace::Start(Config::Get().trace_path.c_str(), Config::Get().trace_calls);
+        }
+    });
 }
 
 void CallFiosCallback(const OrbisFiosOpAttr* pAttr, OrbisFiosOp op, OrbisFiosOpEvent event,
                       s32 err) {
     if (pAttr && pAttr->pCallback) {
-        // LOG_INFO("Calling callback at {}, for op: {}", (void*)pAttr->pCallback, op);
+        // LOG_INFO(Ops, "Calling callback at {}, for op: {}", (void*)pAttr->pCallback, op);
         int ret = pAttr->pCallback(pAttr->pCallbackContext, op, event, err);
         if (ret != 0) {
-            LOG_WARNING("Callback returned {}", ret);
+            LOG_WARNING(Ops, "Callback returned {}", ret);
         }
-        // LOG_DEBUG("Callback returned");
+        // LOG_DEBUG(Ops, "Callback returned");
         // std::this_thread::sleep_for(std::chrono::milliseconds(5));
     }
 }
 
+// Resolves a game path to a file inside a mounted archive. Must be called with m held.
+std::shared_ptr<Psarc::Archive> FindArchiveFile(const char* pPath, u32* pEntry) {
+    return MountTable::FindFile(pPath, pEntry);
+}
+
+// Same for directories, including the mount points themselves. Must be called with m held.
+std::shared_ptr<Psarc::Archive> FindArchiveDirectory(const char* pPath) {
+    return MountTable::FindDirectory(pPath);
+}
+
+void ArchiveStat(const Psarc::Archive& archive, const Psarc::Entry* entry,
+                 OrbisFiosStat* pOutStatus) {
+    const _OrbisKernelStat& stat = archive.stat;
+    pOutStatus->fileSize = entry ? entry->size : 0;
+    pOutStatus->accessDate = stat.st_atim.tv_sec;
+    pOutStatus->modificationDate = stat.st_mtim.tv_sec;
+    pOutStatus->creationDate = stat.st_birthtim.tv_sec;
+    pOutStatus->statFlags = 0;
+    pOutStatus->reserved = 0;
+    pOutStatus->uid = stat.st_uid;
+    pOutStatus->gid = stat.st_gid;
+    pOutStatus->dev = stat.st_dev;
+    pOutStatus->ino = entry ? entry - archive.entries : 0;
+    pOutStatus->mode = entry ? S_IFREG | 0444 : S_IFDIR | 0555;
+}
+
+Cache::File* GetHandleCacheFile(FileHandle& handle) {
+    if (handle.file == nullptr) {
+        handle.file = Cache::GetFile(ToApp0(handle.path.c_str()));
+    }
+    return handle.file;
+}
+
+// Must be called with m held.
+Cache::File* GetHandleCacheFile(OrbisFiosFH fh) {
+    auto it = fh_table->find(fh);
+    if (it == fh_table->end()) {
+        return nullptr;
+    }
+    return GetHandleCacheFile(it->second);
+}
+
+// Serves the read from the read cache when the whole range is resident, otherwise goes to the
+// kernel as a demand read, shared with any identical read already in flight.
+s64 CachedPread(Cache::File* file, s32 fd, void* pBuf, OrbisFiosSize length,
+                OrbisFiosOffset offset) {
+    if (file) {
+        s64 ret = Cache::Read(file, pBuf, length, offset);
+        if (ret >= 0) {
+            return ret;
+        }
+        return SingleFlight::Pread(file, fd, pBuf, length, offset);
+    }
+    IoQueue::DemandReadScope demand;
+    return sceKernelPread(fd, pBuf, length, offset);
+}
+
+// Serves a path-based read from the blob store, loading the file into it if it qualifies. Returns
+// -1 if the file isn't stored there. length must not be negative.
+s64 BlobRead(Cache::File* file, void* pBuf, OrbisFiosSize length, OrbisFiosOffset offset) {
+    u64 size;
+    const u8* data = Config::Get().blob_store ? BlobStore::Load(file, &size) : nullptr;
+    if (data == nullptr || offset < 0) {
+        return -1;
+    }
+    if (static_cast<u64>(offset) >= size) {
+        return 0;
+    }
+    const u64 bytes = std::min<u64>(length, size - offset);
+    std::memcpy(pBuf, data + offset, bytes);
+    return bytes;
+}
+
+// Reads a file by path: from entry of archive if it lives in a mounted one, otherwise from the
+// blob store, the read cache or the kernel. Returns the bytes read or an error, -1 if the file
+// couldn't be opened. Doesn't need m.
+s64 PathPread(const char* pPath, const Psarc::Archive* archive, u32 entry, void* pBuf,
+              OrbisFiosSize length, OrbisFiosOffset offset) {
+    if (length < 0) {
+        return ORBIS_FIOS_ERROR_BAD_SIZE;
+    }
+    s64 ret = -1;
+    Cache::File* file = archive ? nullptr : Cache::GetFile(ToApp0(pPath));
+    if (archive && offset >= 0) {
+        ret = Psarc::Read(*archive, entry, pBuf, length, offset);
+    }
+    if (file) {
+        ret = BlobRead(file, pBuf, length, offset);
+    }
+    if (file && ret < 0) {
+        ret = Cache::Read(file, pBuf, length, offset);
+    }
+    if (ret < 0) {
+        s32 fd = sceKernelOpen(ToApp0(pPath), O_RDONLY, 0);
+
+        if (fd >= 0) {
+            ret = file ? SingleFlight::Pread(file, fd, pBuf, length, offset)
+                       : CachedPread(nullptr, fd, pBuf, length, offset);
+            sceKernelClose(fd);
+        }
+    }
+    return ret;
+}
+
+// Records a read that returned ret in the access trace, if one is being recorded. Must be called
+// with m held.
+void TraceRead(const FileHandle& handle, OrbisFiosOffset offset, s64 ret) {
+    if (ret > 0 && handle.trace_path != Trace::NO_PATH) {
+        Trace::OnRead(handle.trace_path, offset, ret);
+    }
+}
+
+// Same for a read by path. There's no handle to keep the id in, Trace::Intern remembers the
+// thread's last path instead.
+void TracePathRead(const char* pPath, OrbisFiosOffset offset, s64 ret) {
+    if (ret > 0 && Trace::Enabled()) {
+        Trace::OnRead(Trace::Intern(pPath), offset, ret);
+    }
+}
+
+// Starts recording a sceFios* call, see Trace::CallScope. Initializes first, so the call that
+// starts the trace is recorded too.
+Trace::CallScope TraceCall(Trace::Api api, const char* pPath, u64 arg0 = 0, u64 arg1 = 0,
+                           u64 arg2 = 0, u64 arg3 = 0) {
+    EnsureMapsInitialized();
+    return Trace::CallScope(api, pPath, arg0, arg1, arg2, arg3);
+}
+
+u64 IovLength(const OrbisFiosBuffer iov[], int iovcnt) {
+    u64 length = 0;
+    for (int i = 0; iov != nullptr && i < iovcnt; ++i) {
+        length += iov[i].length;
+    }
+    return length;
+}
+
+// Releases m for the I/O of a read on handle, which counts as in flight until m is taken back.
+class UnlockedRead {
+public:
+    UnlockedRead(std::unique_lock<std::mutex>& l, FileHandle& handle) : l(l), handle(handle) {
+        ++handle.reads_in_flight;
+        l.unlock();
+    }
+    ~UnlockedRead() {
+        l.lock();
+        if (--handle.reads_in_flight == 0) {
+            op_done_cv.notify_all();
+        }
+    }
+    UnlockedRead(const UnlockedRead&) = delete;
+    UnlockedRead& operator=(const UnlockedRead&) = delete;
+
+private:
+    std::unique_lock<std::mutex>& l;
+    FileHandle& handle;
+};
+
+// Positional read on an open handle, feeding the handle's readahead detector. l must hold m, it is
+// released for the duration of any kernel I/O.
+s64 HandlePread(std::unique_lock<std::mutex>& l, FileHandle& handle, OrbisFiosFH fh, void* pBuf,
+                OrbisFiosSize length, OrbisFiosOffset offset) {
+    if (length < 0) {
+        return ORBIS_FIOS_ERROR_BAD_SIZE;
+    }
+    if (handle.archive) {
+        if (offset < 0) {
+            return ORBIS_FIOS_ERROR_BAD_OFFSET;
+        }
+        const Psarc::Entry& entry = handle.archive->entries[handle.entry];
+        const u64 stream_blocks = Config::Get().stream_blocks;
+        // Tearing a stream down joins its worker, which can be in the middle of a block, so a
+        // dropped stream goes once m is released.
+        std::shared_ptr<Psarc::Stream> dropped;
+        handle.stream_streak = static_cast<u64>(offset) == handle.stream_next
+                                   ? handle.stream_streak + 1
+                                   : 0;
+        handle.stream_next = offset + length;
+        // Reads as big as the ring gain nothing from it, they already overlap their blocks'
+        // decompression (see Psarc::Read).
+        if (handle.stream_streak < Psarc::Stream::CONFIRM_READS || stream_blocks == 0 ||
+            static_cast<u64>(length) >= stream_blocks * handle.archive->block_size) {
+            dropped = std::move(handle.stream);
+        } else if (!handle.stream && entry.size > handle.archive->block_size) {
+            handle.stream = std::make_shared<Psarc::Stream>(handle.archive, handle.entry, offset,
+                                                            static_cast<u32>(stream_blocks));
+        }
+        std::shared_ptr<Psarc::Stream> stream = handle.stream;
+        UnlockedRead unlocked{l, handle};
+        dropped.reset();
+        const s64 ret = stream ? stream->Read(pBuf, length, offset)
+                               : Psarc::Read(*handle.archive, handle.entry, pBuf, length, offset);
+        // Another read on the handle may have dropped its stream meanwhile, leaving the last
+        // reference here.
+        stream.reset();
+        return ret;
+    }
+    if (handle.mapping) {
+        if (offset < 0) {
+            return ORBIS_FIOS_ERROR_BAD_OFFSET;
+        }
+        if (static_cast<u64>(offset) >= handle.mapping_size) {
+            return 0;
+        }
+        const u64 bytes = std::min<u64>(length, handle.mapping_size - offset);
+        // Faulting in a cold mapping is disk I/O like any other.
+        UnlockedRead unlocked{l, handle};
+        std::memcpy(pBuf, handle.mapping + offset, bytes);
+        return bytes;
+    }
+    Cache::File* file = GetHandleCacheFile(handle);
+    const Config::Options& options = Config::Get();
+    s64 ret = file ? Cache::Read(file, pBuf, length, offset) : -1;
+    if (ret < 0 && file && options.readahead && handle.readahead.Sequential() &&
+        length < static_cast<OrbisFiosSize>(Cache::BLOCK_SIZE)) {
+        // A small read that ran ahead of the readahead: pull in whole blocks rather than issuing
+        // one syscall per small read until the readahead catches up.
+        IoQueue::DemandReadScope demand;
+        UnlockedRead unlocked{l, handle};
+        ret = Cache::ReadThrough(file, fh, pBuf, length, offset);
+    }
+    if (ret < 0) {
+        UnlockedRead unlocked{l, handle};
+        ret = file ? SingleFlight::Pread(file, fh, pBuf, length, offset)
+                   : CachedPread(nullptr, fh, pBuf, length, offset);
+    }
+    if (file && options.readahead && ret > 0) {
+        handle.readahead.OnRead(offset, ret, options.readahead_max_window,
+                                [file](u64 start, u64 bytes) {
+                                    Cache::Readahead(file, start, bytes);
+                                });
+    }
+    return ret;
+}
+
+void CompleteChunkedRead(OrbisFiosOp op, PendingRead& read) {
+    s64 ret = read.length;
+    if (read.failed_at != ~0ULL) {
+        // Like a short pread: the bytes before the first hole, or the error if there are none.
+        ret = read.failed_at > 0 || read.error == 0 ? static_cast<s64>(read.failed_at) : read.error;
+        LOG_ERROR(Ops, "len: {}, ret: {}", read.length, ret);
+    }
+    {
+        std::scoped_lock l{m};
+        pending_reads->erase(op);
+        op_io_return_codes_map->emplace(op, ret);
+        auto it = fh_table->find(read.fh);
+        if (it != fh_table->end()) {
+            --it->second.reads_in_flight;
+        }
+        op_done_cv.notify_all();
+    }
+    CallFiosCallback(&read.attr, op, OrbisFiosOpEvents::Complete, ret);
+}
+
+void RunReadChunk(OrbisFiosOp op, const std::shared_ptr<PendingRead>& read, s32 fd, u8* pBuf,
+                  u64 offset, u64 chunk_start, u64 chunk_length) {
+    IoQueue::DemandReadScope demand;
+    u64 done = 0;
+    s64 ret = 0;
+    while (done < chunk_length) {
+        ret = sceKernelPread(fd, pBuf + chunk_start + done, chunk_length - done,
+                             offset + chunk_start + done);
+        if (ret <= 0) {
+            break;
+        }
+        done += ret;
+        read->done_bytes.fetch_add(ret, std::memory_order_relaxed);
+    }
+    if (done < chunk_length) {
+        std::scoped_lock l{read->failure_mutex};
+        if (chunk_start + done < read->failed_at) {
+            read->failed_at = chunk_start + done;
+            read->error = ret < 0 ? ret : 0;
+        }
+    }
+    if (read->chunks_left.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        CompleteChunkedRead(op, *read);
+    }
+}
+
+// Splits a large read on an open handle into chunks and queues them on the I/O workers. Returns the
+// op, or 0 if the read should be done inline (small, mapped, resident or invalid). Must be called
+// with m held.
+OrbisFiosOp SubmitChunkedRead(const OrbisFiosOpAttr* pAttr, FileHandle& handle, OrbisFiosFH fh,
+                              void* pBuf, OrbisFiosSize length, OrbisFiosOffset offset) {
+    const Config::Options& options = Config::Get();
+    if (!options.chunked_reads || options.chunk_size == 0 ||
+        length < static_cast<OrbisFiosSize>(options.chunked_read_threshold) || handle.mapping ||
+        handle.archive || pBuf == nullptr || offset < 0) {
+        return 0;
+    }
+    Cache::File* file = GetHandleCacheFile(handle);
+    if (file == nullptr || offset >= Cache::GetFileSize(file)) {
+        return 0;
+    }
+    const u64 bytes = std::min<u64>(length, Cache::GetFileSize(file) - offset);
+    if (Cache::Contains(file, offset, bytes)) {
+        return 0;
+    }
+
+    auto read = std::make_shared<PendingRead>();
+    read->attr = pAttr ? *pAttr : OrbisFiosOpAttr{};
+    read->fh = fh;
+    read->length = bytes;
+    const u64 num_chunks = (bytes + options.chunk_size - 1) / options.chunk_size;
+    read->chunks_left.store(static_cast<u32>(num_chunks), std::memory_order_relaxed);
+    OrbisFiosOp op = ++op_count;
+    pending_reads->emplace(op, read);
+    ++handle.reads_in_flight;
+    LOG_DEBUG(Ops, "fh: {}, {:#x} bytes at {:#x} in {} chunks, op: {}", fh, bytes, offset,
+              num_chunks, op);
+    for (u64 start = 0; start < bytes; start += options.chunk_size) {
+        const u64 chunk_length = std::min<u64>(options.chunk_size, bytes - start);
+        IoQueue::Submit(IoQueue::Priority::Demand, [=] {
+            RunReadChunk(op, read, fh, static_cast<u8*>(pBuf), offset, start, chunk_length);
+        });
+    }
+    return op;
+}
+
+// Blocks until op is no longer a pending chunked read. l must hold m.
+void WaitForPendingRead(std::unique_lock<std::mutex>& l, OrbisFiosOp op) {
+    op_done_cv.wait(l, [op] { return pending_reads->count(op) == 0; });
+}
+
+constexpr int KERNEL_IOV_MAX = 1024; // IOV_MAX on the FreeBSD kernel, the most one call takes
+// Scatter lists up to this long are converted on the stack, longer ones on the heap.
+constexpr int IOV_STACK = 64;
+static_assert(IOV_STACK <= KERNEL_IOV_MAX);
+
+// The I/O of HandlePreadv. file is the handle's cache file, resolved while m was held.
+s64 ReadSegments(const FileHandle* handle, Cache::File* file, OrbisFiosFH fh,
+                 const OrbisFiosBuffer iov[], int iovcnt, OrbisFiosOffset offset) {
+    s64 total = 0;
+    int i = 0;
+    if (handle && handle->archive) {
+        for (; i < iovcnt; ++i) {
+            s64 ret = Psarc::Read(*handle->archive, handle->entry, iov[i].pPtr, iov[i].length,
+                                  offset + total);
+            if (ret < 0) {
+                return total > 0 ? total : ret;
+            }
+            total += ret;
+            if (static_cast<u64>(ret) < iov[i].length) {
+                break;
+            }
+        }
+        return total;
+    }
+    if (handle) {
+        for (; i < iovcnt; ++i) {
+            const u64 pos = offset + total;
+            s64 ret;
+            if (handle->mapping) {
+                ret = pos < handle->mapping_size
+                          ? std::min<u64>(iov[i].length, handle->mapping_size - pos)
+                          : 0;
+                if (ret > 0) {
+                    std::memcpy(iov[i].pPtr, handle->mapping + pos, ret);
+                }
+            } else if (iov[i].length == 0) {
+                continue;
+            } else if (file == nullptr || (ret = Cache::Read(file, iov[i].pPtr, iov[i].length,
+                                                             pos)) < 0) {
+                break;
+            }
+            total += ret;
+            if (static_cast<u64>(ret) < iov[i].length) {
+                return total; // end of file
+            }
+        }
+    }
+    if (i == iovcnt) {
+        return total;
+    }
+
+    IoQueue::DemandReadScope demand;
+    OrbisKernelIovec stack_batch[IOV_STACK];
+    std::vector<OrbisKernelIovec> heap_batch;
+    OrbisKernelIovec* batch = stack_batch;
+    if (iovcnt - i > IOV_STACK) {
+        heap_batch.resize(std::min(iovcnt - i, KERNEL_IOV_MAX));
+        batch = heap_batch.data();
+    }
+    while (i < iovcnt) {
+        const int count = std::min(iovcnt - i, KERNEL_IOV_MAX);
+        u64 batch_bytes = 0;
+        for (int j = 0; j < count; ++j) {
+            batch[j].base = iov[i + j].pPtr;
+            batch[j].len = static_cast<std::size_t>(iov[i + j].length);
+            batch_bytes += iov[i + j].length;
+        }
+        s64 ret = sceKernelPreadv(fh, batch, count, offset + total);
+        if (ret < 0) {
+            return total > 0 ? total : ret;
+        }
+        total += ret;
+        if (static_cast<u64>(ret) < batch_bytes) {
+            break;
+        }
+        i += count;
+    }
+    return total;
+}
+
+// Vectored positional read. handle is null for descriptors FIOS didn't open. Leading segments are
+// served from the mapping or the read cache where possible, the rest goes to sceKernelPreadv. l
+// must hold m; for FIOS handles it is released for the I/O, as in HandlePread.
+s64 HandlePreadv(std::unique_lock<std::mutex>& l, FileHandle* handle, OrbisFiosFH fh,
+                 const OrbisFiosBuffer iov[], int iovcnt, OrbisFiosOffset offset) {
+    if (iovcnt < 0 || (iovcnt > 0 && iov == nullptr)) {
+        return ORBIS_FIOS_ERROR_BAD_IOVCNT;
+    }
+    if (offset < 0) {
+        return ORBIS_FIOS_ERROR_BAD_OFFSET;
+    }
+    if (handle == nullptr) {
+        return ReadSegments(nullptr, nullptr, fh, iov, iovcnt, offset);
+    }
+    Cache::File* file =
+        handle->archive || handle->mapping ? nullptr : GetHandleCacheFile(*handle);
+    UnlockedRead unlocked{l, *handle};
+    return ReadSegments(handle, file, fh, iov, iovcnt, offset);
+}
+
+// Adds the handle for a new fh, replacing whatever a closed one left behind. Must be called with m
+// held.
+FileHandle& AddHandle(OrbisFiosFH fh, const char* pPath, Cache::File* file = nullptr) {
+    FileHandle& handle = fh_table->insert_or_assign(fh, FileHandle{pPath, file}).first->second;
+    if (Trace::Enabled()) {
+        handle.trace_path = Trace::Intern(pPath);
+    }
+    return handle;
+}
+
+// Opens a read-only file inside a mounted archive, or from the blob store if it's small enough to
+// live there. Returns the new virtual handle, or -1 to open it through the kernel as usual. Must be
+// called with m held.
+OrbisFiosFH OpenVirtualHandle(const char* pPath) {
+    u32 entry;
+    if (auto archive = FindArchiveFile(pPath, &entry)) {
+        OrbisFiosFH fh = VIRTUAL_FH_BASE + virtual_fh_count++;
+        FileHandle& handle = AddHandle(fh, pPath);
+        handle.archive = std::move(archive);
+        handle.entry = entry;
+        return fh;
+    }
+    if (!Config::Get().blob_store) {
+        return -1;
+    }
+    Cache::File* file = Cache::GetFile(ToApp0(pPath));
+    u64 size;
+    const u8* data = file ? BlobStore::Load(file, &size) : nullptr;
+    if (data == nullptr) {
+        return -1;
+    }
+    OrbisFiosFH fh = VIRTUAL_FH_BASE + virtual_fh_count++;
+    FileHandle& handle = AddHandle(fh, pPath, file);
+    handle.mapping = data;
+    handle.mapping_size = size;
+    handle.blob = true;
+    return fh;
+}
+
+// Maps read-only files above the configured size threshold so reads become a memcpy.
+void MapHandle(FileHandle& handle, s32 fd) {
+    const Config::Options& options = Config::Get();
+    _OrbisKernelStat sb{};
+    if (!options.mmap || sceKernelFstat(fd, (OrbisKernelStat*)&sb) != ORBIS_OK ||
+        sb.st_size <= 0 || static_cast<u64>(sb.st_size) < options.mmap_threshold) {
+        return;
+    }
+    void* addr = nullptr;
+    s32 ret = sceKernelMmap(nullptr, sb.st_size, PROT_READ, MAP_SHARED, fd, 0, &addr);
+    if (ret != ORBIS_OK) {
+        LOG_WARNING(Handles, "Failed to map {} ({:#x} bytes): {:#x}", handle.path, sb.st_size, ret);
+        return;
+    }
+    LOG_INFO(Handles, "Mapped {} ({:#x} bytes)", handle.path, sb.st_size);
+    handle.mapping = static_cast<const u8*>(addr);
+    handle.mapping_size = sb.st_size;
+}
+
+void UnmapHandle(FileHandle& handle) {
+    if (handle.mapping) {
+        sceKernelMunmap(const_cast<u8*>(handle.mapping), handle.mapping_size);
+        handle.mapping = nullptr;
+        handle.mapping_size = 0;
+    }
+}
+
+OrbisFiosOp PrefetchOp(const OrbisFiosOpAttr* pAttr, Cache::File* file, s32 err,
+                       OrbisFiosOffset offset, OrbisFiosSize length) {
+    OrbisFiosOp op = ++op_count;
+    if (file && (offset < 0 || length < 0)) {
+        file = nullptr;
+        err = offset < 0 ? ORBIS_FIOS_ERROR_BAD_OFFSET : ORBIS_FIOS_ERROR_BAD_SIZE;
+    }
+    if (file == nullptr) {
+        LOG_ERROR(Cache, "Prefetch failed: {:#x}", err);
+        op_return_codes_map->emplace(op, err);
+        CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, err);
+        return op;
+    }
+    // The op reports success as soon as the prefetch is queued, the callback fires once the range
+    // is actually resident.
+    op_return_codes_map->emplace(op, ORBIS_OK);
+    OrbisFiosOpAttr attr = pAttr ? *pAttr : OrbisFiosOpAttr{};
+    Cache::Prefetch(file, offset, length, [attr, op](s32 ret) {
+        CallFiosCallback(&attr, op, OrbisFiosOpEvents::Complete, ret);
+    });
+    return op;
+}
+
+s32 PrefetchSync(Cache::File* file, s32 err, OrbisFiosOffset offset, OrbisFiosSize length) {
+    if (file == nullptr) {
+        LOG_ERROR(Cache, "Prefetch failed: {:#x}", err);
+        return err;
+    }
+    if (offset < 0) {
+        return ORBIS_FIOS_ERROR_BAD_OFFSET;
+    }
+    if (length < 0) {
+        return ORBIS_FIOS_ERROR_BAD_SIZE;
+    }
+    return Cache::PrefetchSync(file, offset, length);
+}
+
 u8 sceFiosArchiveGetDecompressorThreadCount() {
-    LOG_ERROR("(STUBBED) called");
-    return 1;
+    return static_cast<u8>(Decompressor::GetThreadCount());
 }
 
 OrbisFiosOp sceFiosArchiveGetMountBufferSize(const OrbisFiosOpAttr* pAttr, const char* pArchivePath,
                                              const OrbisFiosOpenParams* pOpenParams) {
-    LOG_ERROR("(STUBBED) called");
-    // code
+    EnsureMapsInitialized();
+    s64 size = ORBIS_FIOS_ERROR_BAD_PATH;
+    if (pArchivePath) {
+        const char* path = ToApp0(pArchivePath);
+        _OrbisKernelStat stat{};
+        // A missing archive is served from loose files and needs no buffer, see
+        // sceFiosArchiveMount.
+        size = sceKernelStat(path, (OrbisKernelStat*)&stat) == ORBIS_OK ? Psarc::GetIndexSize(path)
+                                                                          : 0;
+    }
+    LOG_INFO(Archive, "called, archive: {}, size: {:#x}", pArchivePath ? pArchivePath : "(null)",
+             size);
+    std::scoped_lock l{m};
     OrbisFiosOp op = ++op_count;
-    op_return_codes_map->emplace(op, ORBIS_OK);
-    CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, ORBIS_OK);
+    op_io_return_codes_map->emplace(op, size);
+    CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, static_cast<s32>(size));
     return op;
 }
 
-s32 sceFiosArchiveGetMountBufferSizeSync(const OrbisFiosOpAttr* pAttr, const char* pArchivePath,
-                                         const OrbisFiosOpenParams* pOpenParams) {
-    LOG_ERROR("(STUBBED) called");
+OrbisFiosSize sceFiosArchiveGetMountBufferSizeSync(const OrbisFiosOpAttr* pAttr,
+                                                   const char* pArchivePath,
+                                                   const OrbisFiosOpenParams* pOpenParams) {
     OrbisFiosOp op = sceFiosArchiveGetMountBufferSize(pAttr, pArchivePath, pOpenParams);
-    return sceFiosOpSyncWait(op);
+    return sceFiosOpSyncWaitForIO(op);
 }
 
+// sceFiosArchiveMount is sceFiosArchiveMountWithOrder at order 0.
 OrbisFiosOp sceFiosArchiveMount(const OrbisFiosOpAttr* pAttr, OrbisFiosFH* pOutFH,
                                 const char* pArchivePath, const char* pMountPoint,
                                 OrbisFiosBuffer mountBuffer,
                                 const OrbisFiosOpenParams* pOpenParams) {
-    LOG_ERROR("(STUBBED) called");
-    OrbisFiosOp op = ++op_count;
-    op_return_codes_map->emplace(op, ORBIS_OK);
-    CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, ORBIS_OK);
-    return op;
+    auto call = TraceCall(Trace::Api::ArchiveMount, pArchivePath, 0, mountBuffer.length);
+    call.SetPathArg(0, pMountPoint);
+    call.SetOutHandle(pOutFH);
+    return call.Return(sceFiosArchiveMountWithOrder(pAttr, pOutFH, pArchivePath, pMountPoint,
+                                                    mountBuffer, pOpenParams, 0));
 }
 
 s32 sceFiosArchiveMountSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH* pOutFH,
                             const char* pArchivePath, const char* pMountPoint,
                             OrbisFiosBuffer mountBuffer, const OrbisFiosOpenParams* pOpenParams) {
-    LOG_ERROR("(STUBBED) called");
+    auto call = TraceCall(Trace::Api::ArchiveMountSync, pArchivePath, 0, mountBuffer.length);
+    call.SetPathArg(0, pMountPoint);
+    call.SetOutHandle(pOutFH);
     OrbisFiosOp op =
         sceFiosArchiveMount(pAttr, pOutFH, pArchivePath, pMountPoint, mountBuffer, pOpenParams);
-    return sceFiosOpSyncWait(op);
+    return call.Return(sceFiosOpSyncWait(op));
 }
 
-OrbisFiosOp sceFiosArchiveMountWithOrder() {
-    LOG_ERROR("(STUBBED) called");
-    return ORBIS_OK;
+OrbisFiosOp sceFiosArchiveMountWithOrder(const OrbisFiosOpAttr* pAttr, OrbisFiosFH* pOutFH,
+                                         const char* pArchivePath, const char* pMountPoint,
+                                         OrbisFiosBuffer mountBuffer,
+                                         const OrbisFiosOpenParams* pOpenParams, s32 order) {
+    auto call =
+        TraceCall(Trace::Api::ArchiveMount, pArchivePath, 0, mountBuffer.length, 0, order);
+    call.SetPathArg(0, pMountPoint);
+    call.SetOutHandle(pOutFH);
+    EnsureMapsInitialized();
+    LOG_INFO(Archive, "called, archive: {}, mount point: {}, order: {}", pArchivePath, pMountPoint,
+             order);
+    s32 ret = ORBIS_FIOS_ERROR_BAD_PATH;
+    Psarc::Archive* archive = nullptr;
+    if (pArchivePath && pMountPoint) {
+        std::string path;
+        {
+            std::scoped_lock l{m};
+            path = ToApp0(pArchivePath);
+        }
+        // Mounting reads the whole TOC and, with verify_archives = mount, decodes every block, so
+        // it runs without m. Only publishing the layer below needs it.
+        _OrbisKernelStat stat{};
+        if (sceKernelStat(path.c_str(), (OrbisKernelStat*)&stat) != ORBIS_OK) {
+            // Pre-extracted archive, its files are already where the game will look for them.
+            LOG_INFO(Archive, "{} not found, using loose files", path);
+            ret = ORBIS_OK;
+        } else {
+            ret = Psarc::Mount(path.c_str(), pMountPoint, &archive);
+        }
+    }
+    std::scoped_lock l{m};
+    OrbisFiosFH fh = -1;
+    if (archive) {
+        fh = VIRTUAL_FH_BASE + virtual_fh_count++;
+        const std::string& override_dir = Config::Get().override_dir;
+        if (!override_dir.empty()) {
+            std::string_view mount_point = ToApp0(pMountPoint);
+            if (mount_point.compare(0, 5, "/app0") == 0) {
+                mount_point.remove_prefix(5);
+            }
+            Override::Scan(pMountPoint, override_dir + std::string(mount_point));
+        }
+        MountTable::Add(fh, std::shared_ptr<Psarc::Archive>(archive, Psarc::Close), order);
+    }
+    if (pOutFH && fh >= 0) {
+        *pOutFH = fh;
+    }
+    OrbisFiosOp op = ++op_count;
+    op_return_codes_map->emplace(op, ret);
+    CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, ret);
+    return call.Return(op);
 }
 
-s32 sceFiosArchiveMountWithOrderSync() {
-    LOG_ERROR("(STUBBED) called");
-    return ORBIS_OK;
+s32 sceFiosArchiveMountWithOrderSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH* pOutFH,
+                                     const char* pArchivePath, const char* pMountPoint,
+                                     OrbisFiosBuffer mountBuffer,
+                                     const OrbisFiosOpenParams* pOpenParams, s32 order) {
+    auto call =
+        TraceCall(Trace::Api::ArchiveMountSync, pArchivePath, 0, mountBuffer.length, 0, order);
+    call.SetPathArg(0, pMountPoint);
+    call.SetOutHandle(pOutFH);
+    OrbisFiosOp op = sceFiosArchiveMountWithOrder(pAttr, pOutFH, pArchivePath, pMountPoint,
+                                                  mountBuffer, pOpenParams, order);
+    return call.Return(sceFiosOpSyncWait(op));
 }
 
-s32 sceFiosArchiveSetDecompressorThreadCount() {
-    LOG_ERROR("(STUBBED) called");
+s32 sceFiosArchiveSetDecompressorThreadCount(s32 threadCount) {
+    if (threadCount < 1) {
+        return ORBIS_FIOS_ERROR_BAD_SIZE;
+    }
+    Decompressor::SetThreadCount(static_cast<u32>(threadCount));
     return ORBIS_OK;
 }
 
-s32 sceFiosArchiveUnmount() {
-    LOG_ERROR("(STUBBED) called");
-    return ORBIS_OK;
+OrbisFiosOp sceFiosArchiveUnmount(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh) {
+    auto call = TraceCall(Trace::Api::ArchiveUnmount, nullptr, fh);
+    EnsureMapsInitialized();
+    std::scoped_lock l{m};
+    LOG_INFO(Archive, "called, fh: {:#x}", fh);
+    s32 ret = ORBIS_FIOS_ERROR_BAD_FH;
+    // Handles still open into the archive keep it alive, index and all.
+    if (MountTable::Remove(fh)) {
+        ret = ORBIS_OK;
+    }
+    OrbisFiosOp op = ++op_count;
+    op_return_codes_map->emplace(op, ret);
+    CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, ret);
+    return call.Return(op);
 }
 
-s32 sceFiosArchiveUnmountSync() {
-    LOG_ERROR("(STUBBED) called");
-
-    return ORBIS_OK;
+s32 sceFiosArchiveUnmountSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh) {
+    auto call = TraceCall(Trace::Api::ArchiveUnmountSync, nullptr, fh);
+    OrbisFiosOp op = sceFiosArchiveUnmount(pAttr, fh);
+    return call.Return(sceFiosOpSyncWait(op));
 }
 
-s32 sceFiosCacheContainsFileRangeSync() {
-    LOG_ERROR("(STUBBED) called");
-
-    return ORBIS_OK;
+bool sceFiosCacheContainsFileRangeSync(const OrbisFiosOpAttr* pAttr, const char* pPath,
+                                       OrbisFiosOffset startOffset, OrbisFiosSize byteCount) {
+    // Without m: games poll this every frame to decide whether a load can be done inline. Resolving
+    // the path only takes Override's shared lock, and only once some override exists.
+    EnsureMapsInitialized();
+    Cache::File* file = Cache::FindFile(ToApp0(pPath));
+    if (file == nullptr || startOffset < 0 || byteCount < 0) {
+        return false;
+    }
+    return Cache::Contains(file, startOffset, byteCount);
 }
 
-s32 sceFiosCacheContainsFileSync() {
-    LOG_ERROR("(STUBBED) called");
-
-    return ORBIS_OK;
+bool sceFiosCacheContainsFileSync(const OrbisFiosOpAttr* pAttr, const char* pPath) {
+    EnsureMapsInitialized();
+    Cache::File* file = Cache::FindFile(ToApp0(pPath));
+    if (file == nullptr) {
+        return false;
+    }
+    return Cache::Contains(file, 0, Cache::GetFileSize(file));
 }
 
-s32 sceFiosCacheFlushFileRangeSync() {
-    LOG_ERROR("(STUBBED) called");
-
+s32 sceFiosCacheFlushFileRangeSync(const OrbisFiosOpAttr* pAttr, const char* pPath,
+                                   OrbisFiosOffset startOffset, OrbisFiosSize byteCount) {
+    LOG_DEBUG(Cache, "called, path: {}, offset: {:#x}, length: {:#x}", pPath, startOffset,
+              byteCount);
+    if (startOffset < 0) {
+        return ORBIS_FIOS_ERROR_BAD_OFFSET;
+    }
+    if (byteCount < 0) {
+        return ORBIS_FIOS_ERROR_BAD_SIZE;
+    }
+    EnsureMapsInitialized();
+    if (Cache::File* file = Cache::FindFile(ToApp0(pPath))) {
+        Cache::Flush(file, startOffset, byteCount);
+    }
     return ORBIS_OK;
 }
 
-s32 sceFiosCacheFlushFileSync() {
-    LOG_ERROR("(STUBBED) called");
-
+s32 sceFiosCacheFlushFileSync(const OrbisFiosOpAttr* pAttr, const char* pPath) {
+    LOG_DEBUG(Cache, "called, path: {}", pPath);
+    EnsureMapsInitialized();
+    if (Cache::File* file = Cache::FindFile(ToApp0(pPath))) {
+        Cache::Flush(file, 0, Cache::GetFileSize(file));
+    }
     return ORBIS_OK;
 }
 
-s32 sceFiosCacheFlushSync() {
-    LOG_ERROR("(STUBBED) called");
-
+s32 sceFiosCacheFlushSync(const OrbisFiosOpAttr* pAttr) {
+    LOG_DEBUG(Cache, "called");
+    EnsureMapsInitialized();
+    Cache::FlushAll();
     return ORBIS_OK;
 }
 
-s32 sceFiosCachePrefetchFH() {
-    LOG_ERROR("(STUBBED) called");
-    return ORBIS_OK;
+OrbisFiosOp sceFiosCachePrefetchFH(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh) {
+    EnsureMapsInitialized();
+    std::scoped_lock l{m};
+    LOG_DEBUG(Cache, "called, fh: {}", fh);
+    Cache::File* file = GetHandleCacheFile(fh);
+    return PrefetchOp(pAttr, file, ORBIS_FIOS_ERROR_BAD_FH, 0, file ? Cache::GetFileSize(file) : 0);
 }
 
-s32 sceFiosCachePrefetchFHRange() {
-    LOG_ERROR("(STUBBED) called");
-    return ORBIS_OK;
+OrbisFiosOp sceFiosCachePrefetchFHRange(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh,
+                                        OrbisFiosOffset startOffset, OrbisFiosSize byteCount) {
+    EnsureMapsInitialized();
+    std::scoped_lock l{m};
+    LOG_DEBUG(Cache, "called, fh: {}, offset: {:#x}, length: {:#x}", fh, startOffset, byteCount);
+    return PrefetchOp(pAttr, GetHandleCacheFile(fh), ORBIS_FIOS_ERROR_BAD_FH, startOffset,
+                      byteCount);
 }
 
-s32 sceFiosCachePrefetchFHRangeSync() {
-    LOG_ERROR("(STUBBED) called");
-    return ORBIS_OK;
+s32 sceFiosCachePrefetchFHRangeSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh,
+                                    OrbisFiosOffset startOffset, OrbisFiosSize byteCount) {
+    LOG_DEBUG(Cache, "called, fh: {}, offset: {:#x}, length: {:#x}", fh, startOffset, byteCount);
+    Cache::File* file;
+    {
+        EnsureMapsInitialized();
+        std::scoped_lock l{m};
+        file = GetHandleCacheFile(fh);
+    }
+    return PrefetchSync(file, ORBIS_FIOS_ERROR_BAD_FH, startOffset, byteCount);
 }
 
-s32 sceFiosCachePrefetchFHSync() {
-    LOG_ERROR("(STUBBED) called");
-
-    return ORBIS_OK;
+s32 sceFiosCachePrefetchFHSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh) {
+    LOG_DEBUG(Cache, "called, fh: {}", fh);
+    Cache::File* file;
+    {
+        EnsureMapsInitialized();
+        std::scoped_lock l{m};
+        file = GetHandleCacheFile(fh);
+    }
+    return PrefetchSync(file, ORBIS_FIOS_ERROR_BAD_FH, 0, file ? Cache::GetFileSize(file) : 0);
 }
 
-s32 sceFiosCachePrefetchFile() {
-    LOG_ERROR("(STUBBED) called");
-    return ORBIS_OK;
+OrbisFiosOp sceFiosCachePrefetchFile(const OrbisFiosOpAttr* pAttr, const char* pPath) {
+    EnsureMapsInitialized();
+    std::scoped_lock l{m};
+    LOG_DEBUG(Cache, "called, path: {}", pPath);
+    Cache::File* file = Cache::GetFile(ToApp0(pPath));
+    return PrefetchOp(pAttr, file, ORBIS_FIOS_ERROR_BAD_PATH, 0,
+                      file ? Cache::GetFileSize(file) : 0);
 }
 
-s32 sceFiosCachePrefetchFileRange() {
-    LOG_ERROR("(STUBBED) called");
-    return ORBIS_OK;
+OrbisFiosOp sceFiosCachePrefetchFileRange(const OrbisFiosOpAttr* pAttr, const char* pPath,
+                                          OrbisFiosOffset startOffset, OrbisFiosSize byteCount) {
+    EnsureMapsInitialized();
+    std::scoped_lock l{m};
+    LOG_DEBUG(Cache, "called, path: {}, offset: {:#x}, length: {:#x}", pPath, startOffset,
+              byteCount);
+    return PrefetchOp(pAttr, Cache::GetFile(ToApp0(pPath)), ORBIS_FIOS_ERROR_BAD_PATH,
+                      startOffset, byteCount);
 }
 
-s32 sceFiosCachePrefetchFileRangeSync() {
-    LOG_ERROR("(STUBBED) called");
-    return ORBIS_OK;
+s32 sceFiosCachePrefetchFileRangeSync(const OrbisFiosOpAttr* pAttr, const char* pPath,
+                                      OrbisFiosOffset startOffset, OrbisFiosSize byteCount) {
+    LOG_DEBUG(Cache, "called, path: {}, offset: {:#x}, length: {:#x}", pPath, startOffset,
+              byteCount);
+    return PrefetchSync(Cache::GetFile(ToApp0(pPath)), ORBIS_FIOS_ERROR_BAD_PATH, startOffset,
+                        byteCount);
 }
 
-s32 sceFiosCachePrefetchFileSync() {
-    LOG_ERROR("(STUBBED) called");
-    return ORBIS_OK;
+s32 sceFiosCachePrefetchFileSync(const OrbisFiosOpAttr* pAttr, const char* pPath) {
+    LOG_DEBUG(Cache, "called, path: {}", pPath);
+    Cache::File* file = Cache::GetFile(ToApp0(pPath));
+    return PrefetchSync(file, ORBIS_FIOS_ERROR_BAD_PATH, 0, file ? Cache::GetFileSize(file) : 0);
 }
 
 s32 sceFiosCancelAllOps() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Ops, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosClearTimeStamps() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosCloseAllFiles() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 OrbisFiosDate sceFiosDateFromComponents(tm* pComponents) {
-    LOG_INFO("called");
+    LOG_INFO(General, "called");
     return mktime(pComponents) * 1000000000;
 }
 
 OrbisFiosDate sceFiosDateGetCurrent() {
-    LOG_INFO("called");
+    LOG_INFO(General, "called");
     return time(nullptr) * 1000000000;
 }
 
 tm* sceFiosDateToComponents(OrbisFiosDate date, tm* pOutComponents) {
-    LOG_INFO("called");
+    LOG_INFO(General, "called");
     time_t t = date / 1000000000;
     pOutComponents = gmtime(&t);
     return pOutComponents;
 }
 
 s32 sceFiosDeallocatePassthruFH() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosDebugDumpDate() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosDebugDumpDH() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosDebugDumpError() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosDebugDumpFH() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosDebugDumpOp() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Ops, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosDelete() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosDeleteSync() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosDHClose(const OrbisFiosOpAttr* pAttr, OrbisFiosDH dh) {
+    auto call = TraceCall(Trace::Api::DHClose, nullptr, dh);
     EnsureMapsInitialized();
     std::scoped_lock l{m};
-    LOG_WARNING("(STUBBED) called, dh: {}", dh);
+    LOG_WARNING(Handles, "(STUBBED) called, dh: {}", dh);
     s32 ret = sceKernelClose(dh);
     dh_path_map->erase(dh);
     OrbisFiosOp op = ++op_count;
     op_return_codes_map->emplace(op, dh);
     CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, ret);
-    return op;
+    return call.Return(op);
 }
 
 s32 sceFiosDHCloseSync(const OrbisFiosOpAttr* pAttr, OrbisFiosDH dh) {
-    LOG_DEBUG("(DUMMY) called");
+    auto call = TraceCall(Trace::Api::DHCloseSync, nullptr, dh);
+    LOG_DEBUG(Handles, "(DUMMY) called");
     OrbisFiosOp op = sceFiosDHClose(pAttr, dh);
-    return sceFiosOpSyncWait(op);
+    return call.Return(sceFiosOpSyncWait(op));
 }
 
 s32 sceFiosDHGetPath() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 OrbisFiosOp sceFiosDHOpen(const OrbisFiosOpAttr* pAttr, OrbisFiosDH* pOutDH, const char* pPath,
                           OrbisFiosBuffer buf) {
+    auto call = TraceCall(Trace::Api::DHOpen, pPath, buf.length);
+    call.SetOutHandle(pOutDH);
     EnsureMapsInitialized();
     std::scoped_lock l{m};
-    LOG_WARNING("(DUMMY) called, path: {}", pPath);
+    LOG_WARNING(Handles, "(DUMMY) called, path: {}", pPath);
 
     s32 dh = sceKernelOpen(ToApp0(pPath), O_DIRECTORY, 0);
     dh_path_map->emplace(dh, pPath);
@@ -322,19 +1078,21 @@ OrbisFiosOp sceFiosDHOpen(const OrbisFiosOpAttr* pAttr, OrbisFiosDH* pOutDH, con
     OrbisFiosOp op = ++op_count;
     op_return_codes_map->emplace(op, dh);
     CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, dh);
-    return op;
+    return call.Return(op);
 }
 
 s32 sceFiosDHOpenSync(const OrbisFiosOpAttr* pAttr, OrbisFiosDH* pOutDH, const char* pPath,
                       OrbisFiosBuffer buf) {
-    LOG_DEBUG("(DUMMY) called");
+    auto call = TraceCall(Trace::Api::DHOpenSync, pPath, buf.length);
+    call.SetOutHandle(pOutDH);
+    LOG_DEBUG(Handles, "(DUMMY) called");
     OrbisFiosOp op = sceFiosDHOpen(pAttr, pOutDH, pPath, buf);
-    return sceFiosOpSyncWait(op);
+    return call.Return(sceFiosOpSyncWait(op));
 }
 
 OrbisFiosOp sceFiosDHRead(const OrbisFiosOpAttr* pAttr, OrbisFiosDH dh,
                           OrbisFiosDirEntry* pOutEntry) {
-    LOG_WARNING("(DUMMY) called");
+    LOG_WARNING(Handles, "(DUMMY) called");
 
     UNREACHABLE_MSG("todo");
 
@@ -345,71 +1103,80 @@ OrbisFiosOp sceFiosDHRead(const OrbisFiosOpAttr* pAttr, OrbisFiosDH dh,
 }
 
 s32 sceFiosDHReadSync(const OrbisFiosOpAttr* pAttr, OrbisFiosDH dh, OrbisFiosDirEntry* pOutEntry) {
-    LOG_DEBUG("(DUMMY) called");
+    LOG_DEBUG(Handles, "(DUMMY) called");
     OrbisFiosOp op = sceFiosDHRead(pAttr, dh, pOutEntry);
     return sceFiosOpSyncWait(op);
 }
 
 s32 sceFiosDirectoryCreate() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosDirectoryCreateSync() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosDirectoryCreateWithMode() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosDirectoryCreateWithModeSync() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosDirectoryDelete() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosDirectoryDeleteSync() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 bool sceFiosDirectoryExists() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 bool sceFiosDirectoryExistsSync() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosDLLInitialize() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosDLLTerminate() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 OrbisFiosOp sceFiosExists(const OrbisFiosOpAttr* pAttr, const char* pPath, bool* pOutExists) {
-    OrbisFiosOp op = ++op_count;
+    auto call = TraceCall(Trace::Api::Exists, pPath);
+    OrbisFiosOp op;
     s32 ret;
     {
         EnsureMapsInitialized();
         std::scoped_lock l{m};
+        op = ++op_count;
         std::string path_str = std::string(ToApp0(pPath));
         auto cache_it = file_stat_map->find(path_str);
-        if (cache_it == file_stat_map->end()) /* no cache hit */ {
-            LOG_INFO("(DUMMY) called pAttr: {} path: {}", (void*)pAttr, pPath);
+        u32 entry;
+        if (FindArchiveFile(pPath, &entry) || FindArchiveDirectory(pPath)) {
+            if (pOutExists) {
+                *pOutExists = true;
+            }
+            ret = 1;
+            op_return_codes_map->emplace(op, ret);
+        } else if (cache_it == file_stat_map->end()) /* no cache hit */ {
+            LOG_INFO(Paths, "(DUMMY) called pAttr: {} path: {}", (void*)pAttr, pPath);
             _OrbisKernelStat stat{};
             bool exists = (sceKernelStat(ToApp0(pPath), (OrbisKernelStat*)&stat) == ORBIS_OK);
             if (pOutExists) {
@@ -428,76 +1195,107 @@ OrbisFiosOp sceFiosExists(const OrbisFiosOpAttr* pAttr, const char* pPath, bool*
         }
     }
     CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, ret);
-    // LOG_DEBUG("ret: {}, op: {}", ret, op);
-    return op;
+    // LOG_DEBUG(Paths, "ret: {}, op: {}", ret, op);
+    return call.Return(op);
 }
 
 bool sceFiosExistsSync(const OrbisFiosOpAttr* pAttr, const char* pPath) {
-    // LOG_DEBUG("(DUMMY) called");
+    auto call = TraceCall(Trace::Api::ExistsSync, pPath);
+    // LOG_DEBUG(Paths, "(DUMMY) called");
     if (pAttr && pAttr->pCallback) {
-        LOG_WARNING("There is a callback to a sync function!");
+        LOG_WARNING(Paths, "There is a callback to a sync function!");
     }
     OrbisFiosOp op = sceFiosExists(pAttr, pPath, nullptr);
-    return static_cast<bool>(sceFiosOpSyncWait(op));
+    return call.Return(static_cast<bool>(sceFiosOpSyncWait(op)));
 }
 
 s32 sceFiosFHClose(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh) {
+    auto call = TraceCall(Trace::Api::FHClose, nullptr, fh);
     EnsureMapsInitialized();
-    std::scoped_lock l{m};
-    LOG_WARNING("(DUMMY) called pAttr: {} fh: {}", (void*)pAttr, fh);
+    // Destroyed after l, see HandlePread.
+    std::shared_ptr<Psarc::Stream> stream;
+    std::unique_lock l{m};
+    LOG_WARNING(Handles, "(DUMMY) called pAttr: {} fh: {}", (void*)pAttr, fh);
+    op_done_cv.wait(l, [fh] {
+        auto it = fh_table->find(fh);
+        return it == fh_table->end() || it->second.reads_in_flight == 0;
+    });
     OrbisFiosOp op = ++op_count;
-    s32 ret = sceKernelClose(fh);
+    s32 ret;
+    auto it = fh_table->find(fh);
+    if (it != fh_table->end() && it->second.IsVirtual()) {
+        stream = std::move(it->second.stream);
+        fh_table->erase(it);
+        ret = ORBIS_OK;
+    } else {
+        if (it != fh_table->end()) {
+            UnmapHandle(it->second);
+            fh_table->erase(it);
+        }
+        ret = sceKernelClose(fh);
+    }
     op_return_codes_map->emplace(op, ret);
-    fh_path_map->erase(fh);
     CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, ret);
-    return op;
+    return call.Return(op);
 }
 
 s32 sceFiosFHCloseSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh) {
-    LOG_WARNING("(DUMMY) called");
+    auto call = TraceCall(Trace::Api::FHCloseSync, nullptr, fh);
+    LOG_WARNING(Handles, "(DUMMY) called");
     if (pAttr && pAttr->pCallback) {
-        LOG_WARNING("There is a callback to a sync function!");
+        LOG_WARNING(Handles, "There is a callback to a sync function!");
     }
     OrbisFiosOp op = sceFiosFHClose(pAttr, fh);
-    return sceFiosOpSyncWait(op);
+    return call.Return(sceFiosOpSyncWait(op));
 }
 
 s32 sceFiosFHGetOpenParams() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 const char* sceFiosFHGetPath(OrbisFiosFH fh) {
     EnsureMapsInitialized();
     std::scoped_lock l{m};
-    LOG_WARNING("(DUMMY) called");
+    LOG_WARNING(Handles, "(DUMMY) called");
 
-    auto it = fh_path_map->find(fh);
-    if (it != fh_path_map->end()) {
-        return it->second.c_str();
+    auto it = fh_table->find(fh);
+    if (it != fh_table->end()) {
+        return it->second.path.c_str();
     }
-    LOG_ERROR("Invalid FH: {}", fh);
+    LOG_ERROR(Handles, "Invalid FH: {}", fh);
     return nullptr;
 }
 
 OrbisFiosSize sceFiosFHGetSize(OrbisFiosFH fh) {
+    auto call = TraceCall(Trace::Api::FHGetSize, nullptr, fh);
     EnsureMapsInitialized();
     std::scoped_lock l{m};
-    LOG_WARNING("(DUMMY) called, fh: {}", (u32)fh);
+    LOG_WARNING(Handles, "(DUMMY) called, fh: {}", (u32)fh);
     if (!sceFiosIsValidHandle(fh)) {
-        return -1;
+        return call.Return(-1);
+    }
+    auto it = fh_table->find(fh);
+    if (it != fh_table->end() && it->second.archive) {
+        return call.Return(it->second.archive->entries[it->second.entry].size);
+    }
+    if (it != fh_table->end() && it->second.mapping) {
+        return call.Return(it->second.mapping_size);
     }
     _OrbisKernelStat sb{};
     sceKernelFstat(fh, (OrbisKernelStat*)&sb);
-    return sb.st_size;
+    return call.Return(sb.st_size);
 }
 
 OrbisFiosOp sceFiosFHOpenWithMode(const OrbisFiosOpAttr* pAttr, OrbisFiosFH* pOutFH,
                                   const char* pPath, const OrbisFiosOpenParams* pOpenParams,
                                   s32 nativeMode) {
+    auto call = TraceCall(Trace::Api::FHOpen, pPath, pOpenParams ? pOpenParams->openFlags : 1,
+                          nativeMode);
+    call.SetOutHandle(pOutFH);
     EnsureMapsInitialized();
     std::scoped_lock l{m};
-    LOG_DEBUG("(DUMMY) called, path: {}", pPath);
+    LOG_DEBUG(Handles, "(DUMMY) called, path: {}", pPath);
     s32 open_params = pOpenParams ? pOpenParams->openFlags : 1;
     u32 open_param = 1;
     if ((open_params & 3) != 2) {
@@ -512,11 +1310,21 @@ OrbisFiosOp sceFiosFHOpenWithMode(const OrbisFiosOpAttr* pAttr, OrbisFiosFH* pOu
     if (uVar2 != 0) {
         mode = nativeMode == -1 ? 0x1ff : nativeMode;
     }
-    s32 fh = sceKernelOpen(ToApp0(pPath),
-                           (open_params & 0x1000) << 4 | (open_params << 6) & 0x400 |
-                               (open_params << 6) & 0x200 | (open_params << 1) & 8 | open_param,
+    const bool read_only = open_param == 0 && (open_params & 0x1000) == 0;
+    s32 fh = read_only ? OpenVirtualHandle(pPath) : -1;
+    if (fh < 0) {
+        fh = sceKernelOpen(ToApp0(pPath),
+                           (open_params & 0x1000) << 4 | ((open_params << 6) & 0x400) |
+                               ((open_params << 6) & 0x200) | ((open_params << 1) & 8) |
+                               open_param,
                            mode);
-    fh_path_map->emplace(fh, pPath);
+    }
+    if (fh >= 0 && fh < VIRTUAL_FH_BASE) {
+        FileHandle& handle = AddHandle(fh, pPath);
+        if (read_only) {
+            MapHandle(handle, fh);
+        }
+    }
     if (pOutFH) {
         *pOutFH = fh;
     }
@@ -525,243 +1333,365 @@ OrbisFiosOp sceFiosFHOpenWithMode(const OrbisFiosOpAttr* pAttr, OrbisFiosFH* pOu
 
     op_return_codes_map->emplace(op, ret);
 
-    LOG_INFO("ret: {}, op: {}, fh: {}", ret, op, fh);
+    LOG_INFO(Handles, "ret: {}, op: {}, fh: {}", ret, op, fh);
     CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, ret);
     // pros: it fixes a race condition in GRR
     // cons: I don't know why it works
     std::this_thread::sleep_for(std::chrono::nanoseconds(2));
-    return op;
+    return call.Return(op);
 }
 
 s32 sceFiosFHOpenWithModeSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH* pOutFH, const char* pPath,
                               const OrbisFiosOpenParams* pOpenParams, s32 nativeMode) {
-    LOG_DEBUG("(DUMMY) called");
+    auto call = TraceCall(Trace::Api::FHOpenSync, pPath, pOpenParams ? pOpenParams->openFlags : 1,
+                          nativeMode);
+    call.SetOutHandle(pOutFH);
+    LOG_DEBUG(Handles, "(DUMMY) called");
     if (pAttr && pAttr->pCallback) {
-        LOG_WARNING("There is a callback to a sync function!");
+        LOG_WARNING(Handles, "There is a callback to a sync function!");
     }
     OrbisFiosOp op = sceFiosFHOpenWithMode(pAttr, pOutFH, pPath, pOpenParams, nativeMode);
-    return sceFiosOpSyncWait(op);
+    return call.Return(sceFiosOpSyncWait(op));
 }
 
 OrbisFiosOp sceFiosFHOpen(const OrbisFiosOpAttr* pAttr, OrbisFiosFH* pOutFH, const char* pPath,
                           const OrbisFiosOpenParams* pOpenParams) {
-    LOG_WARNING("(DUMMY) called");
-    return sceFiosFHOpenWithMode(pAttr, pOutFH, pPath, pOpenParams, -1);
+    auto call = TraceCall(Trace::Api::FHOpen, pPath, pOpenParams ? pOpenParams->openFlags : 1, -1);
+    call.SetOutHandle(pOutFH);
+    LOG_WARNING(Handles, "(DUMMY) called");
+    return call.Return(sceFiosFHOpenWithMode(pAttr, pOutFH, pPath, pOpenParams, -1));
 }
 
 s32 sceFiosFHOpenSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH* pOutFH, const char* pPath,
                       const OrbisFiosOpenParams* pOpenParams) {
-    LOG_DEBUG("(DUMMY) called");
+    auto call = TraceCall(Trace::Api::FHOpenSync, pPath, pOpenParams ? pOpenParams->openFlags : 1,
+                          -1);
+    call.SetOutHandle(pOutFH);
+    LOG_DEBUG(Handles, "(DUMMY) called");
     if (pAttr && pAttr->pCallback) {
-        LOG_WARNING("There is a callback to a sync function!");
+        LOG_WARNING(Handles, "There is a callback to a sync function!");
     }
     OrbisFiosOp op = sceFiosFHOpen(pAttr, pOutFH, pPath, pOpenParams);
-    return sceFiosOpSyncWait(op);
+    return call.Return(sceFiosOpSyncWait(op));
 }
 
 OrbisFiosOp sceFiosFHPread(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh, void* pBuf,
                            OrbisFiosSize length, OrbisFiosOffset offset) {
+    auto call = TraceCall(Trace::Api::FHPread, nullptr, fh, length, offset);
     EnsureMapsInitialized();
-    std::scoped_lock l{m};
-    // LOG_WARNING("(DUMMY) called, fh: {}, length: {}, offset: {}", fh,
+    std::unique_lock l{m};
+    // LOG_WARNING(Handles, "(DUMMY) called, fh: {}, length: {}, offset: {}", fh,
     // length);
-    OrbisFiosSize ret = sceKernelPread(fh, pBuf, length, offset);
+    OrbisFiosSize ret;
+    auto it = fh_table->find(fh);
+    if (it != fh_table->end()) {
+        if (OrbisFiosOp op = SubmitChunkedRead(pAttr, it->second, fh, pBuf, length, offset)) {
+            TraceRead(it->second, offset, pending_reads->at(op)->length);
+            return call.Return(op);
+        }
+        ret = HandlePread(l, it->second, fh, pBuf, length, offset);
+        TraceRead(it->second, offset, ret);
+    } else {
+        ret = CachedPread(nullptr, fh, pBuf, length, offset);
+    }
     OrbisFiosOp op = ++op_count;
     op_io_return_codes_map->emplace(op, ret);
-    // LOG_DEBUG("fh: {}, ret: {}, op: {}", fh, ret, op);
+    // LOG_DEBUG(Handles, "fh: {}, ret: {}, op: {}", fh, ret, op);
     if (ret != length) {
-        LOG_ERROR("len: {}, ret: {}", length, ret);
+        LOG_ERROR(Handles, "len: {}, ret: {}", length, ret);
     }
     CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, ret);
-    return op;
+    return call.Return(op);
 }
 
 s32 sceFiosFHPreadSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh, void* pBuf,
                        OrbisFiosSize length, OrbisFiosOffset offset) {
-    // LOG_DEBUG("(DUMMY) called");
+    auto call = TraceCall(Trace::Api::FHPreadSync, nullptr, fh, length, offset);
+    // LOG_DEBUG(Handles, "(DUMMY) called");
     if (pAttr && pAttr->pCallback) {
-        LOG_WARNING("There is a callback to a sync function!");
+        LOG_WARNING(Handles, "There is a callback to a sync function!");
     }
     OrbisFiosOp op = sceFiosFHPread(pAttr, fh, pBuf, length, offset);
-    return sceFiosOpSyncWaitForIO(op);
+    return call.Return(sceFiosOpSyncWaitForIO(op));
 }
 
-s32 sceFiosFHPreadv() {
-    LOG_ERROR("(STUBBED) called");
-    return ORBIS_OK;
+OrbisFiosOp sceFiosFHPreadv(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh,
+                            const OrbisFiosBuffer iov[], int iovcnt, OrbisFiosOffset offset) {
+    auto call =
+        TraceCall(Trace::Api::FHPreadv, nullptr, fh, IovLength(iov, iovcnt), offset, iovcnt);
+    EnsureMapsInitialized();
+    std::unique_lock l{m};
+    LOG_DEBUG(Handles, "called, fh: {}, iovcnt: {}, offset: {:#x}", fh, iovcnt, offset);
+    auto it = fh_table->find(fh);
+    s64 ret =
+        HandlePreadv(l, it != fh_table->end() ? &it->second : nullptr, fh, iov, iovcnt, offset);
+    if (it != fh_table->end()) {
+        TraceRead(it->second, offset, ret);
+    }
+    OrbisFiosOp op = ++op_count;
+    op_io_return_codes_map->emplace(op, ret);
+    CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, ret);
+    return call.Return(op);
 }
 
-s32 sceFiosFHPreadvSync() {
-    LOG_ERROR("(STUBBED) called");
-    return ORBIS_OK;
+OrbisFiosSize sceFiosFHPreadvSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh,
+                                  const OrbisFiosBuffer iov[], int iovcnt,
+                                  OrbisFiosOffset offset) {
+    auto call =
+        TraceCall(Trace::Api::FHPreadvSync, nullptr, fh, IovLength(iov, iovcnt), offset, iovcnt);
+    if (pAttr && pAttr->pCallback) {
+        LOG_WARNING(Handles, "There is a callback to a sync function!");
+    }
+    OrbisFiosOp op = sceFiosFHPreadv(pAttr, fh, iov, iovcnt, offset);
+    return call.Return(sceFiosOpSyncWaitForIO(op));
 }
 
 s32 sceFiosFHPwrite() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosFHPwriteSync() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosFHPwritev() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosFHPwritevSync() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 OrbisFiosOp sceFiosFHRead(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh, void* pBuf,
                           OrbisFiosSize length) {
+    auto call = TraceCall(Trace::Api::FHRead, nullptr, fh, length);
     EnsureMapsInitialized();
-    std::scoped_lock l{m};
-    // LOG_WARNING("(DUMMY) called, fh: {}, length: {:#x}", fh, (u64)length);
-    OrbisFiosSize ret = sceKernelRead(fh, pBuf, length);
+    std::unique_lock l{m};
+    // LOG_WARNING(Handles, "(DUMMY) called, fh: {}, length: {:#x}", fh, (u64)length);
+    OrbisFiosSize ret;
+    auto it = fh_table->find(fh);
+    if (it != fh_table->end()) {
+        // Reads are positional against our own file position, so they can go through the cache.
+        FileHandle& handle = it->second;
+        if (OrbisFiosOp op =
+                SubmitChunkedRead(pAttr, handle, fh, pBuf, length, handle.position)) {
+            // The chunks can't run past the end of the file, so only a failed chunk makes the
+            // final count come up short of this.
+            TraceRead(handle, handle.position, pending_reads->at(op)->length);
+            handle.position += pending_reads->at(op)->length;
+            return call.Return(op);
+        }
+        // The range is claimed before m is dropped, so a concurrent read on the handle carries on
+        // after it instead of reading it again.
+        const OrbisFiosOffset offset = handle.position;
+        if (length > 0) {
+            handle.position += length;
+        }
+        ret = HandlePread(l, handle, fh, pBuf, length, offset);
+        TraceRead(handle, offset, ret);
+        // Hand back what the read didn't get, unless a seek or another read has moved on since.
+        if (length > 0 && ret < length && handle.position == offset + length) {
+            handle.position = offset + std::max<s64>(ret, 0);
+        }
+    } else {
+        IoQueue::DemandReadScope demand;
+        ret = sceKernelRead(fh, pBuf, length);
+    }
     OrbisFiosOp op = ++op_count;
     if (ret != length) {
-        LOG_ERROR("len: {}, ret: {}", length, ret);
+        LOG_ERROR(Handles, "len: {}, ret: {}", length, ret);
     }
     op_io_return_codes_map->emplace(op, ret);
-    // LOG_DEBUG("ret: {}, op: {}", ret, op);
+    // LOG_DEBUG(Handles, "ret: {}, op: {}", ret, op);
     CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, ret);
-    return op;
+    return call.Return(op);
 }
 
 OrbisFiosSize sceFiosFHReadSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh, void* pBuf,
                                 OrbisFiosSize length) {
-    // LOG_DEBUG("(DUMMY) called");
+    auto call = TraceCall(Trace::Api::FHReadSync, nullptr, fh, length);
+    // LOG_DEBUG(Handles, "(DUMMY) called");
     if (pAttr && pAttr->pCallback) {
-        LOG_WARNING("There is a callback to a sync function!");
+        LOG_WARNING(Handles, "There is a callback to a sync function!");
     }
     OrbisFiosOp op = sceFiosFHRead(pAttr, fh, pBuf, length);
-    return sceFiosOpSyncWaitForIO(op);
+    return call.Return(sceFiosOpSyncWaitForIO(op));
 }
 
 OrbisFiosOp sceFiosFHReadv(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh,
                            const OrbisFiosBuffer iov[], int iovcnt) {
+    auto call = TraceCall(Trace::Api::FHReadv, nullptr, fh, IovLength(iov, iovcnt), 0, iovcnt);
     EnsureMapsInitialized();
-    std::scoped_lock l{m};
-    LOG_WARNING("(DUMMY) called");
-
-    std::vector<OrbisKernelIovec> kernel_iov(iovcnt);
-    for (int i = 0; i < iovcnt; ++i) {
-        kernel_iov[i].base = iov[i].pPtr;
-        kernel_iov[i].len = static_cast<std::size_t>(iov[i].length);
+    std::unique_lock l{m};
+    LOG_DEBUG(Handles, "called, fh: {}, iovcnt: {}", fh, iovcnt);
+
+    s64 ret;
+    auto it = fh_table->find(fh);
+    if (it != fh_table->end()) {
+        // Claims its range like sceFiosFHRead.
+        FileHandle& handle = it->second;
+        const OrbisFiosOffset offset = handle.position;
+        const s64 length = static_cast<s64>(IovLength(iov, iovcnt));
+        handle.position += length;
+        ret = HandlePreadv(l, &handle, fh, iov, iovcnt, offset);
+        TraceRead(handle, offset, ret);
+        if (length > 0 && ret < length && handle.position == offset + length) {
+            handle.position = offset + std::max<s64>(ret, 0);
+        }
+    } else {
+        OrbisFiosOffset position = sceKernelLseek(fh, 0, SceFiosWhence::Current);
+        ret = position < 0 ? position : HandlePreadv(l, nullptr, fh, iov, iovcnt, position);
+        if (ret > 0) {
+            sceKernelLseek(fh, position + ret, SceFiosWhence::Set);
+        }
     }
 
-    s64 ret = sceKernelPreadv(fh, kernel_iov.data(), iovcnt, 0);
-
     OrbisFiosOp op = ++op_count;
     op_io_return_codes_map->emplace(op, ret);
     CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, ret);
-    return op;
+    return call.Return(op);
 }
 
 OrbisFiosSize sceFiosFHReadvSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh,
                                  const OrbisFiosBuffer iov[], int iovcnt) {
-    LOG_DEBUG("(DUMMY) called");
+    auto call =
+        TraceCall(Trace::Api::FHReadvSync, nullptr, fh, IovLength(iov, iovcnt), 0, iovcnt);
     if (pAttr && pAttr->pCallback) {
-        LOG_WARNING("There is a callback to a sync function!");
+        LOG_WARNING(Handles, "There is a callback to a sync function!");
     }
     OrbisFiosOp op = sceFiosFHReadv(pAttr, fh, iov, iovcnt);
-    return sceFiosOpSyncWaitForIO(op);
+    return call.Return(sceFiosOpSyncWaitForIO(op));
 }
 
-s32 sceFiosFHSeek(OrbisFiosFH fh, OrbisFiosOffset offset, OrbisFiosWhence whence) {
-    LOG_WARNING("(DUMMY) called");
-    return sceKernelLseek(fh, offset, whence);
+OrbisFiosOffset sceFiosFHSeek(OrbisFiosFH fh, OrbisFiosOffset offset, OrbisFiosWhence whence) {
+    auto call = TraceCall(Trace::Api::FHSeek, nullptr, fh, offset, whence);
+    EnsureMapsInitialized();
+    std::scoped_lock l{m};
+    LOG_WARNING(Handles, "(DUMMY) called");
+    auto it = fh_table->find(fh);
+    if (it == fh_table->end()) {
+        return call.Return(sceKernelLseek(fh, offset, whence));
+    }
+    FileHandle& handle = it->second;
+    OrbisFiosOffset base = 0;
+    if (whence == SceFiosWhence::Current) {
+        base = handle.position;
+    } else if (whence == SceFiosWhence::End) {
+        if (handle.archive) {
+            base = handle.archive->entries[handle.entry].size;
+        } else if (handle.mapping) {
+            base = handle.mapping_size;
+        } else {
+            _OrbisKernelStat sb{};
+            sceKernelFstat(fh, (OrbisKernelStat*)&sb);
+            base = sb.st_size;
+        }
+    }
+    if (base + offset < 0) {
+        return call.Return(ORBIS_FIOS_ERROR_BAD_OFFSET);
+    }
+    handle.position = base + offset;
+    return call.Return(handle.position);
 }
 
 s32 sceFiosFHStat() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosFHStatSync() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosFHSync() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosFHSyncSync() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
-s32 sceFiosFHTell(OrbisFiosFH fh) {
-    LOG_WARNING("(DUMMY) called");
-    return sceKernelLseek(fh, 0, SceFiosWhence::Current);
+OrbisFiosOffset sceFiosFHTell(OrbisFiosFH fh) {
+    EnsureMapsInitialized();
+    std::scoped_lock l{m};
+    LOG_WARNING(Handles, "(DUMMY) called");
+    auto it = fh_table->find(fh);
+    if (it == fh_table->end()) {
+        return sceKernelLseek(fh, 0, SceFiosWhence::Current);
+    }
+    return it->second.position;
 }
 
 s32 sceFiosFHToFileno() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosFHTruncate() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosFHTruncateSync() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosFHWrite() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosFHWriteSync() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosFHWritev() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosFHWritevSync() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosFileDelete() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosFileDeleteSync() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 OrbisFiosOp sceFiosFileExists(const OrbisFiosOpAttr* pAttr, const char* pPath) {
-    // LOG_WARNING("(DUMMY) called");
-    return sceFiosExists(pAttr, pPath, nullptr);
+    auto call = TraceCall(Trace::Api::FileExists, pPath);
+    // LOG_WARNING(Paths, "(DUMMY) called");
+    return call.Return(sceFiosExists(pAttr, pPath, nullptr));
 }
 
 bool sceFiosFileExistsSync(const OrbisFiosOpAttr* pAttr, const char* pPath) {
-    // LOG_DEBUG("(DUMMY) called");
+    auto call = TraceCall(Trace::Api::FileExistsSync, pPath);
+    // LOG_DEBUG(Paths, "(DUMMY) called");
     if (pAttr && pAttr->pCallback) {
-        LOG_WARNING("There is a callback to a sync function!");
+        LOG_WARNING(Paths, "There is a callback to a sync function!");
     }
     OrbisFiosOp op = sceFiosFileExists(pAttr, pPath);
-    return sceFiosOpSyncWaitForIO(op);
+    return call.Return(sceFiosOpSyncWaitForIO(op));
 }
 
 OrbisFiosOp sceFiosFileGetSize(const OrbisFiosOpAttr* pAttr, const char* pPath) {
+    auto call = TraceCall(Trace::Api::FileGetSize, pPath);
     EnsureMapsInitialized();
     std::scoped_lock l{m};
     OrbisFiosOp op = ++op_count;
@@ -769,263 +1699,286 @@ OrbisFiosOp sceFiosFileGetSize(const OrbisFiosOpAttr* pAttr, const char* pPath)
     std::string path_str = std::string(ToApp0(pPath));
     bool exists;
     auto cache_it = file_stat_map->find(path_str);
-    if (cache_it == file_stat_map->end()) /* no cache hit */ {
-        LOG_DEBUG("No cache hit");
+    const Cache::File* file = Cache::FindFile(path_str);
+    u64 blob_size;
+    u32 entry;
+    if (const auto archive = FindArchiveFile(pPath, &entry)) {
+        exists = true;
+        stat.st_size = archive->entries[entry].size;
+    } else if (file && BlobStore::Find(file, &blob_size)) {
+        exists = true;
+        stat.st_size = blob_size;
+    } else if (cache_it == file_stat_map->end()) /* no cache hit */ {
+        LOG_DEBUG(Paths, "No cache hit");
         exists = sceKernelStat(ToApp0(pPath), (OrbisKernelStat*)&stat) == ORBIS_OK;
         file_stat_map->emplace(path_str, stat); // add to cache
     } else {
-        LOG_DEBUG("Cache hit");
+        LOG_DEBUG(Paths, "Cache hit");
         exists = cache_it->second.st_mode != 0;
         stat = cache_it->second;
     }
     if (!exists) { // here
-        LOG_DEBUG("File {} does not exist", pPath);
+        LOG_DEBUG(Paths, "File {} does not exist", pPath);
         op_io_return_codes_map->emplace(op, ORBIS_FIOS_ERROR_BAD_PATH);
-        return op;
+        return call.Return(op);
     }
-    LOG_WARNING("(DUMMY) called pAttr: {} path: {} size: {}, op: {}", (void*)pAttr, pPath,
+    LOG_WARNING(Paths, "(DUMMY) called pAttr: {} path: {} size: {}, op: {}", (void*)pAttr, pPath,
                 stat.st_size, op);
     op_io_return_codes_map->emplace(op, stat.st_size);
     CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, static_cast<s32>(stat.st_size));
-    return op;
+    return call.Return(op);
 }
 
 OrbisFiosSize sceFiosFileGetSizeSync(const OrbisFiosOpAttr* pAttr, const char* pPath) {
-    LOG_DEBUG("(DUMMY) called");
+    auto call = TraceCall(Trace::Api::FileGetSizeSync, pPath);
+    LOG_DEBUG(Paths, "(DUMMY) called");
     OrbisFiosOp op = sceFiosFileGetSize(pAttr, pPath);
-    return sceFiosOpSyncWaitForIO(op);
+    return call.Return(sceFiosOpSyncWaitForIO(op));
 }
 
 s32 sceFiosFilenoToFH() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 OrbisFiosOp sceFiosFileRead(const OrbisFiosOpAttr* pAttr, const char* pPath, void* pBuf,
                             OrbisFiosSize length, OrbisFiosOffset offset) {
+    auto call = TraceCall(Trace::Api::FileRead, pPath, length, offset);
     EnsureMapsInitialized();
-    std::scoped_lock l{m};
-    LOG_WARNING("(DUMMY) called, path: {}, length: {}, offset: {}", pPath, length, offset);
+    std::unique_lock l{m};
+    LOG_WARNING(Paths, "(DUMMY) called, path: {}, length: {}, offset: {}", pPath, length, offset);
     OrbisFiosOp op = ++op_count;
-    s64 ret = -1;
-
-    s32 fd = sceKernelOpen(ToApp0(pPath), O_RDONLY, 0);
+    u32 entry;
+    std::shared_ptr<Psarc::Archive> archive = FindArchiveFile(pPath, &entry);
 
-    if (fd >= 0) {
-        ret = sceKernelPread(fd, pBuf, length, offset);
-        ret = std::min(ret, (s64)0);
-        sceKernelClose(fd);
-    }
+    // The read itself doesn't touch any FIOS state, so it runs without m.
+    l.unlock();
+    s64 ret = std::min(PathPread(pPath, archive.get(), entry, pBuf, length, offset), (s64)0);
+    // Reads by path report 0 for success, so only the requested length is known.
+    TracePathRead(pPath, offset, ret >= 0 ? length : ret);
+    l.lock();
 
-    op_io_return_codes_map->emplace(op, ret >= 0 ? ret : ORBIS_FIOS_ERROR_BAD_PATH);
+    op_io_return_codes_map->emplace(op, ret != -1 ? ret : ORBIS_FIOS_ERROR_BAD_PATH);
     if (ret != 0) {
-        LOG_ERROR("ret: {}, len: {}", ret, length);
+        LOG_ERROR(Paths, "ret: {}, len: {}", ret, length);
     }
-    LOG_DEBUG("ret: {}, op: {}", ret, op);
+    LOG_DEBUG(Paths, "ret: {}, op: {}", ret, op);
     CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, static_cast<s32>(ret));
-    return op;
+    return call.Return(op);
 }
 
 OrbisFiosSize sceFiosFileReadSync(const OrbisFiosOpAttr* pAttr, const char* pPath, void* pBuf,
                                   OrbisFiosSize length, OrbisFiosOffset offset) {
+    auto call = TraceCall(Trace::Api::FileReadSync, pPath, length, offset);
     EnsureMapsInitialized();
-    std::scoped_lock l{m};
-    LOG_WARNING("(DUMMY) called, path: {}, length: {}, offset: {}", pPath, length, offset);
-    s64 ret = -1;
-
-    s32 fd = sceKernelOpen(ToApp0(pPath), O_RDONLY, 0);
-
-    if (fd >= 0) {
-        ret = sceKernelPread(fd, pBuf, length, offset);
-        // ret = std::min(ret, (s64)0);
-        sceKernelClose(fd);
+    LOG_WARNING(Paths, "(DUMMY) called, path: {}, length: {}, offset: {}", pPath, length, offset);
+    u32 entry;
+    std::shared_ptr<Psarc::Archive> archive;
+    {
+        std::scoped_lock l{m};
+        archive = FindArchiveFile(pPath, &entry);
     }
 
+    // The read itself doesn't touch any FIOS state, so it runs without m.
+    const s64 ret = PathPread(pPath, archive.get(), entry, pBuf, length, offset);
+    TracePathRead(pPath, offset, ret);
+
     if (ret != length) {
-        LOG_ERROR("ret: {}, len: {}", ret, length);
+        LOG_ERROR(Paths, "ret: {}, len: {}", ret, length);
     }
-    LOG_DEBUG("ret: {}", ret);
-    return ret;
+    LOG_DEBUG(Paths, "ret: {}", ret);
+    return call.Return(ret);
 }
 
 s32 sceFiosFileTruncate() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosFileTruncateSync() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosFileWrite() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosFileWriteSync() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosGetAllDHs() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosGetAllFHs() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Handles, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosGetAllOps() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Ops, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosGetDefaultOpAttr() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosGetGlobalDefaultOpAttr() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosGetSuspendCount() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosGetThreadDefaultOpAttr() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosInitialize() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosIOFilterAdd() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosIOFilterCache() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Cache, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosIOFilterGetInfo() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosIOFilterPsarcDearchiver() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Archive, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosIOFilterRemove() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosIsIdle() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Ops, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosIsInitialized() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosIsSuspended() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 bool sceFiosIsValidHandle(OrbisFiosHandle h) {
-    LOG_DEBUG("(DUMMY) called, handle: {}", h);
+    LOG_DEBUG(Handles, "(DUMMY) called, handle: {}", h);
     bool ret = h > 2;
     if (!ret) {
-        LOG_ERROR("Invalid handle: {}", h);
+        LOG_ERROR(Handles, "Invalid handle: {}", h);
     }
     return ret;
 }
 
 s32 sceFiosOpCancel() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Ops, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosOpDelete(OrbisFiosOp op) {
+    auto call = TraceCall(Trace::Api::OpDelete, nullptr, op);
     EnsureMapsInitialized();
-    std::scoped_lock l{m};
-    // LOG_DEBUG("(DUMMY) called, op: {}", op);
+    std::unique_lock l{m};
+    // LOG_DEBUG(Ops, "(DUMMY) called, op: {}", op);
+    // Chunks still write into the op's buffer, so deleting a pending read waits for it.
+    WaitForPendingRead(l, op);
     op_return_codes_map->erase(op);
     op_io_return_codes_map->erase(op);
-    return ORBIS_OK;
+    return call.Return(ORBIS_OK);
 }
 
 OrbisFiosSize sceFiosOpGetActualCount(OrbisFiosOp op) {
     EnsureMapsInitialized();
     std::scoped_lock l{m};
-    LOG_DEBUG("(DUMMY) called, op: {}", op);
+    LOG_DEBUG(Ops, "(DUMMY) called, op: {}", op);
+    if (auto pending = pending_reads->find(op); pending != pending_reads->end()) {
+        return pending->second->done_bytes.load(std::memory_order_relaxed);
+    }
     if (op_io_return_codes_map->find(op) == op_io_return_codes_map->end()) {
-        LOG_WARNING("Bad op handle: {}", op);
+        LOG_WARNING(Ops, "Bad op handle: {}", op);
         return ORBIS_FIOS_ERROR_BAD_OP;
     }
     return op_io_return_codes_map->find(op)->second;
 }
 
 s32 sceFiosOpGetAttr() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Ops, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosOpGetBuffer() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Ops, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosOpGetError(OrbisFiosOp op) {
-    LOG_DEBUG("(DUMMY) called, op: {}", op);
+    LOG_DEBUG(Ops, "(DUMMY) called, op: {}", op);
     if (op_return_codes_map->find(op) == op_return_codes_map->end()) {
-        LOG_DEBUG("Bad or old op handle: {}", op);
+        LOG_DEBUG(Ops, "Bad or old op handle: {}", op);
         return ORBIS_FIOS_ERROR_BAD_OP;
     }
     return op_return_codes_map->find(op)->second;
 }
 
 s32 sceFiosOpGetOffset() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Ops, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosOpGetPath() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Ops, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 OrbisFiosSize sceFiosOpGetRequestCount(OrbisFiosOp op) {
-    LOG_WARNING("(DUMMY) called");
+    LOG_WARNING(Ops, "(DUMMY) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosOpIsCancelled() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Ops, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 bool sceFiosOpIsDone(OrbisFiosOp op) {
-    LOG_DEBUG("(DUMMY) called, op: {}", op);
+    EnsureMapsInitialized();
+    std::scoped_lock l{m};
+    LOG_DEBUG(Ops, "(DUMMY) called, op: {}", op);
+    if (pending_reads->count(op) != 0) {
+        return false;
+    }
     if (op_return_codes_map->find(op) == op_return_codes_map->end()) {
         if (op_io_return_codes_map->find(op) == op_io_return_codes_map->end()) {
-            LOG_ERROR("Bad op handle: {}", op);
+            LOG_ERROR(Ops, "Bad op handle: {}", op);
             return false;
         }
     }
@@ -1033,196 +1986,221 @@ bool sceFiosOpIsDone(OrbisFiosOp op) {
 }
 
 s32 sceFiosOpReschedule() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Ops, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosOpRescheduleWithPriority() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Ops, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosOpSetBuffer() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Ops, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosOpSyncWait(OrbisFiosOp op) {
+    auto call = TraceCall(Trace::Api::OpSyncWait, nullptr, op);
     EnsureMapsInitialized();
-    std::scoped_lock l{m};
-    // LOG_DEBUG("called, op: {}", op);
+    std::unique_lock l{m};
+    // LOG_DEBUG(Ops, "called, op: {}", op);
+    WaitForPendingRead(l, op);
     auto it = op_return_codes_map->find(op);
     if (it == op_return_codes_map->end()) {
         auto it1 = op_io_return_codes_map->find(op);
         if (it1 == op_io_return_codes_map->end()) {
-            LOG_ERROR("Bad op handle: {}", op);
-            return ORBIS_FIOS_ERROR_BAD_OP;
+            LOG_ERROR(Ops, "Bad op handle: {}", op);
+            return call.Return(ORBIS_FIOS_ERROR_BAD_OP);
         }
         OrbisFiosSize ret = it1->second;
         op_io_return_codes_map->erase(it1);
-        return ret;
+        return call.Return(ret);
     }
     s32 ret = it->second;
     op_return_codes_map->erase(it);
-    return ret;
+    return call.Return(ret);
 }
 
 OrbisFiosSize sceFiosOpSyncWaitForIO(OrbisFiosOp op) {
+    auto call = TraceCall(Trace::Api::OpSyncWaitForIO, nullptr, op);
     EnsureMapsInitialized();
-    std::scoped_lock l{m};
-    // LOG_DEBUG("called, op: {}", op);
+    std::unique_lock l{m};
+    // LOG_DEBUG(Ops, "called, op: {}", op);
+    WaitForPendingRead(l, op);
     auto it = op_io_return_codes_map->find(op);
     if (it == op_io_return_codes_map->end()) {
         auto it1 = op_return_codes_map->find(op);
         if (it1 == op_return_codes_map->end()) {
-            LOG_ERROR("Bad op handle: {}", op);
-            return ORBIS_FIOS_ERROR_BAD_OP;
+            LOG_ERROR(Ops, "Bad op handle: {}", op);
+            return call.Return(ORBIS_FIOS_ERROR_BAD_OP);
         }
         OrbisFiosSize ret = it1->second;
         op_return_codes_map->erase(it1);
-        return ret;
+        return call.Return(ret);
     }
     OrbisFiosSize ret = it->second;
     op_io_return_codes_map->erase(it);
-    return ret;
+    return call.Return(ret);
 }
 
 s32 sceFiosOpWait(OrbisFiosOp op) {
+    auto call = TraceCall(Trace::Api::OpWait, nullptr, op);
     EnsureMapsInitialized();
-    std::scoped_lock l{m};
-    LOG_DEBUG("called, op: {}", op);
+    std::unique_lock l{m};
+    LOG_DEBUG(Ops, "called, op: {}", op);
+    WaitForPendingRead(l, op);
     auto it = op_return_codes_map->find(op);
     if (it == op_return_codes_map->end()) {
         auto it1 = op_io_return_codes_map->find(op);
         if (it1 == op_io_return_codes_map->end()) {
-            LOG_ERROR("Bad op handle: {}", op);
-            return ORBIS_FIOS_ERROR_BAD_OP;
+            LOG_ERROR(Ops, "Bad op handle: {}", op);
+            return call.Return(ORBIS_FIOS_ERROR_BAD_OP);
         }
         OrbisFiosSize ret = it1->second;
         op_io_return_codes_map->erase(it1);
-        return ret;
+        return call.Return(ret);
     }
     s32 ret = it->second;
     op_return_codes_map->erase(it);
-    return ret;
+    return call.Return(ret);
 }
 
 s32 sceFiosOpWaitUntil() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Ops, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosOverlayAdd() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosOverlayGetInfo() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosOverlayGetList() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosOverlayModify() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosOverlayRemove() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosOverlayResolveSync() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosPathcmp() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosPathncmp() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosPathNormalize() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosPrintf() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosPrintTimeStamps() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosRename() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosRenameSync() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosResolve() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosResolveSync() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Paths, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosResume() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosSaveTimeStamp() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosSetGlobalDefaultOpAttr() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosSetThreadDefaultOpAttr() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosShutdownAndCancelOps() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(Ops, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 OrbisFiosOp sceFiosStat(const OrbisFiosOpAttr* pAttr, const char* pPath,
                         OrbisFiosStat* pOutStatus) {
-    LOG_WARNING("(DUMMY) called pAttr: {} path: {}", (void*)pAttr, pPath);
+    auto call = TraceCall(Trace::Api::Stat, pPath);
+    LOG_WARNING(Paths, "(DUMMY) called pAttr: {} path: {}", (void*)pAttr, pPath);
 
-    OrbisFiosOp op = ++op_count;
+    OrbisFiosOp op;
+    {
+        EnsureMapsInitialized();
+        std::scoped_lock l{m};
+        op = ++op_count;
+        u32 entry;
+        const auto archive = FindArchiveFile(pPath, &entry);
+        const auto directory = archive ? nullptr : FindArchiveDirectory(pPath);
+        if (archive) {
+            ArchiveStat(*archive, &archive->entries[entry], pOutStatus);
+        } else if (directory) {
+            ArchiveStat(*directory, nullptr, pOutStatus);
+        }
+        if (archive || directory) {
+            op_return_codes_map->emplace(op, ORBIS_OK);
+            CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, ORBIS_OK);
+            return call.Return(op);
+        }
+    }
     _OrbisKernelStat stat{};
     s32 ret = sceKernelStat(ToApp0(pPath), (OrbisKernelStat*)&stat);
     if (ret < 0) {
         op_return_codes_map->emplace(op, ORBIS_FIOS_ERROR_BAD_PATH);
         CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, ORBIS_FIOS_ERROR_BAD_PATH);
-        return op;
+        return call.Return(op);
     }
 
     pOutStatus->fileSize = stat.st_size;
@@ -1239,53 +2217,101 @@ OrbisFiosOp sceFiosStat(const OrbisFiosOpAttr* pAttr, const char* pPath,
 
     op_return_codes_map->emplace(op, ORBIS_OK);
     CallFiosCallback(pAttr, op, OrbisFiosOpEvents::Complete, ret);
-    return op;
+    return call.Return(op);
 }
 
 s32 sceFiosStatSync(const OrbisFiosOpAttr* pAttr, const char* pPath, OrbisFiosStat* pOutStatus) {
-    LOG_DEBUG("(DUMMY) called");
+    auto call = TraceCall(Trace::Api::StatSync, pPath);
+    LOG_DEBUG(Paths, "(DUMMY) called");
     OrbisFiosOp op = sceFiosStat(pAttr, pPath, pOutStatus);
-    return sceFiosOpSyncWait(op);
+    return call.Return(sceFiosOpSyncWait(op));
 }
 
 s32 sceFiosSuspend() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosTerminate() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosTimeGetCurrent() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 OrbisFiosTimeInterval sceFiosTimeIntervalFromNanoseconds(s64 ns) {
-    LOG_INFO("called");
+    LOG_INFO(General, "called");
     return ns;
 }
 
 s32 sceFiosTimeIntervalToNanoseconds(OrbisFiosTime interval) {
-    LOG_INFO("called");
+    LOG_INFO(General, "called");
     return interval;
 }
 
 s32 sceFiosTraceTimestamp() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosUpdateParameters() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
 s32 sceFiosVprintf() {
-    LOG_ERROR("(STUBBED) called");
+    LOG_ERROR(General, "(STUBBED) called");
     return ORBIS_OK;
 }
 
+OrbisFiosSize fios2ExtGetDeduplicatedBytes() {
+    return SingleFlight::GetDeduplicatedBytes();
+}
+
+void fios2ExtFlushTrace() {
+    Trace::Flush();
+}
+
+void fios2ExtGetBlockCacheStats(Fios2ExtBlockCacheStats* pOut) {
+    const BlockCache::Stats stats = BlockCache::GetStats();
+    *pOut = {stats.hits, stats.misses, stats.hit_bytes, stats.evicted_blocks,
+             stats.resident_bytes};
+}
+
+void fios2ExtGetCacheStats(Fios2ExtCacheStats* pOut) {
+    const Cache::Stats stats = Cache::GetStats();
+    *pOut = {stats.hit_bytes, stats.prefetched_bytes, stats.prefetch_used_bytes,
+             stats.prefetch_evicted_bytes};
+}
+
+OrbisFiosSize fios2ExtFHGetMapping(OrbisFiosFH fh, OrbisFiosOffset offset, OrbisFiosSize length,
+                                   const void** ppOut) {
+    EnsureMapsInitialized();
+    std::scoped_lock l{m};
+    if (ppOut) {
+        *ppOut = nullptr;
+    }
+    auto it = fh_table->find(fh);
+    if (it == fh_table->end()) {
+        return ORBIS_FIOS_ERROR_BAD_FH;
+    }
+    if (offset < 0) {
+        return ORBIS_FIOS_ERROR_BAD_OFFSET;
+    }
+    if (length < 0) {
+        return ORBIS_FIOS_ERROR_BAD_SIZE;
+    }
+    const FileHandle& handle = it->second;
+    if (handle.mapping == nullptr || static_cast<u64>(offset) >= handle.mapping_size) {
+        return 0;
+    }
+    if (ppOut) {
+        *ppOut = handle.mapping + offset;
+    }
+    return std::min<u64>(length, handle.mapping_size - offset);
+}
+
 } // namespace Fios2
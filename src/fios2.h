@@ -5,6 +5,8 @@
 
 #include "types.h"
 
+#include <ctime>
+
 // copied from shadPS4's correct definition
 struct _OrbisKernelTimespec {
     s64 tv_sec;
@@ -107,8 +109,9 @@ void _start();
 u8 sceFiosArchiveGetDecompressorThreadCount();
 OrbisFiosOp sceFiosArchiveGetMountBufferSize(const OrbisFiosOpAttr* pAttr, const char* pArchivePath,
                                              const OrbisFiosOpenParams* pOpenParams);
-s32 sceFiosArchiveGetMountBufferSizeSync(const OrbisFiosOpAttr* pAttr, const char* pArchivePath,
-                                         const OrbisFiosOpenParams* pOpenParams);
+OrbisFiosSize sceFiosArchiveGetMountBufferSizeSync(const OrbisFiosOpAttr* pAttr,
+                                                   const char* pArchivePath,
+                                                   const OrbisFiosOpenParams* pOpenParams);
 OrbisFiosOp sceFiosArchiveMount(const OrbisFiosOpAttr* pAttr, OrbisFiosFH* pOutFH,
                                 const char* pArchivePath, const char* pMountPoint,
                                 OrbisFiosBuffer mountBuffer,
@@ -116,24 +119,36 @@ OrbisFiosOp sceFiosArchiveMount(const OrbisFiosOpAttr* pAttr, OrbisFiosFH* pOutF
 s32 sceFiosArchiveMountSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH* pOutFH,
                             const char* pArchivePath, const char* pMountPoint,
                             OrbisFiosBuffer mountBuffer, const OrbisFiosOpenParams* pOpenParams);
-OrbisFiosOp sceFiosArchiveMountWithOrder();
-s32 sceFiosArchiveMountWithOrderSync();
-s32 sceFiosArchiveSetDecompressorThreadCount();
-s32 sceFiosArchiveUnmount();
-s32 sceFiosArchiveUnmountSync();
-s32 sceFiosCacheContainsFileRangeSync();
-s32 sceFiosCacheContainsFileSync();
-s32 sceFiosCacheFlushFileRangeSync();
-s32 sceFiosCacheFlushFileSync();
-s32 sceFiosCacheFlushSync();
-s32 sceFiosCachePrefetchFH();
-s32 sceFiosCachePrefetchFHRange();
-s32 sceFiosCachePrefetchFHRangeSync();
-s32 sceFiosCachePrefetchFHSync();
-s32 sceFiosCachePrefetchFile();
-s32 sceFiosCachePrefetchFileRange();
-s32 sceFiosCachePrefetchFileRangeSync();
-s32 sceFiosCachePrefetchFileSync();
+OrbisFiosOp sceFiosArchiveMountWithOrder(const OrbisFiosOpAttr* pAttr, OrbisFiosFH* pOutFH,
+                                         const char* pArchivePath, const char* pMountPoint,
+                                         OrbisFiosBuffer mountBuffer,
+                                         const OrbisFiosOpenParams* pOpenParams, s32 order);
+s32 sceFiosArchiveMountWithOrderSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH* pOutFH,
+                                     const char* pArchivePath, const char* pMountPoint,
+                                     OrbisFiosBuffer mountBuffer,
+                                     const OrbisFiosOpenParams* pOpenParams, s32 order);
+s32 sceFiosArchiveSetDecompressorThreadCount(s32 threadCount);
+OrbisFiosOp sceFiosArchiveUnmount(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh);
+s32 sceFiosArchiveUnmountSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh);
+bool sceFiosCacheContainsFileRangeSync(const OrbisFiosOpAttr* pAttr, const char* pPath,
+                                       OrbisFiosOffset startOffset, OrbisFiosSize byteCount);
+bool sceFiosCacheContainsFileSync(const OrbisFiosOpAttr* pAttr, const char* pPath);
+s32 sceFiosCacheFlushFileRangeSync(const OrbisFiosOpAttr* pAttr, const char* pPath,
+                                   OrbisFiosOffset startOffset, OrbisFiosSize byteCount);
+s32 sceFiosCacheFlushFileSync(const OrbisFiosOpAttr* pAttr, const char* pPath);
+s32 sceFiosCacheFlushSync(const OrbisFiosOpAttr* pAttr);
+OrbisFiosOp sceFiosCachePrefetchFH(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh);
+OrbisFiosOp sceFiosCachePrefetchFHRange(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh,
+                                        OrbisFiosOffset startOffset, OrbisFiosSize byteCount);
+s32 sceFiosCachePrefetchFHRangeSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh,
+                                    OrbisFiosOffset startOffset, OrbisFiosSize byteCount);
+s32 sceFiosCachePrefetchFHSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh);
+OrbisFiosOp sceFiosCachePrefetchFile(const OrbisFiosOpAttr* pAttr, const char* pPath);
+OrbisFiosOp sceFiosCachePrefetchFileRange(const OrbisFiosOpAttr* pAttr, const char* pPath,
+                                          OrbisFiosOffset startOffset, OrbisFiosSize byteCount);
+s32 sceFiosCachePrefetchFileRangeSync(const OrbisFiosOpAttr* pAttr, const char* pPath,
+                                      OrbisFiosOffset startOffset, OrbisFiosSize byteCount);
+s32 sceFiosCachePrefetchFileSync(const OrbisFiosOpAttr* pAttr, const char* pPath);
 s32 sceFiosCancelAllOps();
 s32 sceFiosClearTimeStamps();
 s32 sceFiosCloseAllFiles();
@@ -193,8 +208,11 @@ OrbisFiosOp sceFiosFHPread(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh, void* p
                            OrbisFiosSize length, OrbisFiosOffset offset);
 s32 sceFiosFHPreadSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh, void* pBuf,
                        OrbisFiosSize length, OrbisFiosOffset offset);
-s32 sceFiosFHPreadv();
-s32 sceFiosFHPreadvSync();
+OrbisFiosOp sceFiosFHPreadv(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh,
+                            const OrbisFiosBuffer iov[], int iovcnt, OrbisFiosOffset offset);
+OrbisFiosSize sceFiosFHPreadvSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh,
+                                  const OrbisFiosBuffer iov[], int iovcnt,
+                                  OrbisFiosOffset offset);
 s32 sceFiosFHPwrite();
 s32 sceFiosFHPwriteSync();
 s32 sceFiosFHPwritev();
@@ -203,12 +221,12 @@ OrbisFiosOp sceFiosFHRead(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh, void* pB
 OrbisFiosSize sceFiosFHReadSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh, void* pBuf, OrbisFiosSize length);
 OrbisFiosOp sceFiosFHReadv(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh, const OrbisFiosBuffer iov[], int iovcnt);
 OrbisFiosSize sceFiosFHReadvSync(const OrbisFiosOpAttr* pAttr, OrbisFiosFH fh, const OrbisFiosBuffer iov[], int iovcnt);
-s32 sceFiosFHSeek(OrbisFiosFH fh, OrbisFiosOffset offset, OrbisFiosWhence whence);
+OrbisFiosOffset sceFiosFHSeek(OrbisFiosFH fh, OrbisFiosOffset offset, OrbisFiosWhence whence);
 s32 sceFiosFHStat();
 s32 sceFiosFHStatSync();
 s32 sceFiosFHSync();
 s32 sceFiosFHSyncSync();
-s32 sceFiosFHTell(OrbisFiosFH fh);
+OrbisFiosOffset sceFiosFHTell(OrbisFiosFH fh);
 s32 sceFiosFHToFileno();
 s32 sceFiosFHTruncate();
 s32 sceFiosFHTruncateSync();
@@ -295,6 +313,44 @@ s32 sceFiosTraceTimestamp();
 s32 sceFiosUpdateParameters();
 s32 sceFiosVprintf();
 
+// Extensions, not part of the original library.
+
+typedef struct Fios2ExtBlockCacheStats {
+    u64 hits;          // archive block lookups served from decompressed blocks
+    u64 misses;        // archive block lookups that had to decompress
+    u64 hitBytes;      // bytes copied out of cached blocks
+    u64 evictedBlocks; // blocks dropped to stay within the budget
+    u64 residentBytes;
+} Fios2ExtBlockCacheStats;
+
+typedef struct Fios2ExtCacheStats {
+    u64 hitBytes;             // bytes served to reads from resident blocks
+    u64 prefetchedBytes;      // bytes brought in by prefetch and readahead
+    u64 prefetchUsedBytes;    // prefetched bytes that a read later hit
+    u64 prefetchEvictedBytes; // prefetched bytes evicted or flushed before any read touched them
+} Fios2ExtCacheStats;
+
+// Bytes that reads got by sharing an identical read already in flight on another thread, instead
+// of going to the kernel themselves.
+OrbisFiosSize fios2ExtGetDeduplicatedBytes();
+
+// Counters of the cache of decompressed archive blocks that serves partial-block reads.
+void fios2ExtGetBlockCacheStats(Fios2ExtBlockCacheStats* pOut);
+
+// Counters of the read cache of loose files, which tell how much of what was prefetched paid off.
+void fios2ExtGetCacheStats(Fios2ExtCacheStats* pOut);
+
+// Writes out the access trace recorded so far (config key trace_path), so it's complete before the
+// process exits.
+void fios2ExtFlushTrace();
+
+// Zero-copy access to a handle opened in mmap mode: stores a pointer to offset inside the mapping in
+// *ppOut and returns how many bytes of [offset, offset + length) it covers. Returns 0 if the handle
+// isn't mapped, in which case the caller should fall back to sceFiosFHPread. The pointer stays valid
+// until sceFiosFHClose.
+OrbisFiosSize fios2ExtFHGetMapping(OrbisFiosFH fh, OrbisFiosOffset offset, OrbisFiosSize length,
+                                   const void** ppOut);
+
 }
 
 } // namespace Fios2
\ No newline at end of file
@@ -4,5 +4,11 @@
 #pragma once
 
 // Fios library
+constexpr int ORBIS_FIOS_ERROR_BAD_PATH = 0x80820005;
+constexpr int ORBIS_FIOS_ERROR_BAD_OFFSET = 0x80820007;
+constexpr int ORBIS_FIOS_ERROR_BAD_SIZE = 0x80820008;
+constexpr int ORBIS_FIOS_ERROR_BAD_IOVCNT = 0x80820009;
 constexpr int ORBIS_FIOS_ERROR_BAD_OP = 0x8082000A;
-constexpr int ORBIS_FIOS_ERROR_BAD_PATH = 0x80820005;
\ No newline at end of file
+constexpr int ORBIS_FIOS_ERROR_BAD_FH = 0x8082000B;
+constexpr int ORBIS_FIOS_ERROR_EOF = 0x80820010;
+constexpr int ORBIS_FIOS_ERROR_DECOMPRESSION = 0x80820014;
\ No newline at end of file
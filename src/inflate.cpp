@@ -0,0 +1,344 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "inflate.h"
+
+#include <cstring>
+
+namespace Fios2::Inflate {
+
+constexpr u32 MAX_BITS = 15;
+constexpr u32 NUM_LITLEN = 288;
+constexpr u32 NUM_DIST = 30;
+
+constexpr u16 LENGTH_BASE[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr u8 LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr u16 DIST_BASE[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,
+                               33,  49,  65,  97,  129, 193,  257,  385,  513,  769,
+                               1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr u8 DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                               6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+// Order in which code length code lengths are stored in a dynamic block header.
+constexpr u8 CODE_LENGTH_ORDER[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                      11, 4,  12, 3, 13, 2, 14, 1, 15};
+
+// LSB-first bit reader. Only ever loads real input bytes, so running out shows up as count going
+// negative after a Consume.
+class BitReader {
+public:
+    BitReader(const u8* src, u64 size) : p(src), end(src + size) {}
+
+    void Refill() {
+        while (count <= 56 && p < end) {
+            bits |= static_cast<u64>(*p++) << count;
+            count += 8;
+        }
+    }
+
+    u32 Peek(u32 n) const {
+        return static_cast<u32>(bits & ((1ULL << n) - 1));
+    }
+
+    void Consume(u32 n) {
+        bits >>= n;
+        count -= n;
+    }
+
+    // Reads up to 32 bits, refilling first.
+    u32 Get(u32 n) {
+        Refill();
+        const u32 value = Peek(n);
+        Consume(n);
+        return value;
+    }
+
+    bool Overrun() const {
+        return count < 0;
+    }
+
+    // Drops the bits up to the next byte boundary and hands back any whole bytes still buffered,
+    // so a stored block can be copied straight from the input.
+    const u8* AlignToByte() {
+        Consume(count & 7);
+        p -= count / 8;
+        bits = 0;
+        count = 0;
+        return p;
+    }
+
+    void Skip(u64 n) {
+        p += n;
+    }
+
+    u64 Remaining() const {
+        return end - p;
+    }
+
+private:
+    const u8* p;
+    const u8* end;
+    u64 bits = 0;
+    s32 count = 0;
+};
+
+// Canonical Huffman decoder. Codes up to FAST_BITS long resolve with one table lookup, longer
+// (rare) ones fall back to walking the code lengths one bit at a time.
+class Huffman {
+public:
+    static constexpr u32 FAST_BITS = 10;
+
+    // Returns false for an over-subscribed set of lengths. Incomplete sets are allowed, as deflate
+    // permits them for single-code distance trees.
+    bool Build(const u8* lengths, u32 num_symbols) {
+        std::memset(counts, 0, sizeof(counts));
+        for (u32 i = 0; i < num_symbols; ++i) {
+            ++counts[lengths[i]];
+        }
+        counts[0] = 0;
+        s32 left = 1;
+        u16 offsets[MAX_BITS + 2];
+        offsets[1] = 0;
+        for (u32 len = 1; len <= MAX_BITS; ++len) {
+            left = (left << 1) - counts[len];
+            if (left < 0) {
+                return false;
+            }
+            offsets[len + 1] = offsets[len] + counts[len];
+        }
+        for (u32 i = 0; i < num_symbols; ++i) {
+            if (lengths[i] != 0) {
+                symbols[offsets[lengths[i]]++] = static_cast<u16>(i);
+            }
+        }
+
+        std::memset(fast, 0, sizeof(fast));
+        u32 code = 0;
+        u32 index = 0;
+        for (u32 len = 1; len <= FAST_BITS; ++len) {
+            for (u32 i = 0; i < counts[len]; ++i, ++code, ++index) {
+                // Deflate sends codes MSB first, the bit reader hands out LSB first.
+                u32 reversed = 0;
+                for (u32 bit = 0; bit < len; ++bit) {
+                    reversed |= ((code >> bit) & 1) << (len - 1 - bit);
+                }
+                const u16 entry = static_cast<u16>(symbols[index] << 4 | len);
+                for (u32 j = reversed; j < (1u << FAST_BITS); j += 1u << len) {
+                    fast[j] = entry;
+                }
+            }
+            code <<= 1;
+        }
+        return true;
+    }
+
+    // Returns the next symbol, or -1 on an invalid code.
+    s32 Decode(BitReader& reader) const {
+        reader.Refill();
+        const u16 entry = fast[reader.Peek(FAST_BITS)];
+        if (entry != 0) {
+            reader.Consume(entry & 0xf);
+            return entry >> 4;
+        }
+        s32 code = 0;
+        s32 first = 0;
+        s32 index = 0;
+        for (u32 len = 1; len <= MAX_BITS; ++len) {
+            code |= reader.Peek(1);
+            reader.Consume(1);
+            const s32 count = counts[len];
+            if (code - first < count) {
+                return symbols[index + code - first];
+            }
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+
+private:
+    u16 fast[1 << FAST_BITS];
+    u16 counts[MAX_BITS + 1];
+    u16 symbols[NUM_LITLEN];
+};
+
+struct Decoder {
+    BitReader reader;
+    u8* dst;
+    u64 dst_size;
+    u64 out = 0;
+    Huffman litlen;
+    Huffman dist;
+
+    bool Stored() {
+        const u8* p = reader.AlignToByte();
+        if (reader.Remaining() < 4) {
+            return false;
+        }
+        const u32 len = p[0] | p[1] << 8;
+        const u32 nlen = p[2] | p[3] << 8;
+        if (len != (~nlen & 0xffff) || reader.Remaining() - 4 < len || dst_size - out < len) {
+            return false;
+        }
+        std::memcpy(dst + out, p + 4, len);
+        out += len;
+        reader.Skip(4 + len);
+        return true;
+    }
+
+    bool Codes() {
+        while (true) {
+            s32 symbol = litlen.Decode(reader);
+            if (symbol < 0 || reader.Overrun()) {
+                return false;
+            }
+            if (symbol < 256) {
+                if (out == dst_size) {
+                    return false;
+                }
+                dst[out++] = static_cast<u8>(symbol);
+                continue;
+            }
+            if (symbol == 256) {
+                return true;
+            }
+            symbol -= 257;
+            if (symbol >= 29) {
+                return false;
+            }
+            const u32 length = LENGTH_BASE[symbol] + reader.Get(LENGTH_EXTRA[symbol]);
+            const s32 dist_symbol = dist.Decode(reader);
+            if (dist_symbol < 0 || dist_symbol >= static_cast<s32>(NUM_DIST)) {
+                return false;
+            }
+            const u32 distance = DIST_BASE[dist_symbol] + reader.Get(DIST_EXTRA[dist_symbol]);
+            if (reader.Overrun() || distance > out || dst_size - out < length) {
+                return false;
+            }
+            u8* to = dst + out;
+            const u8* from = to - distance;
+            if (distance >= length) {
+                std::memcpy(to, from, length);
+            } else {
+                // Overlapping match, repeats the last distance bytes.
+                for (u32 i = 0; i < length; ++i) {
+                    to[i] = from[i];
+                }
+            }
+            out += length;
+        }
+    }
+
+    bool Fixed() {
+        u8 lengths[NUM_LITLEN + NUM_DIST];
+        std::memset(lengths, 8, 144);
+        std::memset(lengths + 144, 9, 112);
+        std::memset(lengths + 256, 7, 24);
+        std::memset(lengths + 280, 8, 8);
+        std::memset(lengths + NUM_LITLEN, 5, NUM_DIST);
+        return litlen.Build(lengths, NUM_LITLEN) && dist.Build(lengths + NUM_LITLEN, NUM_DIST) &&
+               Codes();
+    }
+
+    bool Dynamic() {
+        const u32 num_litlen = reader.Get(5) + 257;
+        const u32 num_dist = reader.Get(5) + 1;
+        const u32 num_code_lengths = reader.Get(4) + 4;
+        if (num_litlen > 286 || num_dist > NUM_DIST) {
+            return false;
+        }
+        u8 lengths[NUM_LITLEN + NUM_DIST]{};
+        for (u32 i = 0; i < num_code_lengths; ++i) {
+            lengths[CODE_LENGTH_ORDER[i]] = static_cast<u8>(reader.Get(3));
+        }
+        Huffman& code_lengths = litlen; // rebuilt below once the real lengths are known
+        if (!code_lengths.Build(lengths, 19)) {
+            return false;
+        }
+        std::memset(lengths, 0, 19);
+
+        u32 index = 0;
+        while (index < num_litlen + num_dist) {
+            const s32 symbol = code_lengths.Decode(reader);
+            if (symbol < 0 || reader.Overrun()) {
+                return false;
+            }
+            if (symbol < 16) {
+                lengths[index++] = static_cast<u8>(symbol);
+                continue;
+            }
+            u8 repeat_length = 0;
+            u32 repeat;
+            if (symbol == 16) {
+                if (index == 0) {
+                    return false;
+                }
+                repeat_length = lengths[index - 1];
+                repeat = 3 + reader.Get(2);
+            } else if (symbol == 17) {
+                repeat = 3 + reader.Get(3);
+            } else {
+                repeat = 11 + reader.Get(7);
+            }
+            if (index + repeat > num_litlen + num_dist) {
+                return false;
+            }
+            std::memset(lengths + index, repeat_length, repeat);
+            index += repeat;
+        }
+        if (lengths[256] == 0) {
+            return false; // no end of block code
+        }
+        return litlen.Build(lengths, num_litlen) && dist.Build(lengths + num_litlen, num_dist) &&
+               Codes();
+    }
+
+    s64 Run() {
+        u32 last;
+        do {
+            last = reader.Get(1);
+            const u32 type = reader.Get(2);
+            bool ok;
+            switch (type) {
+            case 0:
+                ok = Stored();
+                break;
+            case 1:
+                ok = Fixed();
+                break;
+            case 2:
+                ok = Dynamic();
+                break;
+            default:
+                ok = false;
+                break;
+            }
+            if (!ok || reader.Overrun()) {
+                return -1;
+            }
+        } while (!last);
+        return out;
+    }
+};
+
+s64 Raw(const u8* src, u64 src_size, u8* dst, u64 dst_size) {
+    Decoder decoder{BitReader{src, src_size}, dst, dst_size};
+    return decoder.Run();
+}
+
+s64 Zlib(const u8* src, u64 src_size, u8* dst, u64 dst_size) {
+    if (src_size < 2) {
+        return -1;
+    }
+    const u32 cmf = src[0];
+    const u32 flg = src[1];
+    // Deflate only, no preset dictionary.
+    if ((cmf & 0xf) != 8 || (cmf << 8 | flg) % 31 != 0 || (flg & 0x20) != 0) {
+        return -1;
+    }
+    return Raw(src + 2, src_size - 2, dst, dst_size);
+}
+
+} // namespace Fios2::Inflate
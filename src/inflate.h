@@ -0,0 +1,18 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "types.h"
+
+namespace Fios2::Inflate {
+
+// Decompresses a zlib stream (RFC 1950 header around RFC 1951 deflate data) into dst. Returns the
+// number of bytes written, or -1 if the data is corrupt or doesn't fit in dst. The Adler-32
+// trailer is not checked.
+s64 Zlib(const u8* src, u64 src_size, u8* dst, u64 dst_size);
+
+// Same, for a bare deflate stream.
+s64 Raw(const u8* src, u64 src_size, u8* dst, u64 dst_size);
+
+} // namespace Fios2::Inflate
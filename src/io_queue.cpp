@@ -0,0 +1,93 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "io_queue.h"
+#include "logging.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace Fios2::IoQueue {
+
+// Also the number of chunks of a large read that can be in flight at once.
+constexpr u32 NUM_WORKERS = 4;
+
+// Upper bound on how long a prefetch job backs off for a single demand read, so a game that reads
+// continuously can't starve a Sync prefetch forever.
+constexpr auto MAX_YIELD = std::chrono::milliseconds(2);
+
+// Heap allocated and never freed: detached workers may still be blocked on these during static
+// destruction at process exit.
+struct State {
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<std::function<void()>> demand_jobs;
+    std::deque<std::function<void()>> prefetch_jobs;
+    bool workers_started = false;
+
+    std::atomic<u32> demand_in_flight{0};
+    std::mutex demand_mutex;
+    std::condition_variable demand_cv;
+};
+
+State& state = *new State();
+
+void WorkerLoop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock l{state.queue_mutex};
+            state.queue_cv.wait(
+                l, [] { return !state.demand_jobs.empty() || !state.prefetch_jobs.empty(); });
+            auto& queue = !state.demand_jobs.empty() ? state.demand_jobs : state.prefetch_jobs;
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+        job();
+    }
+}
+
+void Submit(Priority priority, std::function<void()> job) {
+    {
+        std::scoped_lock l{state.queue_mutex};
+        if (!state.workers_started) [[unlikely]] {
+            LOG_INFO(Cache, "Starting {} I/O workers", NUM_WORKERS);
+            for (u32 i = 0; i < NUM_WORKERS; ++i) {
+                std::thread(WorkerLoop).detach();
+            }
+            state.workers_started = true;
+        }
+        if (priority == Priority::Demand) {
+            state.demand_jobs.push_back(std::move(job));
+        } else {
+            state.prefetch_jobs.push_back(std::move(job));
+        }
+    }
+    state.queue_cv.notify_one();
+}
+
+void BeginDemandRead() {
+    state.demand_in_flight.fetch_add(1, std::memory_order_relaxed);
+}
+
+void EndDemandRead() {
+    if (state.demand_in_flight.fetch_sub(1, std::memory_order_release) == 1) {
+        std::scoped_lock l{state.demand_mutex};
+        state.demand_cv.notify_all();
+    }
+}
+
+void YieldToDemand() {
+    if (state.demand_in_flight.load(std::memory_order_acquire) == 0) [[likely]] {
+        return;
+    }
+    std::unique_lock l{state.demand_mutex};
+    state.demand_cv.wait_for(
+        l, MAX_YIELD, [] { return state.demand_in_flight.load(std::memory_order_acquire) == 0; });
+}
+
+} // namespace Fios2::IoQueue
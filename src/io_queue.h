@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "types.h"
+
+#include <functional>
+
+namespace Fios2::IoQueue {
+
+enum class Priority : u8 {
+    Demand,   // I/O a game thread is waiting on
+    Prefetch, // speculative reads, only picked up when no demand work is queued
+};
+
+// Runs job on one of the I/O worker threads. Workers are started on first use.
+void Submit(Priority priority, std::function<void()> job);
+
+// Demand reads that run on the calling thread bracket their kernel I/O with these, so background
+// prefetching can get out of their way.
+void BeginDemandRead();
+void EndDemandRead();
+
+// Called by prefetch jobs between kernel reads. Waits (briefly) while demand reads are in flight.
+void YieldToDemand();
+
+class DemandReadScope {
+public:
+    DemandReadScope() {
+        BeginDemandRead();
+    }
+    ~DemandReadScope() {
+        EndDemandRead();
+    }
+    DemandReadScope(const DemandReadScope&) = delete;
+    DemandReadScope& operator=(const DemandReadScope&) = delete;
+};
+
+} // namespace Fios2::IoQueue
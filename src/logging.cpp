@@ -0,0 +1,325 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+
+namespace Fios2::Log {
+
+constexpr u64 RING_SIZE = 64_KB; // bytes, a power of two
+constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(5);
+constexpr auto RATE_WINDOW = std::chrono::seconds(1);
+
+struct RecordHeader {
+    u32 size;    // of the whole record with its arguments, a multiple of 8
+    u32 padding; // nonzero for the filler before a record that didn't fit at the end of the ring
+    const Site* site;
+    const char* format;
+    Decoder decode;
+    u64 time;
+};
+static_assert(RING_SIZE % alignof(RecordHeader) == 0);
+static_assert(MAX_ARGS_SIZE + sizeof(RecordHeader) <= RING_SIZE / 4);
+
+// Single producer (the owning thread), single consumer (whoever holds State::write_mutex).
+struct Ring {
+    alignas(RecordHeader) u8 data[RING_SIZE];
+    std::atomic<u64> head{0}; // end of the last committed record
+    std::atomic<u64> tail{0}; // start of the next record to write out
+    std::atomic<u64> dropped{0};
+    std::atomic<bool> released{false}; // owning thread exited
+    u64 reserved = 0; // end of the record being written, owner only
+};
+
+struct Entry {
+    u64 time;
+    const Site* site;
+    std::string message;
+};
+
+// Heap allocated and never freed, see Cache::State. A thread's ring goes back to the free list
+// once the thread has exited and the ring has been written out.
+struct State {
+    std::mutex mutex; // guards the fields below
+    std::vector<Ring*> rings;
+    std::vector<Ring*> free_rings;
+    u64 released_dropped = 0; // dropped by rings since recycled
+    std::vector<Site*> sites; // that have been called, for their repeat counts
+
+    std::mutex write_mutex; // one writer at a time, guards the fields below
+    std::vector<Entry> entries; // scratch for WriteQueued
+    u64 dropped = 0;            // by every ring so far
+    u64 reported_dropped = 0;   // of those, in a "Dropped" line
+};
+
+State& state = *new State();
+
+std::atomic<Level> levels[static_cast<u32>(Category::Count)]{};
+std::atomic<u32> rate_limit{10};
+
+constexpr const char* LEVEL_NAMES[] = {"Debug",    "Info",         "Warning", "Error",
+                                       "Critical", "Notification", "Off"};
+constexpr const char* CATEGORY_NAMES[] = {"general", "ops", "handles", "paths", "cache", "archive"};
+static_assert(std::size(LEVEL_NAMES) == static_cast<size_t>(Level::Off) + 1);
+static_assert(std::size(CATEGORY_NAMES) == static_cast<size_t>(Category::Count));
+
+void SetRateLimit(u32 lines_per_second) {
+    rate_limit.store(lines_per_second, std::memory_order_relaxed);
+}
+
+void SetLevel(Category category, Level level) {
+    levels[static_cast<u32>(category)].store(level, std::memory_order_relaxed);
+}
+
+void SetLevel(Level level) {
+    for (std::atomic<Level>& category_level : levels) {
+        category_level.store(level, std::memory_order_relaxed);
+    }
+}
+
+bool ParseLevel(std::string_view name, Level& level) {
+    for (u32 i = 0; i < std::size(LEVEL_NAMES); ++i) {
+        const std::string_view level_name = LEVEL_NAMES[i];
+        if (name.size() == level_name.size() &&
+            std::equal(name.begin(), name.end(), level_name.begin(),
+                       [](char a, char b) { return std::tolower(a) == std::tolower(b); })) {
+            level = static_cast<Level>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ParseCategory(std::string_view name, Category& category) {
+    for (u32 i = 0; i < std::size(CATEGORY_NAMES); ++i) {
+        if (name == CATEGORY_NAMES[i]) {
+            category = static_cast<Category>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// 12431 -> "12,431"
+static std::string GroupDigits(u64 value) {
+    std::string digits = std::to_string(value);
+    for (s64 i = static_cast<s64>(digits.size()) - 3; i > 0; i -= 3) {
+        digits.insert(static_cast<size_t>(i), 1, ',');
+    }
+    return digits;
+}
+
+static void WriteQueued();
+static void Emit(const Site& site, std::string_view message);
+
+// Starts a new rate limiting window, summing up what each call site held back in the last one and
+// what the rings dropped.
+static void SummarizeRepeats() {
+    std::vector<Site*> sites;
+    {
+        std::scoped_lock l{state.mutex};
+        sites = state.sites;
+    }
+    std::scoped_lock w{state.write_mutex};
+    WriteQueued();
+    const u32 limit = rate_limit.load(std::memory_order_relaxed);
+    for (Site* site : sites) {
+        const u32 calls = site->calls.exchange(0, std::memory_order_relaxed);
+        if (limit != 0 && calls > limit && site->level < Level::Critical) {
+            Emit(*site,
+                 fmt::format("repeated {} times in last second", GroupDigits(calls - limit)));
+        }
+    }
+    if (state.dropped != state.reported_dropped) {
+        static Site site{Level::Warning, __LINE__, __FILE__, __func__};
+        Emit(site, fmt::format("Dropped {} log messages, the writer can't keep up",
+                               GroupDigits(state.dropped - state.reported_dropped)));
+        state.reported_dropped = state.dropped;
+    }
+}
+
+static void WriterLoop() {
+    auto window_end = std::chrono::steady_clock::now() + RATE_WINDOW;
+    while (true) {
+        std::this_thread::sleep_for(FLUSH_INTERVAL);
+        if (std::chrono::steady_clock::now() >= window_end) {
+            SummarizeRepeats();
+            window_end += RATE_WINDOW;
+        } else {
+            Flush();
+        }
+    }
+}
+
+static void StartWriter() {
+    static std::once_flag writer_started;
+    std::call_once(writer_started, [] {
+        std::thread(WriterLoop).detach();
+        std::atexit(SummarizeRepeats);
+    });
+}
+
+void Register(Site& site) {
+    StartWriter();
+    std::scoped_lock l{state.mutex};
+    if (!site.registered.exchange(true, std::memory_order_relaxed)) {
+        state.sites.push_back(&site);
+    }
+}
+
+// Marks a thread's ring for reuse when the thread exits. Through a pthread key, thread_local
+// destructors never run here (see __cxa_thread_atexit_impl in assert.cpp).
+static void ReleaseRing(void* ring) {
+    static_cast<Ring*>(ring)->released.store(true, std::memory_order_release);
+}
+
+static Ring& GetRing() {
+    thread_local Ring* ring = nullptr;
+    if (ring == nullptr) [[unlikely]] {
+        StartWriter();
+        static const pthread_key_t owner = [] {
+            pthread_key_t key;
+            pthread_key_create(&key, ReleaseRing);
+            return key;
+        }();
+        {
+            std::scoped_lock l{state.mutex};
+            if (state.free_rings.empty()) {
+                ring = new Ring();
+            } else {
+                ring = state.free_rings.back();
+                state.free_rings.pop_back();
+            }
+            state.rings.push_back(ring);
+        }
+        pthread_setspecific(owner, ring);
+    }
+    return *ring;
+}
+
+static u64 Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+u8* Reserve(const Site& site, const char* format, Decoder decode, u64 args_size) {
+    Ring& ring = GetRing();
+    const u64 size = (sizeof(RecordHeader) + args_size + 7) & ~u64{7};
+    u64 head = ring.head.load(std::memory_order_relaxed);
+    const u64 offset = head % RING_SIZE;
+    const u64 filler = offset + size > RING_SIZE ? RING_SIZE - offset : 0;
+    if (head + filler + size - ring.tail.load(std::memory_order_acquire) > RING_SIZE) {
+        if (site.level < Level::Critical) {
+            ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        return nullptr;
+    }
+    if (filler != 0) {
+        const u32 filler_header[2] = {static_cast<u32>(filler), 1};
+        std::memcpy(ring.data + offset, filler_header, sizeof(filler_header));
+        head += filler;
+    }
+    auto* header = reinterpret_cast<RecordHeader*>(ring.data + head % RING_SIZE);
+    *header = {static_cast<u32>(size), 0, &site, format, decode, Now()};
+    ring.reserved = head + size;
+    return reinterpret_cast<u8*>(header + 1);
+}
+
+void Commit() {
+    Ring& ring = GetRing();
+    ring.head.store(ring.reserved, std::memory_order_release);
+}
+
+static void Drain(Ring& ring, std::vector<Entry>& out) {
+    u64 tail = ring.tail.load(std::memory_order_relaxed);
+    const u64 head = ring.head.load(std::memory_order_acquire);
+    while (tail != head) {
+        const auto* header = reinterpret_cast<const RecordHeader*>(ring.data + tail % RING_SIZE);
+        if (header->padding == 0) {
+            Entry& entry = out.emplace_back(Entry{header->time, header->site, {}});
+            try {
+                entry.message =
+                    header->decode(header->format, reinterpret_cast<const u8*>(header + 1));
+            } catch (const fmt::format_error& e) {
+                entry.message = fmt::format("bad log format \"{}\": {}", header->format, e.what());
+            }
+        }
+        tail += header->size;
+    }
+    ring.tail.store(tail, std::memory_order_release);
+}
+
+static void Emit(const Site& site, std::string_view message) {
+    fmt::memory_buffer line;
+    fmt::format_to(std::back_inserter(line), "[Homebrew] {}:{} <{}> {}: {}\n", site.file, site.line,
+                   LEVEL_NAMES[static_cast<u32>(site.level)], site.function, message);
+    line.push_back('\0');
+    sceKernelDebugOutText(0, line.data());
+}
+
+// Writes out every ring in time order. Needs State::write_mutex.
+static void WriteQueued() {
+    std::vector<Ring*> rings;
+    {
+        std::scoped_lock l{state.mutex};
+        rings = state.rings;
+    }
+    std::vector<Entry>& entries = state.entries;
+    entries.clear();
+    for (Ring* ring : rings) {
+        Drain(*ring, entries);
+    }
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const Entry& a, const Entry& b) { return a.time < b.time; });
+    for (const Entry& entry : entries) {
+        Emit(*entry.site, entry.message);
+    }
+
+    u64 dropped = 0;
+    {
+        std::scoped_lock l{state.mutex};
+        for (auto it = state.rings.begin(); it != state.rings.end();) {
+            Ring* ring = *it;
+            // The owner is gone, so once empty nothing can be added to the ring anymore.
+            if (ring->released.load(std::memory_order_acquire) &&
+                ring->tail.load(std::memory_order_relaxed) ==
+                    ring->head.load(std::memory_order_relaxed)) {
+                state.released_dropped += ring->dropped.load(std::memory_order_relaxed);
+                ring->head.store(0, std::memory_order_relaxed);
+                ring->tail.store(0, std::memory_order_relaxed);
+                ring->dropped.store(0, std::memory_order_relaxed);
+                ring->released.store(false, std::memory_order_relaxed);
+                state.free_rings.push_back(ring);
+                it = state.rings.erase(it);
+                continue;
+            }
+            dropped += ring->dropped.load(std::memory_order_relaxed);
+            ++it;
+        }
+        dropped += state.released_dropped;
+    }
+    state.dropped = dropped;
+}
+
+void WriteNow(const Site& site, const std::string& message) {
+    std::scoped_lock w{state.write_mutex};
+    WriteQueued();
+    Emit(site, message);
+}
+
+void Flush() {
+    std::scoped_lock w{state.write_mutex};
+    WriteQueued();
+}
+
+} // namespace Fios2::Log
@@ -2,6 +2,14 @@
 
 #include "fmt/format.h"
 #include "orbis/libkernel.h"
+#include "types.h"
+
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
 
 extern "C" void sceSysUtilSendSystemNotificationWithText(int type, const char* message);
 
@@ -16,27 +24,224 @@ std::string FormatLog(char const* format, Args const&... args) {
     return message;
 }
 
+// Calls below this level are compiled out along with their arguments, 0 (Debug) to 6 (Off).
+#ifndef FIOS2_LOG_MIN_LEVEL
+#define FIOS2_LOG_MIN_LEVEL 0
+#endif
+
+// Log lines are formatted and written by a background thread: the caller only copies the format
+// string pointer and the arguments into a ring of its own, see logging.cpp.
+namespace Fios2::Log {
+
+enum class Level : u8 {
+    Debug,
+    Info,
+    Warning,
+    Error,
+    Critical, // written out before the call returns, along with everything logged before it
+    Notification,
+    Off,
+};
+
+constexpr Level MIN_LEVEL = static_cast<Level>(FIOS2_LOG_MIN_LEVEL);
+
+// What a message is about, each with its own runtime level (config keys log_level and
+// log_level.<category>).
+enum class Category : u8 {
+    General,
+    Ops,     // op completion, waits and callbacks
+    Handles, // file and directory handles
+    Paths,   // lookups by path: exists, stat, size, overrides
+    Cache,   // page cache, prefetch, blob store and I/O workers
+    Archive, // PSARC mounts, blocks and decompression
+    Count,
+};
+
+// Lowest level logged per category. Every call checks its category with one relaxed load before
+// evaluating any of its arguments.
+extern std::atomic<Level> levels[static_cast<u32>(Category::Count)];
+
+inline bool Enabled(Category category, Level level) {
+    return level >= levels[static_cast<u32>(category)].load(std::memory_order_relaxed);
+}
+
+void SetLevel(Category category, Level level);
+void SetLevel(Level level); // of every category
+
+// Names as written in the config file, e.g. "debug" and "cache". False for an unknown name.
+bool ParseLevel(std::string_view name, Level& level);
+bool ParseCategory(std::string_view name, Category& category);
+
+// One per LOG_* call site, in static storage.
+struct Site {
+    Level level;
+    u32 line;
+    const char* file;
+    const char* function;
+    std::atomic<u32> calls{0}; // this second, reset by the writer thread
+    std::atomic<bool> registered{false};
+};
+
+// Lines a call site writes per second (config key log_rate_limit), 0 for no limit. Calls past it
+// are only counted, and summed up once a second in a "repeated N times" line. Critical messages
+// and notifications are never held back.
+extern std::atomic<u32> rate_limit;
+
+void SetRateLimit(u32 lines_per_second);
+void Register(Site& site);
+
+// Whether a call at site is written, one atomic increment once it's over the limit.
+inline bool Admit(Site& site) {
+    const u32 calls = site.calls.fetch_add(1, std::memory_order_relaxed);
+    if (calls == 0 && !site.registered.load(std::memory_order_relaxed)) [[unlikely]] {
+        Register(site);
+    }
+    const u32 limit = rate_limit.load(std::memory_order_relaxed);
+    return calls < limit || limit == 0 || site.level >= Level::Critical;
+}
+
+// Rebuilds the message from a record's arguments.
+using Decoder = std::string (*)(const char* format, const u8* pArgs);
+
+// Arguments are copied by value, strings by content, so they can be formatted after the caller has
+// moved on. Anything else is formatted on the calling thread.
+template <typename T>
+constexpr bool IS_STRING = std::is_convertible_v<const T&, std::string_view>;
+template <typename T>
+constexpr bool IS_DEFERRABLE = IS_STRING<T> || std::is_trivially_copyable_v<T>;
+
+template <typename T>
+std::string_view StringArg(const T& arg) {
+    if constexpr (std::is_pointer_v<std::decay_t<T>>) {
+        return arg ? std::string_view{arg} : std::string_view{"(null)"};
+    } else {
+        return std::string_view{arg};
+    }
+}
+
+template <typename T>
+u64 ArgSize(const T& arg) {
+    if constexpr (IS_STRING<T>) {
+        return sizeof(u32) + StringArg(arg).size();
+    } else {
+        return sizeof(T);
+    }
+}
+
+template <typename T>
+u8* WriteArg(u8* p, const T& arg) {
+    if constexpr (IS_STRING<T>) {
+        const std::string_view str = StringArg(arg);
+        const u32 size = static_cast<u32>(str.size());
+        std::memcpy(p, &size, sizeof(size));
+        std::memcpy(p + sizeof(size), str.data(), size);
+        return p + sizeof(size) + size;
+    } else {
+        std::memcpy(p, &arg, sizeof(T));
+        return p + sizeof(T);
+    }
+}
+
+// What an argument of type T is formatted from.
+template <typename T>
+using Stored = std::conditional_t<IS_STRING<T>, std::string_view, std::decay_t<T>>;
+
+template <typename T>
+T ReadArg(const u8*& p) {
+    if constexpr (std::is_same_v<T, std::string_view>) {
+        u32 size;
+        std::memcpy(&size, p, sizeof(size));
+        const std::string_view str{reinterpret_cast<const char*>(p + sizeof(size)), size};
+        p += sizeof(size) + size;
+        return str;
+    } else {
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return value;
+    }
+}
+
+template <typename... Ts>
+std::string Decode(const char* format, const u8* pArgs) {
+    // Braced initialization evaluates left to right, the order the arguments were written in.
+    const std::tuple<Ts...> args{ReadArg<Ts>(pArgs)...};
+    return std::apply(
+        [format](const Ts&... values) {
+            return fmt::vformat(format, fmt::make_format_args(values...));
+        },
+        args);
+}
+
+// Records with more argument bytes than this are formatted and written on the calling thread.
+constexpr u64 MAX_ARGS_SIZE = 8_KB;
+
+// Space for a record with args_size bytes of arguments in the calling thread's ring, or nullptr if
+// the ring is full. Commit publishes it. Below Critical a record that doesn't fit is dropped and
+// counted; Critical ones are written with WriteNow instead.
+u8* Reserve(const Site& site, const char* format, Decoder decode, u64 args_size);
+void Commit();
+
+// Writes the message on the calling thread, after everything already queued.
+void WriteNow(const Site& site, const std::string& message);
+
+// Writes out everything logged so far, on the calling thread.
+void Flush();
+
 template <typename... Args>
-void PrintLog(char const* log_level, char const* file, unsigned int line_num, char const* function,
-              char const* format, Args const&... args) {
-    std::string message = FormatLog(format, args...);
-    std::string full_log =
-        fmt::format("[Homebrew] {}:{} <{}> {}: {}\n", file, line_num, log_level, function, message);
-    sceKernelDebugOutText(0, full_log.c_str());
+void Write(const Site& site, const char* format, const Args&... args) {
+    if constexpr ((IS_DEFERRABLE<Args> && ...)) {
+        const u64 args_size = (u64{0} + ... + ArgSize(args));
+        if (args_size > MAX_ARGS_SIZE) [[unlikely]] {
+            WriteNow(site, FormatLog(format, args...));
+        } else if (u8* p = Reserve(site, format, &Decode<Stored<Args>...>, args_size)) {
+            ((p = WriteArg(p, args)), ...);
+            Commit();
+        } else if (site.level >= Level::Critical) {
+            WriteNow(site, FormatLog(format, args...));
+        }
+    } else {
+        const std::string message = FormatLog(format, args...);
+        if (ArgSize(message) > MAX_ARGS_SIZE) [[unlikely]] {
+            WriteNow(site, message);
+        } else if (u8* p = Reserve(site, "{}", &Decode<std::string_view>, ArgSize(message))) {
+            WriteArg(p, message);
+            Commit();
+        } else if (site.level >= Level::Critical) {
+            WriteNow(site, message);
+        }
+    }
+    if (site.level >= Level::Critical) {
+        Flush();
+    }
 }
 
+} // namespace Fios2::Log
+
 template <typename... Args>
-void PrintLogN(char const* log_level, char const* file, unsigned int line_num, char const* function,
-               char const* format, Args const&... args) {
-    PrintLog(log_level, file, line_num, function, format, args...);
+void PrintLogN(const Fios2::Log::Site& site, char const* format, Args const&... args) {
+    Fios2::Log::Write(site, format, args...);
     std::string message = FormatLog(format, args...);
     sceSysUtilSendSystemNotificationWithText(222, message.c_str());
 }
 
-#define LOG_DEBUG(...) PrintLog("Debug", __FILE__, __LINE__, __func__, __VA_ARGS__)
-#define LOG_INFO(...) PrintLog("Info", __FILE__, __LINE__, __func__, __VA_ARGS__)
-#define LOG_WARNING(...) PrintLog("Warning", __FILE__, __LINE__, __func__, __VA_ARGS__)
-#define LOG_ERROR(...) PrintLog("Error", __FILE__, __LINE__, __func__, __VA_ARGS__)
-#define LOG_CRITICAL(...) PrintLog("Critical", __FILE__, __LINE__, __func__, __VA_ARGS__)
+// The first argument of every LOG_* macro is the Category, e.g. LOG_INFO(Cache, "...", ...).
+#define LOG_AT(write, level, category, ...)                                                        \
+    do {                                                                                           \
+        if constexpr (Fios2::Log::Level::level >= Fios2::Log::MIN_LEVEL) {                         \
+            if (Fios2::Log::Enabled(Fios2::Log::Category::category, Fios2::Log::Level::level)) {   \
+                static Fios2::Log::Site log_site{Fios2::Log::Level::level, __LINE__, __FILE__,     \
+                                                 __func__};                                        \
+                if (Fios2::Log::Admit(log_site)) {                                                 \
+                    write(log_site, __VA_ARGS__);                                                  \
+                }                                                                                  \
+            }                                                                                      \
+        }                                                                                          \
+    } while (0)
 
-#define LOG_NOTIFICATION(...) PrintLogN("Notification", __FILE__, __LINE__, __func__, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(Fios2::Log::Write, Debug, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(Fios2::Log::Write, Info, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(Fios2::Log::Write, Warning, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(Fios2::Log::Write, Error, __VA_ARGS__)
+#define LOG_CRITICAL(...) LOG_AT(Fios2::Log::Write, Critical, __VA_ARGS__)
+#define LOG_NOTIFICATION(...) LOG_AT(PrintLogN, Notification, __VA_ARGS__)
@@ -0,0 +1,322 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "lzma_decoder.h"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace Fios2::Lzma {
+
+// Follows the reference decoder in the LZMA SDK (LzmaSpec), decoding straight into the output
+// buffer, which doubles as the dictionary.
+
+constexpr u32 HEADER_SIZE = 13;
+constexpr u32 NUM_STATES = 12;
+constexpr u32 MAX_POS_BITS = 4;
+constexpr u32 NUM_LEN_TO_POS_STATES = 4;
+constexpr u32 NUM_ALIGN_BITS = 4;
+constexpr u32 START_POS_MODEL_INDEX = 4;
+constexpr u32 END_POS_MODEL_INDEX = 14;
+constexpr u32 NUM_FULL_DISTANCES = 1 << (END_POS_MODEL_INDEX >> 1);
+constexpr u32 MATCH_MIN_LEN = 2;
+constexpr u16 PROB_INIT = 1 << 10;
+
+class RangeDecoder {
+public:
+    RangeDecoder(const u8* src, u64 size) : p(src), end(src + size) {}
+
+    bool Init() {
+        if (NextByte() != 0) {
+            return false;
+        }
+        for (u32 i = 0; i < 4; ++i) {
+            code = code << 8 | NextByte();
+        }
+        return code != range;
+    }
+
+    u32 DecodeBit(u16& prob) {
+        const u32 bound = (range >> 11) * prob;
+        u32 bit;
+        if (code < bound) {
+            range = bound;
+            prob += ((1 << 11) - prob) >> 5;
+            bit = 0;
+        } else {
+            range -= bound;
+            code -= bound;
+            prob -= prob >> 5;
+            bit = 1;
+        }
+        Normalize();
+        return bit;
+    }
+
+    u32 DecodeDirectBits(u32 num_bits) {
+        u32 result = 0;
+        do {
+            range >>= 1;
+            code -= range;
+            const u32 t = 0 - (code >> 31);
+            code += range & t;
+            if (code == range) {
+                corrupted = true;
+            }
+            Normalize();
+            result = (result << 1) + (t + 1);
+        } while (--num_bits);
+        return result;
+    }
+
+    bool Failed() const {
+        return corrupted || overrun;
+    }
+
+private:
+    u8 NextByte() {
+        if (p == end) {
+            overrun = true;
+            return 0;
+        }
+        return *p++;
+    }
+
+    void Normalize() {
+        if (range < (1u << 24)) {
+            range <<= 8;
+            code = code << 8 | NextByte();
+        }
+    }
+
+    const u8* p;
+    const u8* end;
+    u32 range = 0xffffffff;
+    u32 code = 0;
+    bool corrupted = false;
+    bool overrun = false;
+};
+
+template <u32 NumBits>
+struct BitTree {
+    u16 probs[1 << NumBits];
+
+    BitTree() {
+        std::fill(std::begin(probs), std::end(probs), PROB_INIT);
+    }
+
+    u32 Decode(RangeDecoder& rc) {
+        u32 m = 1;
+        for (u32 i = 0; i < NumBits; ++i) {
+            m = (m << 1) + rc.DecodeBit(probs[m]);
+        }
+        return m - (1u << NumBits);
+    }
+
+    u32 ReverseDecode(RangeDecoder& rc) {
+        return ReverseDecode(probs, NumBits, rc);
+    }
+
+    static u32 ReverseDecode(u16* probs, u32 num_bits, RangeDecoder& rc) {
+        u32 m = 1;
+        u32 symbol = 0;
+        for (u32 i = 0; i < num_bits; ++i) {
+            const u32 bit = rc.DecodeBit(probs[m]);
+            m = (m << 1) + bit;
+            symbol |= bit << i;
+        }
+        return symbol;
+    }
+};
+
+struct LenDecoder {
+    u16 choice = PROB_INIT;
+    u16 choice2 = PROB_INIT;
+    BitTree<3> low[1 << MAX_POS_BITS];
+    BitTree<3> mid[1 << MAX_POS_BITS];
+    BitTree<8> high;
+
+    u32 Decode(RangeDecoder& rc, u32 pos_state) {
+        if (rc.DecodeBit(choice) == 0) {
+            return low[pos_state].Decode(rc);
+        }
+        if (rc.DecodeBit(choice2) == 0) {
+            return 8 + mid[pos_state].Decode(rc);
+        }
+        return 16 + high.Decode(rc);
+    }
+};
+
+struct Decoder {
+    u32 lc;
+    u32 lp;
+    u32 pb;
+    std::vector<u16> literal_probs;
+    BitTree<6> pos_slot[NUM_LEN_TO_POS_STATES];
+    BitTree<NUM_ALIGN_BITS> align;
+    u16 pos_probs[1 + NUM_FULL_DISTANCES - END_POS_MODEL_INDEX];
+    u16 is_match[NUM_STATES << MAX_POS_BITS];
+    u16 is_rep[NUM_STATES];
+    u16 is_rep_g0[NUM_STATES];
+    u16 is_rep_g1[NUM_STATES];
+    u16 is_rep_g2[NUM_STATES];
+    u16 is_rep0_long[NUM_STATES << MAX_POS_BITS];
+    LenDecoder len;
+    LenDecoder rep_len;
+
+    Decoder(u32 lc_, u32 lp_, u32 pb_)
+        : lc(lc_), lp(lp_), pb(pb_), literal_probs(0x300u << (lc_ + lp_), PROB_INIT) {
+        std::fill(std::begin(pos_probs), std::end(pos_probs), PROB_INIT);
+        std::fill(std::begin(is_match), std::end(is_match), PROB_INIT);
+        std::fill(std::begin(is_rep), std::end(is_rep), PROB_INIT);
+        std::fill(std::begin(is_rep_g0), std::end(is_rep_g0), PROB_INIT);
+        std::fill(std::begin(is_rep_g1), std::end(is_rep_g1), PROB_INIT);
+        std::fill(std::begin(is_rep_g2), std::end(is_rep_g2), PROB_INIT);
+        std::fill(std::begin(is_rep0_long), std::end(is_rep0_long), PROB_INIT);
+    }
+
+    u32 DecodeDistance(RangeDecoder& rc, u32 length) {
+        const u32 len_state = std::min(length, NUM_LEN_TO_POS_STATES - 1);
+        const u32 slot = pos_slot[len_state].Decode(rc);
+        if (slot < START_POS_MODEL_INDEX) {
+            return slot;
+        }
+        const u32 num_direct_bits = (slot >> 1) - 1;
+        u32 dist = (2 | (slot & 1)) << num_direct_bits;
+        if (slot < END_POS_MODEL_INDEX) {
+            return dist + BitTree<1>::ReverseDecode(pos_probs + dist - slot, num_direct_bits, rc);
+        }
+        dist += rc.DecodeDirectBits(num_direct_bits - NUM_ALIGN_BITS) << NUM_ALIGN_BITS;
+        return dist + align.ReverseDecode(rc);
+    }
+
+    s64 Run(RangeDecoder& rc, u8* dst, u64 dst_size) {
+        u64 out = 0;
+        u32 state = 0;
+        u32 rep0 = 0, rep1 = 0, rep2 = 0, rep3 = 0;
+        const u32 pb_mask = (1u << pb) - 1;
+        const u32 lp_mask = (1u << lp) - 1;
+        while (out < dst_size) {
+            if (rc.Failed()) {
+                return -1;
+            }
+            const u32 pos_state = out & pb_mask;
+            if (rc.DecodeBit(is_match[(state << MAX_POS_BITS) + pos_state]) == 0) {
+                const u32 prev = out > 0 ? dst[out - 1] : 0;
+                u16* probs = &literal_probs[0x300 * (((out & lp_mask) << lc) + (prev >> (8 - lc)))];
+                u32 symbol = 1;
+                if (state >= 7) {
+                    if (rep0 >= out) {
+                        return -1;
+                    }
+                    u32 match_byte = dst[out - rep0 - 1];
+                    do {
+                        const u32 match_bit = (match_byte >> 7) & 1;
+                        match_byte <<= 1;
+                        const u32 bit = rc.DecodeBit(probs[((1 + match_bit) << 8) + symbol]);
+                        symbol = symbol << 1 | bit;
+                        if (match_bit != bit) {
+                            break;
+                        }
+                    } while (symbol < 0x100);
+                }
+                while (symbol < 0x100) {
+                    symbol = symbol << 1 | rc.DecodeBit(probs[symbol]);
+                }
+                dst[out++] = static_cast<u8>(symbol);
+                state = state < 4 ? 0 : state < 10 ? state - 3 : state - 6;
+                continue;
+            }
+
+            u32 length;
+            if (rc.DecodeBit(is_rep[state]) != 0) {
+                if (out == 0) {
+                    return -1;
+                }
+                if (rc.DecodeBit(is_rep_g0[state]) == 0) {
+                    if (rc.DecodeBit(is_rep0_long[(state << MAX_POS_BITS) + pos_state]) == 0) {
+                        // Short rep: a single byte from rep0.
+                        if (rep0 >= out) {
+                            return -1;
+                        }
+                        state = state < 7 ? 9 : 11;
+                        dst[out] = dst[out - rep0 - 1];
+                        ++out;
+                        continue;
+                    }
+                } else {
+                    u32 dist;
+                    if (rc.DecodeBit(is_rep_g1[state]) == 0) {
+                        dist = rep1;
+                    } else {
+                        if (rc.DecodeBit(is_rep_g2[state]) == 0) {
+                            dist = rep2;
+                        } else {
+                            dist = rep3;
+                            rep3 = rep2;
+                        }
+                        rep2 = rep1;
+                    }
+                    rep1 = rep0;
+                    rep0 = dist;
+                }
+                length = rep_len.Decode(rc, pos_state);
+                state = state < 7 ? 8 : 11;
+            } else {
+                rep3 = rep2;
+                rep2 = rep1;
+                rep1 = rep0;
+                length = len.Decode(rc, pos_state);
+                state = state < 7 ? 7 : 10;
+                rep0 = DecodeDistance(rc, length);
+                if (rep0 == 0xffffffff) {
+                    return rc.Failed() ? -1 : static_cast<s64>(out); // end marker
+                }
+            }
+
+            length += MATCH_MIN_LEN;
+            if (rep0 >= out || dst_size - out < length) {
+                return -1;
+            }
+            const u8* from = dst + out - rep0 - 1;
+            for (u32 i = 0; i < length; ++i) {
+                dst[out + i] = from[i];
+            }
+            out += length;
+        }
+        return rc.Failed() ? -1 : static_cast<s64>(out);
+    }
+};
+
+s64 DecodeAlone(const u8* src, u64 src_size, u8* dst, u64 dst_size) {
+    if (src_size < HEADER_SIZE) {
+        return -1;
+    }
+    u32 props = src[0];
+    if (props >= 9 * 5 * 5) {
+        return -1;
+    }
+    const u32 lc = props % 9;
+    props /= 9;
+    const u32 lp = props % 5;
+    const u32 pb = props / 5;
+    u64 size = 0;
+    for (u32 i = 0; i < 8; ++i) {
+        size |= static_cast<u64>(src[5 + i]) << (i * 8);
+    }
+    if (size != ~0ULL && size < dst_size) {
+        dst_size = size;
+    }
+
+    RangeDecoder rc(src + HEADER_SIZE, src_size - HEADER_SIZE);
+    if (!rc.Init()) {
+        return -1;
+    }
+    // Too big for the stack with large lc + lp.
+    auto decoder = std::make_unique<Decoder>(lc, lp, pb);
+    return decoder->Run(rc, dst, dst_size);
+}
+
+} // namespace Fios2::Lzma
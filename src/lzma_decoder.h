@@ -0,0 +1,15 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "types.h"
+
+namespace Fios2::Lzma {
+
+// Decodes an LZMA "alone" stream (5 property bytes, 8-byte little-endian size, then the range
+// coded data) until dst is full or the end marker is reached. Returns the number of bytes written,
+// or -1 if the data is corrupt.
+s64 DecodeAlone(const u8* src, u64 src_size, u8* dst, u64 dst_size);
+
+} // namespace Fios2::Lzma
@@ -0,0 +1,22 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "types.h"
+
+#include <string_view>
+
+namespace Fios2::Md5 {
+
+// MD5 of data. The 16 digest bytes are stored in order, the first eight in [0] as a little-endian
+// u64, so digests read straight out of a file compare equal with FromBytes.
+u128 Digest(const void* data, u64 size);
+
+inline u128 Digest(std::string_view str) {
+    return Digest(str.data(), str.size());
+}
+
+u128 FromBytes(const u8* bytes);
+
+} // namespace Fios2::Md5
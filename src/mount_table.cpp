@@ -0,0 +1,189 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "mount_table.h"
+#include "logging.h"
+#include "md5.h"
+#include "override.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Fios2::MountTable {
+
+struct Layer {
+    OrbisFiosFH fh;
+    s32 order;
+    u64 sequence; // mount order, breaks ties between equal orders
+    std::shared_ptr<Psarc::Archive> archive;
+
+    bool Above(const Layer& other) const {
+        return order != other.order ? order > other.order : sequence > other.sequence;
+    }
+};
+
+struct Provider {
+    const Layer* layer;
+    u32 value; // entry index, or Psarc::DIRECTORY
+};
+
+struct DigestHash {
+    size_t operator()(const u128& digest) const {
+        return static_cast<size_t>(digest[0]);
+    }
+};
+
+// Heap allocated and never freed, see Cache::State.
+struct State {
+    std::vector<std::unique_ptr<Layer>> layers;
+    u64 next_sequence = 0;
+    // MD5 of the full game path -> the layers that provide it, topmost first. Paths of
+    // case-insensitive archives are hashed lowercase. The paths themselves stay interned in each
+    // archive's name pool.
+    std::unordered_map<u128, std::vector<Provider>, DigestHash> index;
+    u32 num_folded_layers = 0;
+};
+
+State& state = *new State();
+
+static std::string FoldCase(std::string_view path) {
+    std::string result(path);
+    std::transform(result.begin(), result.end(), result.begin(),
+                   [](char c) { return static_cast<char>(std::tolower(c)); });
+    return result;
+}
+
+static bool IgnoresCase(const Psarc::Archive& archive) {
+    return archive.flags & Psarc::FLAG_IGNORE_CASE;
+}
+
+// Calls fn(key, value) for every name in the layer's archive.
+template <typename Fn>
+static void ForEachPath(const Layer& layer, Fn&& fn) {
+    const Psarc::Archive& archive = *layer.archive;
+    std::string key;
+    for (u32 i = 0; i < archive.num_slots; ++i) {
+        const Psarc::NameSlot& slot = archive.slots[i];
+        if (slot.digest == u128{}) {
+            continue;
+        }
+        const std::string_view name = archive.names + slot.name;
+        key = archive.mount_point;
+        if (!name.empty()) {
+            key += '/';
+            key += name;
+        }
+        fn(IgnoresCase(archive) ? FoldCase(key) : key, slot.value);
+    }
+}
+
+std::string ToKey(std::string_view path) {
+    std::string key;
+    key.reserve(path.size());
+    for (char c : path) {
+        if (c != '/' || key.empty() || key.back() != '/') {
+            key += c;
+        }
+    }
+    while (key.size() > 1 && key.back() == '/') {
+        key.pop_back();
+    }
+    return key;
+}
+
+void Add(OrbisFiosFH fh, std::shared_ptr<Psarc::Archive> archive, s32 order) {
+    auto& layer = *state.layers.emplace_back(
+        new Layer{fh, order, state.next_sequence++, std::move(archive)});
+    if (IgnoresCase(*layer.archive)) {
+        ++state.num_folded_layers;
+    }
+    u32 indexed = 0, overridden = 0;
+    ForEachPath(layer, [&](const std::string& key, u32 value) {
+        if (value != Psarc::DIRECTORY && Override::Claim(key, IgnoresCase(*layer.archive))) {
+            ++overridden;
+            return;
+        }
+        ++indexed;
+        std::vector<Provider>& providers = state.index[Md5::Digest(key)];
+        auto it = std::find_if(providers.begin(), providers.end(),
+                               [&](const Provider& p) { return layer.Above(*p.layer); });
+        providers.insert(it, {&layer, value});
+    });
+    LOG_INFO(Archive, "Mounted {} as layer {:#x} with order {}, {} paths indexed, {} overridden",
+             layer.archive->path, fh, order, indexed, overridden);
+}
+
+std::shared_ptr<Psarc::Archive> Remove(OrbisFiosFH fh) {
+    auto layer_it = std::find_if(state.layers.begin(), state.layers.end(),
+                                 [fh](const auto& layer) { return layer->fh == fh; });
+    if (layer_it == state.layers.end()) {
+        return nullptr;
+    }
+    const Layer& layer = **layer_it;
+    ForEachPath(layer, [&](const std::string& key, u32) {
+        auto it = state.index.find(Md5::Digest(key));
+        if (it == state.index.end()) {
+            return;
+        }
+        std::vector<Provider>& providers = it->second;
+        providers.erase(std::remove_if(providers.begin(), providers.end(),
+                                       [&](const Provider& p) { return p.layer == &layer; }),
+                        providers.end());
+        if (providers.empty()) {
+            state.index.erase(it);
+        }
+    });
+    if (IgnoresCase(*layer.archive)) {
+        --state.num_folded_layers;
+    }
+    std::shared_ptr<Psarc::Archive> archive = std::move((*layer_it)->archive);
+    state.layers.erase(layer_it);
+    return archive;
+}
+
+// Topmost provider of path of the wanted kind, looking the path up as given and, if any layer
+// ignores case, lowercased.
+static const Provider* Resolve(std::string_view path, bool directory) {
+    if (state.index.empty()) {
+        return nullptr;
+    }
+    const std::string key = ToKey(path);
+    const Provider* best = nullptr;
+    auto consider = [&](const std::string& key) {
+        auto it = state.index.find(Md5::Digest(key));
+        if (it == state.index.end()) {
+            return;
+        }
+        for (const Provider& provider : it->second) {
+            if ((provider.value == Psarc::DIRECTORY) == directory) {
+                if (best == nullptr || provider.layer->Above(*best->layer)) {
+                    best = &provider;
+                }
+                return;
+            }
+        }
+    };
+    consider(key);
+    if (state.num_folded_layers != 0) {
+        consider(FoldCase(key));
+    }
+    return best;
+}
+
+std::shared_ptr<Psarc::Archive> FindFile(std::string_view path, u32* pEntry) {
+    const Provider* provider = Resolve(path, false);
+    if (provider == nullptr) {
+        return nullptr;
+    }
+    *pEntry = provider->value;
+    return provider->layer->archive;
+}
+
+std::shared_ptr<Psarc::Archive> FindDirectory(std::string_view path) {
+    const Provider* provider = Resolve(path, true);
+    return provider ? provider->layer->archive : nullptr;
+}
+
+} // namespace Fios2::MountTable
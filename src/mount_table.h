@@ -0,0 +1,37 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "fios2.h"
+#include "psarc.h"
+#include "types.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace Fios2::MountTable {
+
+// Mounted archives as ordered layers, with one merged index from full game path to the layers
+// that provide it, so resolving a path costs one or two hash lookups however many layers are
+// mounted. Layers with a higher order shadow lower ones; among equal orders the newest mount wins.
+// Not thread-safe, fios2.cpp calls it with its lock held.
+
+// Normalizes a game path the way the index keys are: repeated and trailing slashes dropped.
+std::string ToKey(std::string_view path);
+
+// Adds every file and directory of the archive to the index, except files with a loose override.
+void Add(OrbisFiosFH fh, std::shared_ptr<Psarc::Archive> archive, s32 order);
+
+// Removes the layer mounted as fh from the index, touching only the paths it provided. Returns its
+// archive, or nullptr if fh isn't a mount.
+std::shared_ptr<Psarc::Archive> Remove(OrbisFiosFH fh);
+
+// Resolves a game path to a file in the topmost layer that has it.
+std::shared_ptr<Psarc::Archive> FindFile(std::string_view path, u32* pEntry);
+
+// Same for directories, including the mount points themselves.
+std::shared_ptr<Psarc::Archive> FindDirectory(std::string_view path);
+
+} // namespace Fios2::MountTable
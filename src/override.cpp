@@ -0,0 +1,140 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "override.h"
+#include "logging.h"
+#include "mount_table.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+
+#include <orbis/libkernel.h>
+
+namespace Fios2::Override {
+
+// Record layout of sceKernelGetdents, the FreeBSD struct dirent.
+struct KernelDirent {
+    u32 fileno;
+    u16 reclen;
+    u8 type;
+    u8 namlen;
+    char name[256];
+};
+
+constexpr u8 DT_DIRECTORY = 4;
+constexpr u8 DT_REGULAR = 8;
+
+// Heap allocated and never freed, see Cache::State.
+struct State {
+    std::shared_mutex mutex;
+    std::atomic<bool> any{false}; // lets Find skip the lock until there is an override
+    std::unordered_set<std::string> scanned_mount_points;
+    std::unordered_map<std::string, std::string> files;  // game path -> loose file
+    std::unordered_map<std::string, std::string> folded; // lowercase game path -> loose file
+    // Lowercase paths whose entry a case-insensitive layer left out for its override, so every case
+    // of them resolves to the loose file -> that file.
+    std::unordered_map<std::string, std::string> claimed_folded;
+};
+
+State& state = *new State();
+
+static std::string FoldCase(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(),
+                   [](char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+// Must be called with state.mutex held exclusively.
+static void Walk(const std::string& prefix, const std::string& directory, u32* pCount) {
+    s32 fd = sceKernelOpen(directory.c_str(), O_RDONLY | O_DIRECTORY, 0);
+    if (fd < 0) {
+        return;
+    }
+    std::vector<std::string> subdirectories;
+    char buf[4096];
+    s32 size;
+    while ((size = sceKernelGetdents(fd, buf, sizeof(buf))) > 0) {
+        for (s32 offset = 0; offset < size;) {
+            const auto* entry = reinterpret_cast<const KernelDirent*>(buf + offset);
+            if (entry->reclen == 0) {
+                break;
+            }
+            offset += entry->reclen;
+            const std::string_view name(entry->name, entry->namlen);
+            if (name == "." || name == "..") {
+                continue;
+            }
+            if (entry->type == DT_DIRECTORY) {
+                subdirectories.emplace_back(name);
+            } else if (entry->type == DT_REGULAR) {
+                std::string key = prefix + "/" + std::string(name);
+                std::string file = directory + "/" + std::string(name);
+                state.folded.emplace(FoldCase(key), file);
+                state.files.emplace(std::move(key), std::move(file));
+                ++*pCount;
+            }
+        }
+    }
+    sceKernelClose(fd);
+    for (const std::string& subdirectory : subdirectories) {
+        Walk(prefix + "/" + subdirectory, directory + "/" + subdirectory, pCount);
+    }
+}
+
+void Scan(std::string_view mount_point, const std::string& directory) {
+    const std::string prefix = MountTable::ToKey(mount_point);
+    std::unique_lock l{state.mutex};
+    if (!state.scanned_mount_points.insert(prefix).second) {
+        return;
+    }
+    u32 count = 0;
+    Walk(prefix == "/" ? "" : prefix, directory, &count);
+    if (count != 0) {
+        LOG_INFO(Paths, "{} loose files in {} override {}", count, directory, prefix);
+        state.any = true;
+    }
+}
+
+bool Claim(const std::string& key, bool folded) {
+    if (!state.any) {
+        return false;
+    }
+    if (!folded) {
+        std::shared_lock l{state.mutex};
+        return state.files.count(key) != 0;
+    }
+    std::unique_lock l{state.mutex};
+    auto it = state.folded.find(key);
+    if (it == state.folded.end()) {
+        return false;
+    }
+    state.claimed_folded.emplace(key, it->second);
+    return true;
+}
+
+const std::string* Find(std::string_view path) {
+    if (!state.any) {
+        return nullptr;
+    }
+    const std::string key = MountTable::ToKey(path);
+    std::shared_lock l{state.mutex};
+    // Entries are never removed and map nodes don't move, so the string outlives the lock.
+    auto it = state.files.find(key);
+    if (it != state.files.end()) {
+        return &it->second;
+    }
+    if (state.claimed_folded.empty()) {
+        return nullptr;
+    }
+    it = state.claimed_folded.find(FoldCase(key));
+    return it != state.claimed_folded.end() ? &it->second : nullptr;
+}
+
+} // namespace Fios2::Override
@@ -0,0 +1,32 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "types.h"
+
+#include <string>
+#include <string_view>
+
+namespace Fios2::Override {
+
+// Loose files that replace files of mounted archives. The files under
+// <Config::override_dir><mount point without /app0> override the archive paths they line up
+// with, and can add new ones. Each mount point's directory is walked once, when the first archive
+// is mounted there; after that the set is fixed, so opens never probe the filesystem for
+// overrides.
+
+// Walks directory (resolved to /app0) and records every file in it as an override for the same
+// relative path under mount_point. Does nothing if mount_point has been scanned before.
+void Scan(std::string_view mount_point, const std::string& directory);
+
+// True if key (a game path normalized by MountTable::ToKey, lowercased when folded) has a loose
+// override, which MountTable then leaves out of its index. A folded key is claimed for every case
+// of the path, the way the case-insensitive archive would have served it.
+bool Claim(const std::string& key, bool folded);
+
+// Returns the loose file that replaces the game path, or nullptr. Paths in any case match a claimed
+// folded key.
+const std::string* Find(std::string_view path);
+
+} // namespace Fios2::Override
@@ -0,0 +1,589 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "psarc.h"
+#include "block_cache.h"
+#include "config.h"
+#include "decompressor.h"
+#include "fios2_error.h"
+#include "inflate.h"
+#include "io_queue.h"
+#include "logging.h"
+#include "lzma_decoder.h"
+#include "md5.h"
+#include "psarc_verify.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+
+#include <orbis/libkernel.h>
+
+namespace Fios2::Psarc {
+
+// Everything in a PSARC is big-endian.
+static u32 ReadBE(const u8* p, u32 bytes) {
+    u32 value = 0;
+    for (u32 i = 0; i < bytes; ++i) {
+        value = value << 8 | p[i];
+    }
+    return value;
+}
+
+static u64 ReadBE40(const u8* p) {
+    return static_cast<u64>(p[0]) << 32 | ReadBE(p + 1, 4);
+}
+
+static std::string Normalize(std::string_view path, bool ignore_case) {
+    while (!path.empty() && path.front() == '/') {
+        path.remove_prefix(1);
+    }
+    while (!path.empty() && path.back() == '/') {
+        path.remove_suffix(1);
+    }
+    std::string result(path);
+    if (ignore_case) {
+        std::transform(result.begin(), result.end(), result.begin(),
+                       [](char c) { return static_cast<char>(std::tolower(c)); });
+    }
+    return result;
+}
+
+// Strips the mount point off a game path. Returns false if the path isn't under it.
+static bool ToArchivePath(const Archive& archive, std::string_view path, std::string* pOut) {
+    const std::string_view mount = archive.mount_point;
+    if (path.compare(0, mount.size(), mount) != 0 ||
+        (path.size() > mount.size() && path[mount.size()] != '/')) {
+        return false;
+    }
+    *pOut = Normalize(path.substr(mount.size()), archive.flags & FLAG_IGNORE_CASE);
+    return true;
+}
+
+// A normalized path spelled the way PSARC hashes it into the TOC: with the leading '/' of an
+// absolute-path archive, uppercase if the archive ignores case.
+static std::string HashedForm(const Archive& archive, std::string_view name) {
+    std::string hashed = archive.flags & FLAG_ABSOLUTE_PATHS ? "/" : "";
+    hashed += name;
+    if (archive.flags & FLAG_IGNORE_CASE) {
+        std::transform(hashed.begin(), hashed.end(), hashed.begin(),
+                       [](char c) { return static_cast<char>(std::toupper(c)); });
+    }
+    return hashed;
+}
+
+// Key of a normalized path in the name table. Never all zero, that marks an empty slot.
+static u128 NameDigest(const Archive& archive, std::string_view name) {
+    u128 digest = Md5::Digest(HashedForm(archive, name));
+    if (digest == u128{}) {
+        digest[0] = 1;
+    }
+    return digest;
+}
+
+static s64 ReadExact(s32 fd, void* pBuf, u64 length, u64 offset) {
+    IoQueue::DemandReadScope demand;
+    s64 ret = sceKernelPread(fd, pBuf, length, offset);
+    if (ret >= 0 && static_cast<u64>(ret) != length) {
+        return ORBIS_FIOS_ERROR_DECOMPRESSION; // truncated archive
+    }
+    return ret;
+}
+
+s64 DecompressBlock(const Archive& archive, const u8* src, u64 src_size, u8* dst, u64 dst_size) {
+    switch (archive.compression) {
+    case Compression::Zlib:
+        return Inflate::Zlib(src, src_size, dst, dst_size);
+    case Compression::Lzma:
+        return Lzma::DecodeAlone(src, src_size, dst, dst_size);
+    default:
+        return -1;
+    }
+}
+
+// What a mount learns from the TOC and the manifest before the index can be laid out. Only lives
+// for the duration of Mount (or GetIndexSize).
+struct Scan {
+    std::vector<u8> flat; // entries, block offsets and block sizes, as they go into the index
+    std::unordered_map<std::string, std::pair<u32, u128>> files; // path -> entry, NameDigest
+    std::unordered_set<std::string> directories;                 // path, "" is the root
+    u64 names_size = 0;
+};
+
+// Byte offsets of the index's tables from its start.
+struct Layout {
+    u64 block_offsets;
+    u64 block_sizes;
+    u64 slots;
+    u64 names;
+    u64 size;
+};
+
+static u64 AlignUp(u64 value, u64 alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static Layout ComputeLayout(const Archive& archive, const Scan& scan) {
+    Layout layout;
+    layout.block_offsets = archive.num_entries * sizeof(Entry);
+    layout.block_sizes = layout.block_offsets + archive.num_blocks * sizeof(u64);
+    layout.slots =
+        AlignUp(layout.block_sizes + archive.num_blocks * sizeof(u32), alignof(NameSlot));
+    layout.names = layout.slots + archive.num_slots * sizeof(NameSlot);
+    layout.size = layout.names + scan.names_size;
+    return layout;
+}
+
+// Pairs manifest lines with TOC entries by the MD5 of their path, which is what the TOC stores.
+// Falls back to manifest order for names that don't hash to any entry.
+static void IndexNames(const Archive& archive, std::string_view manifest,
+                       const std::vector<u128>& digests, Scan& scan) {
+    std::unordered_map<u64, u32> by_digest;
+    for (u32 i = 1; i < archive.num_entries; ++i) {
+        by_digest.emplace(digests[i][0], i);
+    }
+    const bool ignore_case = archive.flags & FLAG_IGNORE_CASE;
+    u32 line_index = 0;
+    while (!manifest.empty()) {
+        auto eol = manifest.find('\n');
+        std::string_view line = manifest.substr(0, eol);
+        manifest = eol == std::string_view::npos ? std::string_view{} : manifest.substr(eol + 1);
+        while (!line.empty() && (line.back() == '\r' || line.back() == '\0')) {
+            line.remove_suffix(1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+        ++line_index;
+
+        std::string hashed(line);
+        if (ignore_case) {
+            std::transform(hashed.begin(), hashed.end(), hashed.begin(),
+                           [](char c) { return static_cast<char>(std::toupper(c)); });
+        }
+        const u128 digest = Md5::Digest(hashed);
+        auto it = by_digest.find(digest[0]);
+        u32 entry = line_index;
+        if (it != by_digest.end() && digests[it->second] == digest) {
+            entry = it->second;
+        } else if (entry >= archive.num_entries) {
+            LOG_WARNING(Archive, "{}: no TOC entry for {}", archive.path, line);
+            continue;
+        }
+
+        std::string name = Normalize(line, ignore_case);
+        // The TOC digest doubles as the name table key when the line is already in hashed form,
+        // which it is in every archive the official tools write.
+        const u128 key = hashed == HashedForm(archive, name) && digest != u128{}
+                             ? digest
+                             : NameDigest(archive, name);
+        for (auto slash = name.find('/'); slash != std::string::npos;
+             slash = name.find('/', slash + 1)) {
+            if (scan.directories.emplace(name.substr(0, slash)).second) {
+                scan.names_size += slash + 1;
+            }
+        }
+        const u64 name_size = name.size() + 1;
+        if (scan.files.emplace(std::move(name), std::make_pair(entry, key)).second) {
+            scan.names_size += name_size;
+        }
+    }
+    if (scan.directories.emplace("").second) {
+        scan.names_size += 1;
+    }
+}
+
+// Reads the header, TOC and manifest of the archive open on archive.fd. On success the archive's
+// tables point into scan.flat and num_slots is sized for every name found.
+static s32 ScanArchive(Archive& archive, Scan& scan) {
+    auto fail = [&](const char* reason) {
+        LOG_ERROR(Archive, "Bad archive {}: {}", archive.path, reason);
+        return ORBIS_FIOS_ERROR_DECOMPRESSION;
+    };
+
+    u8 header[HEADER_SIZE];
+    if (ReadExact(archive.fd, header, HEADER_SIZE, 0) < 0 || ReadBE(header, 4) != MAGIC) {
+        return fail("not a PSARC");
+    }
+    if (std::memcmp(header + 8, "zlib", 4) == 0) {
+        archive.compression = Compression::Zlib;
+    } else if (std::memcmp(header + 8, "lzma", 4) == 0) {
+        archive.compression = Compression::Lzma;
+    } else {
+        return fail("unsupported compression");
+    }
+    const u32 toc_length = ReadBE(header + 12, 4);
+    const u32 entry_size = ReadBE(header + 16, 4);
+    archive.num_entries = ReadBE(header + 20, 4);
+    archive.block_size = ReadBE(header + 24, 4);
+    archive.flags = ReadBE(header + 28, 4);
+    const u64 entries_end = HEADER_SIZE + static_cast<u64>(archive.num_entries) * entry_size;
+    if (entry_size < TOC_ENTRY_SIZE || archive.num_entries == 0 || archive.block_size == 0 ||
+        entries_end > toc_length) {
+        return fail("bad TOC");
+    }
+
+    std::vector<u8> toc(toc_length);
+    if (ReadExact(archive.fd, toc.data(), toc_length, 0) < 0) {
+        return fail("truncated TOC");
+    }
+    // Block sizes take as few bytes as the block size needs.
+    const u32 size_bytes = archive.block_size <= 0x10000     ? 2
+                           : archive.block_size <= 0x1000000 ? 3
+                                                             : 4;
+    archive.num_blocks = static_cast<u32>((toc_length - entries_end) / size_bytes);
+
+    scan.flat.resize(archive.num_entries * sizeof(Entry) +
+                     archive.num_blocks * (sizeof(u64) + sizeof(u32)));
+    archive.entries = reinterpret_cast<Entry*>(scan.flat.data());
+    archive.block_offsets = reinterpret_cast<u64*>(archive.entries + archive.num_entries);
+    archive.block_sizes = reinterpret_cast<u32*>(archive.block_offsets + archive.num_blocks);
+
+    for (u32 i = 0; i < archive.num_blocks; ++i) {
+        const u32 size = ReadBE(&toc[entries_end + i * size_bytes], size_bytes);
+        archive.block_sizes[i] = size == 0 ? archive.block_size : size;
+    }
+    std::vector<u128> digests(archive.num_entries);
+    for (u32 i = 0; i < archive.num_entries; ++i) {
+        const u8* p = &toc[HEADER_SIZE + i * entry_size];
+        Entry& entry = archive.entries[i];
+        digests[i] = Md5::FromBytes(p);
+        entry.first_block = ReadBE(p + 16, 4);
+        entry.size = ReadBE40(p + 20);
+        entry.offset = ReadBE40(p + 25);
+        entry.flags = 0;
+
+        const u64 blocks = (entry.size + archive.block_size - 1) / archive.block_size;
+        if (entry.first_block + blocks > archive.num_blocks) {
+            return fail("entry runs past the block table");
+        }
+        // A file's blocks are stored back to back.
+        u64 offset = entry.offset;
+        for (u64 b = 0; b < blocks; ++b) {
+            const u32 block = entry.first_block + static_cast<u32>(b);
+            archive.block_offsets[block] = offset;
+            // The last block of a file is short; a stored size of 0 there still means raw.
+            const u64 block_length =
+                std::min<u64>(archive.block_size, entry.size - b * archive.block_size);
+            if (archive.block_sizes[block] > block_length) {
+                archive.block_sizes[block] = static_cast<u32>(block_length);
+            }
+            offset += archive.block_sizes[block];
+        }
+    }
+
+    std::string manifest(archive.entries[0].size, '\0');
+    s64 ret = Read(archive, 0, manifest.data(), manifest.size(), 0);
+    if (ret != static_cast<s64>(manifest.size())) {
+        return fail("can't read manifest");
+    }
+    IndexNames(archive, manifest, digests, scan);
+    // At most half full, so probe sequences stay short.
+    const u64 names = scan.files.size() + scan.directories.size();
+    archive.num_slots = 1;
+    while (archive.num_slots < 2 * names) {
+        archive.num_slots *= 2;
+    }
+    return ORBIS_OK;
+}
+
+// Opens path (already resolved to /app0) into archive.fd and scans it.
+static s32 OpenArchive(const char* path, Archive& archive, Scan& scan) {
+    static std::atomic<u32> next_id{1};
+    archive.id = next_id++;
+    archive.path = path;
+    archive.fd = sceKernelOpen(path, O_RDONLY, 0);
+    if (archive.fd < 0) {
+        LOG_ERROR(Archive, "Can't open archive {}: {:#x}", path, archive.fd);
+        return ORBIS_FIOS_ERROR_BAD_PATH;
+    }
+    s32 ret = ScanArchive(archive, scan);
+    if (ret != ORBIS_OK) {
+        sceKernelClose(archive.fd);
+        BlockCache::Drop(archive.id);
+    }
+    return ret;
+}
+
+s64 GetIndexSize(const char* path) {
+    Archive archive;
+    Scan scan;
+    s32 ret = OpenArchive(path, archive, scan);
+    if (ret != ORBIS_OK) {
+        return ret;
+    }
+    sceKernelClose(archive.fd);
+    BlockCache::Drop(archive.id);
+    return ComputeLayout(archive, scan).size;
+}
+
+s32 Mount(const char* path, const char* mount_point, Archive** ppOut) {
+    auto archive = std::make_unique<Archive>();
+    Scan scan;
+    s32 ret = OpenArchive(path, *archive, scan);
+    if (ret != ORBIS_OK) {
+        return ret;
+    }
+    archive->mount_point = mount_point;
+    while (archive->mount_point.size() > 1 && archive->mount_point.back() == '/') {
+        archive->mount_point.pop_back();
+    }
+    sceKernelFstat(archive->fd, (OrbisKernelStat*)&archive->stat);
+
+    const Layout layout = ComputeLayout(*archive, scan);
+    archive->index.reset(new u8[layout.size]);
+    u8* index = archive->index.get();
+    std::memcpy(index, scan.flat.data(), scan.flat.size());
+    archive->entries = reinterpret_cast<Entry*>(index);
+    archive->block_offsets = reinterpret_cast<u64*>(index + layout.block_offsets);
+    archive->block_sizes = reinterpret_cast<u32*>(index + layout.block_sizes);
+    archive->slots = reinterpret_cast<NameSlot*>(index + layout.slots);
+    char* names = reinterpret_cast<char*>(index + layout.names);
+    archive->names = names;
+
+    std::fill_n(archive->slots, archive->num_slots, NameSlot{});
+    const u32 mask = archive->num_slots - 1;
+    u32 name_offset = 0;
+    auto add = [&](const std::string& name, const u128& digest, u32 value) {
+        u32 slot = static_cast<u32>(digest[0]) & mask;
+        while (archive->slots[slot].digest != u128{}) {
+            slot = (slot + 1) & mask;
+        }
+        archive->slots[slot] = {digest, name_offset, value};
+        std::memcpy(names + name_offset, name.c_str(), name.size() + 1);
+        name_offset += static_cast<u32>(name.size() + 1);
+    };
+    for (const auto& [name, file] : scan.files) {
+        add(name, file.second, file.first);
+    }
+    for (const std::string& name : scan.directories) {
+        add(name, NameDigest(*archive, name), DIRECTORY);
+    }
+
+    const Config::Verify verify = Config::Get().verify_archives;
+    if (verify != Config::Verify::Off) {
+        if (verify == Config::Verify::Lazy) {
+            archive->block_checks.reset(new std::atomic<u8>[archive->num_blocks]());
+        }
+        const std::vector<u32> failed = VerifyEntries(*archive, verify == Config::Verify::Mount);
+        for (u32 entry : failed) {
+            LOG_ERROR(Archive, "{}: {} is corrupt, reads of it will fail", path,
+                      EntryName(*archive, entry));
+            archive->entries[entry].flags |= ENTRY_CORRUPT;
+        }
+        LOG_INFO(Archive, "Verified {}: {} of {} entries corrupt", path, failed.size(),
+                 archive->num_entries);
+    }
+
+    LOG_INFO(Archive, "Mounted {} at {}: {} files, {} blocks of {:#x}, {:#x} byte index", path,
+             archive->mount_point, scan.files.size(), archive->num_blocks, archive->block_size,
+             layout.size);
+    *ppOut = archive.release();
+    return ORBIS_OK;
+}
+
+void Close(Archive* archive) {
+    LOG_INFO(Archive, "Unmounting {} from {}", archive->path, archive->mount_point);
+    sceKernelClose(archive->fd);
+    BlockCache::Drop(archive->id);
+    delete archive;
+}
+
+// Probes the name table for a normalized path. Returns the matching slot, or nullptr. A file and a
+// directory of the same name share a digest, so a probe may step past one to find the other.
+static const NameSlot* Lookup(const Archive& archive, const std::string& name, bool directory) {
+    const u128 digest = NameDigest(archive, name);
+    const u32 mask = archive.num_slots - 1;
+    for (u32 slot = static_cast<u32>(digest[0]) & mask;; slot = (slot + 1) & mask) {
+        const NameSlot& s = archive.slots[slot];
+        if (s.digest == digest && (s.value == DIRECTORY) == directory) {
+            return &s;
+        }
+        if (s.digest == u128{}) {
+            return nullptr;
+        }
+    }
+}
+
+std::string EntryName(const Archive& archive, u32 entry) {
+    for (u32 i = 0; i < archive.num_slots; ++i) {
+        const NameSlot& slot = archive.slots[i];
+        if (slot.digest != u128{} && slot.value == entry) {
+            return archive.names + slot.name;
+        }
+    }
+    return entry == 0 ? "(manifest)" : "";
+}
+
+s32 FindFile(const Archive& archive, std::string_view path) {
+    std::string name;
+    if (!ToArchivePath(archive, path, &name)) {
+        return -1;
+    }
+    const NameSlot* slot = Lookup(archive, name, false);
+    return slot ? static_cast<s32>(slot->value) : -1;
+}
+
+bool IsDirectory(const Archive& archive, std::string_view path) {
+    std::string name;
+    return ToArchivePath(archive, path, &name) && Lookup(archive, name, true) != nullptr;
+}
+
+constexpr u64 PARALLEL_BATCH_BLOCKS = 64;
+
+// Reads [offset, offset + length) of an entry spanning several blocks: the blocks' compressed
+// data is contiguous, so it comes in with one read and the blocks then decompress in parallel,
+// whole ones straight into the caller's buffer and the partial ones at the edges via the block
+// cache.
+static s64 ReadParallel(const Archive& archive, const Entry& entry, u8* out, u64 length,
+                        u64 offset) {
+    const u64 first = offset / archive.block_size;
+    const u64 last = (offset + length - 1) / archive.block_size;
+    const u64 span_start = archive.block_offsets[entry.first_block + first];
+    const u64 span_end = archive.block_offsets[entry.first_block + last] +
+                         archive.block_sizes[entry.first_block + last];
+    Decompressor::Scratch span(span_end - span_start);
+    s64 ret = ReadExact(archive.fd, span.Data(), span_end - span_start, span_start);
+    if (ret < 0) {
+        return ret;
+    }
+
+    const u8* compressed = span.Data();
+    std::atomic<u32> corrupt_block{UINT32_MAX};
+    Decompressor::ParallelFor(static_cast<u32>(last - first + 1), [&](u32 i) {
+        const u64 b = first + i;
+        const u64 block_start = b * archive.block_size;
+        const u64 block_length = std::min<u64>(archive.block_size, entry.size - block_start);
+        const u64 begin = std::max(offset, block_start);
+        const u64 end = std::min(offset + length, block_start + block_length);
+        const u32 index = entry.first_block + static_cast<u32>(b);
+        const u32 stored = archive.block_sizes[index];
+        const u8* src = compressed + (archive.block_offsets[index] - span_start);
+        u8* dst = out + (begin - offset);
+
+        if (stored == block_length) {
+            std::memcpy(dst, src + (begin - block_start), end - begin);
+            return;
+        }
+        const bool partial = end - begin != block_length;
+        if (partial && BlockCache::Read(archive.id, index, dst, begin - block_start, end - begin)) {
+            return;
+        }
+        if (BlockFailed(archive, index)) {
+            u32 expected = UINT32_MAX;
+            corrupt_block.compare_exchange_strong(expected, index);
+            return;
+        }
+        Decompressor::Scratch block;
+        u8* target = dst;
+        if (partial) {
+            block.Resize(archive.block_size);
+            target = block.Data();
+        }
+        const bool ok = DecompressBlock(archive, src, stored, target, block_length) ==
+                        static_cast<s64>(block_length);
+        RecordBlock(archive, index, ok);
+        if (!ok) {
+            u32 expected = UINT32_MAX;
+            corrupt_block.compare_exchange_strong(expected, index);
+            return;
+        }
+        if (partial) {
+            std::memcpy(dst, target + (begin - block_start), end - begin);
+            BlockCache::Insert(archive.id, index, target, static_cast<u32>(block_length));
+        }
+    });
+    if (corrupt_block != UINT32_MAX) {
+        LOG_ERROR(Archive, "{}: block {} is corrupt", archive.path, corrupt_block.load());
+        return ORBIS_FIOS_ERROR_DECOMPRESSION;
+    }
+    return length;
+}
+
+s64 Read(const Archive& archive, u32 entry_index, void* pBuf, u64 length, u64 offset) {
+    const Entry& entry = archive.entries[entry_index];
+    if (offset >= entry.size) {
+        return 0;
+    }
+    if (entry.flags & ENTRY_CORRUPT) {
+        return ORBIS_FIOS_ERROR_DECOMPRESSION;
+    }
+    length = std::min(length, entry.size - offset);
+    if (Decompressor::GetThreadCount() > 1 &&
+        offset / archive.block_size != (offset + length - 1) / archive.block_size) {
+        // In batches, so the compressed span stays bounded on huge reads.
+        const u64 batch = PARALLEL_BATCH_BLOCKS * archive.block_size;
+        u64 done = 0;
+        while (done < length) {
+            const u64 pos = offset + done;
+            const u64 bytes = std::min(batch - pos % archive.block_size, length - done);
+            s64 ret = ReadParallel(archive, entry, static_cast<u8*>(pBuf) + done, bytes, pos);
+            if (ret < 0) {
+                return ret;
+            }
+            done += bytes;
+        }
+        return done;
+    }
+    Decompressor::Scratch compressed;
+    Decompressor::Scratch block;
+
+    u8* out = static_cast<u8*>(pBuf);
+    u64 done = 0;
+    while (done < length) {
+        const u64 pos = offset + done;
+        const u64 b = pos / archive.block_size;
+        const u64 in_block = pos % archive.block_size;
+        const u64 block_length =
+            std::min<u64>(archive.block_size, entry.size - b * archive.block_size);
+        const u64 bytes = std::min(block_length - in_block, length - done);
+        const u32 index = entry.first_block + static_cast<u32>(b);
+        const u32 stored = archive.block_sizes[index];
+        const u64 block_offset = archive.block_offsets[index];
+
+        if (stored == block_length) {
+            // Stored raw, read just the part we need.
+            s64 ret = ReadExact(archive.fd, out + done, bytes, block_offset + in_block);
+            if (ret < 0) {
+                return ret;
+            }
+        } else if (bytes != block_length &&
+                   BlockCache::Read(archive.id, index, out + done, in_block, bytes)) {
+            // Decompressed for an earlier partial read.
+        } else if (BlockFailed(archive, index)) {
+            return ORBIS_FIOS_ERROR_DECOMPRESSION;
+        } else {
+            compressed.Resize(stored);
+            s64 ret = ReadExact(archive.fd, compressed.Data(), stored, block_offset);
+            if (ret < 0) {
+                return ret;
+            }
+            // Whole blocks decompress straight into the caller's buffer. Partial ones go through
+            // scratch and into the block cache, the next read is likely to want more of them.
+            u8* target = out + done;
+            if (bytes != block_length) {
+                block.Resize(archive.block_size);
+                target = block.Data();
+            }
+            const bool ok = DecompressBlock(archive, compressed.Data(), stored, target,
+                                            block_length) == static_cast<s64>(block_length);
+            RecordBlock(archive, index, ok);
+            if (!ok) {
+                LOG_ERROR(Archive, "{}: block {} is corrupt", archive.path, index);
+                return ORBIS_FIOS_ERROR_DECOMPRESSION;
+            }
+            if (target != out + done) {
+                std::memcpy(out + done, target + in_block, bytes);
+                BlockCache::Insert(archive.id, index, target, static_cast<u32>(block_length));
+            }
+        }
+        done += bytes;
+    }
+    return done;
+}
+
+} // namespace Fios2::Psarc
@@ -0,0 +1,106 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "fios2.h"
+#include "types.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace Fios2::Psarc {
+
+constexpr u32 MAGIC = 0x50534152; // "PSAR"
+constexpr u32 HEADER_SIZE = 32;
+constexpr u32 TOC_ENTRY_SIZE = 30;
+
+constexpr u32 FLAG_IGNORE_CASE = 1;
+constexpr u32 FLAG_ABSOLUTE_PATHS = 2;
+
+enum class Compression : u8 {
+    Zlib,
+    Lzma,
+};
+
+struct Entry {
+    u64 offset;      // archive offset of the first block
+    u64 size;        // uncompressed
+    u32 first_block; // into Archive::block_offsets / block_sizes
+    u32 flags;       // ENTRY_*
+};
+
+// Failed verification on mount, reads of the entry fail up front.
+constexpr u32 ENTRY_CORRUPT = 1;
+
+constexpr u32 DIRECTORY = UINT32_MAX;
+
+// Open-addressing name table, kept at most half full and probed from digest[0]. Keyed by the same
+// MD5 the TOC stores for each path, so a lookup compares digests and never touches names.
+struct NameSlot {
+    u128 digest; // see NameDigest in psarc.cpp, all zero if the slot is empty
+    u32 name;    // offset of the normalized path in Archive::names
+    u32 value;   // entry index, or DIRECTORY
+};
+
+struct Archive {
+    std::string path;        // resolved archive path
+    std::string mount_point; // as passed by the game, without a trailing '/'
+    s32 fd = -1;
+    u32 id = 0; // unique per mount, keys the archive's blocks in the block cache
+    u32 block_size = 0;
+    u32 flags = 0;
+    Compression compression = Compression::Zlib;
+    // Flat index in index: entries, block offsets and sizes, the name table and the names it
+    // points to. Entry 0 is the manifest. Never moves, so handles and streams read it without a
+    // lock for as long as they keep the archive alive, unmounted or not.
+    u32 num_entries = 0;
+    u32 num_blocks = 0;
+    u32 num_slots = 0; // power of two
+    Entry* entries = nullptr;
+    u64* block_offsets = nullptr;
+    u32* block_sizes = nullptr; // stored size of each block, equal to the block's size if raw
+    NameSlot* slots = nullptr;
+    const char* names = nullptr; // NUL-terminated normalized paths, "" is the root
+    std::unique_ptr<u8[]> index;
+    // Per block, what reading it found so far. Only allocated for lazy verification.
+    std::unique_ptr<std::atomic<u8>[]> block_checks;
+    _OrbisKernelStat stat{}; // of the archive file, for dates
+};
+
+// Size of the index Mount builds for the archive at path (already resolved to /app0), what
+// sceFiosArchiveGetMountBufferSize reports, or a FIOS error.
+s64 GetIndexSize(const char* path);
+
+// Opens the archive at path (already resolved to /app0) and indexes it. Returns ORBIS_OK or a FIOS
+// error; on success *ppOut owns the archive's descriptor. The index lives on the heap rather than
+// in the game's mount buffer: reads that are still running when the archive is unmounted would
+// otherwise race the game reusing the buffer.
+s32 Mount(const char* path, const char* mount_point, Archive** ppOut);
+
+// Closes the archive's descriptor, drops its cached blocks and frees it.
+void Close(Archive* archive);
+
+// Path of an entry inside the archive, or "" if the manifest doesn't name it. Walks the name
+// table, for error reports only.
+std::string EntryName(const Archive& archive, u32 entry);
+
+// Looks up a game path under the archive's mount point. Returns the entry index, or -1 if the path
+// isn't a file in the archive.
+s32 FindFile(const Archive& archive, std::string_view path);
+
+// True if path is the mount point or a directory inside the archive.
+bool IsDirectory(const Archive& archive, std::string_view path);
+
+// Reads [offset, offset + length) of an entry's uncompressed data, decompressing the blocks it
+// touches. Safe to call from several threads at once. Returns the bytes read (clamped at the end of
+// the entry) or a FIOS error.
+s64 Read(const Archive& archive, u32 entry, void* pBuf, u64 length, u64 offset);
+
+// Decompresses one stored block of dst_size bytes with the archive's codec. Returns the bytes
+// written, which are dst_size unless the block is corrupt.
+s64 DecompressBlock(const Archive& archive, const u8* src, u64 src_size, u8* dst, u64 dst_size);
+
+} // namespace Fios2::Psarc
@@ -0,0 +1,224 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "psarc_stream.h"
+#include "fios2_error.h"
+#include "io_queue.h"
+#include "logging.h"
+#include "psarc_verify.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <vector>
+
+#include <orbis/libkernel.h>
+
+namespace Fios2::Psarc {
+
+enum class SlotState : u8 {
+    Reading,       // compressed data requested from the I/O workers
+    Compressed,    // waiting for the worker
+    Decompressing, // on the worker
+    Ready,
+    Failed,
+};
+
+// Ring slot, holding block b of the entry in slot b % ring size.
+struct Slot {
+    u64 block = UINT64_MAX;
+    SlotState state = SlotState::Reading;
+    s32 error = 0;
+    std::vector<u8> compressed;
+    std::vector<u8> data;
+};
+
+struct StreamState {
+    std::shared_ptr<const Archive> archive;
+    Entry entry;
+    u64 num_blocks;
+
+    std::mutex mutex;
+    std::condition_variable worker_cv; // the window moved, compressed data came in, or stop
+    std::condition_variable ready_cv;  // a slot became ready or failed
+    std::vector<Slot> slots;
+    u64 window = 0; // block the reader is on, the ring covers it and the ones after it
+    bool stop = false;
+};
+
+// Reads the compressed data of blocks [first, last] with one pread and hands each block to its
+// slot, unless the window has moved past it in the meantime.
+static void ReadAhead(const std::shared_ptr<StreamState>& s, u64 first, u64 last) {
+    const Archive& archive = *s->archive;
+    {
+        std::scoped_lock l{s->mutex};
+        if (s->stop) {
+            return;
+        }
+    }
+    const u32 first_index = s->entry.first_block + static_cast<u32>(first);
+    const u32 last_index = s->entry.first_block + static_cast<u32>(last);
+    const u64 start = archive.block_offsets[first_index];
+    const u64 end = archive.block_offsets[last_index] + archive.block_sizes[last_index];
+    std::vector<u8> span(end - start);
+    s64 ret = sceKernelPread(archive.fd, span.data(), span.size(), start);
+    if (ret >= 0 && static_cast<u64>(ret) != span.size()) {
+        ret = ORBIS_FIOS_ERROR_DECOMPRESSION; // truncated archive
+    }
+
+    std::scoped_lock l{s->mutex};
+    const u64 ring = s->slots.size();
+    for (u64 b = first; b <= last; ++b) {
+        Slot& slot = s->slots[b % ring];
+        if (slot.block != b || slot.state != SlotState::Reading) {
+            continue;
+        }
+        if (ret < 0) {
+            slot.state = SlotState::Failed;
+            slot.error = static_cast<s32>(ret);
+            continue;
+        }
+        const u32 index = s->entry.first_block + static_cast<u32>(b);
+        const u8* src = span.data() + (archive.block_offsets[index] - start);
+        slot.compressed.assign(src, src + archive.block_sizes[index]);
+        slot.state = SlotState::Compressed;
+    }
+    s->worker_cv.notify_one();
+    s->ready_cv.notify_all();
+}
+
+// Keeps the window's slots claimed and read ahead, and decompresses whatever has come in, nearest
+// to the reader first.
+static void WorkerLoop(std::shared_ptr<StreamState> s) {
+    const Archive& archive = *s->archive;
+    const u64 ring = s->slots.size();
+    std::vector<u8> compressed;
+    std::vector<u8> data;
+    std::unique_lock l{s->mutex};
+    while (!s->stop) {
+        const u64 end = std::min(s->window + ring, s->num_blocks);
+        // Slots the window has moved past take the blocks that are now in it, each run of them
+        // read with one pread.
+        u64 run_start = UINT64_MAX;
+        for (u64 b = s->window; b <= end; ++b) {
+            Slot* slot = b < end ? &s->slots[b % ring] : nullptr;
+            if (slot && slot->block != b) {
+                slot->block = b;
+                slot->state = SlotState::Reading;
+                run_start = std::min(run_start, b);
+            } else if (run_start != UINT64_MAX) {
+                IoQueue::Submit(IoQueue::Priority::Prefetch,
+                                [s, run_start, last = b - 1] { ReadAhead(s, run_start, last); });
+                run_start = UINT64_MAX;
+            }
+        }
+
+        Slot* next = nullptr;
+        for (u64 b = s->window; b < end && next == nullptr; ++b) {
+            Slot& slot = s->slots[b % ring];
+            if (slot.block == b && slot.state == SlotState::Compressed) {
+                next = &slot;
+            }
+        }
+        if (next == nullptr) {
+            s->worker_cv.wait(l);
+            continue;
+        }
+        const u64 b = next->block;
+        next->state = SlotState::Decompressing;
+        compressed.swap(next->compressed);
+        l.unlock();
+
+        const u64 block_length =
+            std::min<u64>(archive.block_size, s->entry.size - b * archive.block_size);
+        bool ok = true;
+        if (compressed.size() == block_length) {
+            data.swap(compressed); // stored raw
+        } else {
+            data.resize(block_length);
+            ok = DecompressBlock(archive, compressed.data(), compressed.size(), data.data(),
+                                 block_length) == static_cast<s64>(block_length);
+        }
+
+        RecordBlock(archive, s->entry.first_block + static_cast<u32>(b), ok);
+        l.lock();
+        if (next->block != b || next->state != SlotState::Decompressing) {
+            continue; // the window moved on while this block was decompressing
+        }
+        if (ok) {
+            next->data.swap(data);
+            next->state = SlotState::Ready;
+        } else {
+            LOG_ERROR(Archive, "{}: block {} is corrupt", archive.path, s->entry.first_block + b);
+            next->state = SlotState::Failed;
+            next->error = ORBIS_FIOS_ERROR_DECOMPRESSION;
+        }
+        s->ready_cv.notify_all();
+    }
+}
+
+Stream::Stream(std::shared_ptr<const Archive> archive, u32 entry, u64 offset, u32 ring_blocks)
+    : state(std::make_shared<StreamState>()) {
+    state->entry = archive->entries[entry];
+    state->window = offset / archive->block_size;
+    state->num_blocks = (state->entry.size + archive->block_size - 1) / archive->block_size;
+    state->slots.resize(std::max<u32>(ring_blocks, 2));
+    LOG_DEBUG(Archive, "Streaming entry {} of {} with {} blocks ready ahead", entry, archive->path,
+              state->slots.size() - 1);
+    state->archive = std::move(archive);
+    worker = std::thread(WorkerLoop, state);
+}
+
+Stream::~Stream() {
+    {
+        std::scoped_lock l{state->mutex};
+        state->stop = true;
+    }
+    state->worker_cv.notify_one();
+    worker.join();
+}
+
+s64 Stream::Read(void* pBuf, u64 length, u64 offset) {
+    std::scoped_lock r{read_mutex};
+    StreamState& s = *state;
+    const u64 size = s.entry.size;
+    const u64 block_size = s.archive->block_size;
+    if (offset >= size) {
+        return 0;
+    }
+    length = std::min(length, size - offset);
+
+    u8* out = static_cast<u8*>(pBuf);
+    u64 done = 0;
+    while (done < length) {
+        const u64 pos = offset + done;
+        const u64 b = pos / block_size;
+        const u64 in_block = pos % block_size;
+        const u64 bytes = std::min(std::min<u64>(block_size, size - b * block_size) - in_block,
+                                   length - done);
+        Slot& slot = s.slots[b % s.slots.size()];
+        {
+            std::unique_lock l{s.mutex};
+            if (s.window != b) {
+                s.window = b;
+                s.worker_cv.notify_one();
+            }
+            s.ready_cv.wait(l, [&] {
+                return slot.block == b &&
+                       (slot.state == SlotState::Ready || slot.state == SlotState::Failed);
+            });
+            if (slot.state == SlotState::Failed) {
+                // Let a retry read the block again.
+                slot.block = UINT64_MAX;
+                s.worker_cv.notify_one();
+                return done > 0 ? static_cast<s64>(done) : slot.error;
+            }
+        }
+        // With the window on b, the worker leaves this slot alone until the next read moves it.
+        std::memcpy(out + done, slot.data.data() + in_block, bytes);
+        done += bytes;
+    }
+    return done;
+}
+
+} // namespace Fios2::Psarc
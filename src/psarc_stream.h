@@ -0,0 +1,44 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "psarc.h"
+#include "types.h"
+
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace Fios2::Psarc {
+
+struct StreamState;
+
+// Sequential reader of one archive entry, for handles that stream a large compressed file (video,
+// audio banks). The compressed data of the blocks ahead of the reader is read on the I/O workers
+// and decompressed on a worker of the stream's own into a ring of ready blocks, so disk reads,
+// decompression and the game's reads all overlap instead of taking turns block by block.
+class Stream {
+public:
+    // Sequential reads in a row after which a handle switches to a stream.
+    static constexpr u32 CONFIRM_READS = 2;
+
+    // Starts reading ahead from offset. ring_blocks decompressed blocks are kept, the one being
+    // read and the ones after it.
+    Stream(std::shared_ptr<const Archive> archive, u32 entry, u64 offset, u32 ring_blocks);
+    ~Stream();
+    Stream(const Stream&) = delete;
+    Stream& operator=(const Stream&) = delete;
+
+    // Reads [offset, offset + length) of the entry, waiting for the ring to get there. Reading
+    // anywhere else than just past the last read moves the ring. Returns the bytes read (clamped at
+    // the end of the entry) or a FIOS error, like Psarc::Read.
+    s64 Read(void* pBuf, u64 length, u64 offset);
+
+private:
+    std::shared_ptr<StreamState> state; // shared with read-ahead still queued on the I/O workers
+    std::thread worker;
+    std::mutex read_mutex; // one reader at a time, the ring only moves forward under it
+};
+
+} // namespace Fios2::Psarc
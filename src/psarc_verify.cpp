@@ -0,0 +1,120 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "psarc_verify.h"
+#include "decompressor.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include <orbis/libkernel.h>
+
+namespace Fios2::Psarc {
+
+// Blocks read with one pread by a verification task.
+constexpr u32 VERIFY_BATCH_BLOCKS = 64;
+
+struct Batch {
+    u32 entry;
+    u32 first; // block index of the entry, not of the archive
+    u32 count;
+};
+
+static u64 NumBlocks(const Archive& archive, const Entry& entry) {
+    return (entry.size + archive.block_size - 1) / archive.block_size;
+}
+
+static bool InsideFile(const Archive& archive, const Entry& entry) {
+    const u64 file_size = archive.stat.st_size;
+    const u64 blocks = NumBlocks(archive, entry);
+    for (u64 b = 0; b < blocks; ++b) {
+        const u32 index = entry.first_block + static_cast<u32>(b);
+        if (archive.block_offsets[index] + archive.block_sizes[index] > file_size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<u32> VerifyEntries(const Archive& archive, bool decode) {
+    std::unique_ptr<std::atomic<bool>[]> bad(new std::atomic<bool>[archive.num_entries]());
+    std::vector<Batch> batches;
+    for (u32 i = 0; i < archive.num_entries; ++i) {
+        const Entry& entry = archive.entries[i];
+        if (!InsideFile(archive, entry)) {
+            bad[i] = true;
+            continue;
+        }
+        const u64 blocks = NumBlocks(archive, entry);
+        for (u64 b = 0; decode && b < blocks; b += VERIFY_BATCH_BLOCKS) {
+            const u64 count = std::min<u64>(VERIFY_BATCH_BLOCKS, blocks - b);
+            batches.push_back({i, static_cast<u32>(b), static_cast<u32>(count)});
+        }
+    }
+
+    const u32 threads =
+        std::max(Decompressor::GetThreadCount(), std::thread::hardware_concurrency());
+    Decompressor::ParallelFor(static_cast<u32>(batches.size()), threads, [&](u32 i) {
+        const Batch& batch = batches[i];
+        const Entry& entry = archive.entries[batch.entry];
+        const u32 first = entry.first_block + batch.first;
+        const u32 last = first + batch.count - 1;
+        const u64 start = archive.block_offsets[first];
+        const u64 span_size = archive.block_offsets[last] + archive.block_sizes[last] - start;
+        Decompressor::Scratch span(span_size);
+        if (sceKernelPread(archive.fd, span.Data(), span_size, start) !=
+            static_cast<s64>(span_size)) {
+            bad[batch.entry] = true;
+            return;
+        }
+        Decompressor::Scratch block(archive.block_size);
+        for (u32 index = first; index <= last; ++index) {
+            const u64 block_start =
+                static_cast<u64>(index - entry.first_block) * archive.block_size;
+            const u64 block_length = std::min<u64>(archive.block_size, entry.size - block_start);
+            const u32 stored = archive.block_sizes[index];
+            if (stored != block_length &&
+                DecompressBlock(archive, span.Data() + (archive.block_offsets[index] - start),
+                                stored, block.Data(),
+                                block_length) != static_cast<s64>(block_length)) {
+                bad[batch.entry] = true;
+                return;
+            }
+        }
+    });
+
+    std::vector<u32> failed;
+    for (u32 i = 0; i < archive.num_entries; ++i) {
+        if (bad[i]) {
+            failed.push_back(i);
+        }
+    }
+    return failed;
+}
+
+void RecordBlock(const Archive& archive, u32 block, bool ok) {
+    // Blocks already known good are left alone, so after its first read a block costs the shared
+    // table nothing but a load.
+    if (!archive.block_checks ||
+        (ok && archive.block_checks[block].load(std::memory_order_relaxed) == BLOCK_GOOD)) {
+        return;
+    }
+    const u8 previous = archive.block_checks[block].exchange(ok ? BLOCK_GOOD : BLOCK_BAD,
+                                                             std::memory_order_relaxed);
+    if (ok || previous == BLOCK_BAD) {
+        return;
+    }
+    for (u32 i = 0; i < archive.num_entries; ++i) {
+        const Entry& entry = archive.entries[i];
+        if (block >= entry.first_block && block < entry.first_block + NumBlocks(archive, entry)) {
+            LOG_ERROR(Archive, "{}: {} is corrupt at block {}", archive.path, EntryName(archive, i),
+                      block - entry.first_block);
+            return;
+        }
+    }
+}
+
+} // namespace Fios2::Psarc
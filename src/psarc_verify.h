@@ -0,0 +1,37 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "psarc.h"
+#include "types.h"
+
+#include <vector>
+
+namespace Fios2::Psarc {
+
+// Integrity checks for archives from bad mod installs, so a corrupt entry fails its reads with an
+// error naming it instead of handing the game garbage. Selected by
+// Config::Options::verify_archives.
+
+constexpr u8 BLOCK_UNCHECKED = 0;
+constexpr u8 BLOCK_GOOD = 1;
+constexpr u8 BLOCK_BAD = 2;
+
+// Checks that every entry's blocks lie inside the archive file and, with decode set, that every
+// compressed block decodes to exactly its length. Decoding reads the blocks in batches and spreads
+// them over every core. Returns the entries that failed, in order.
+std::vector<u32> VerifyEntries(const Archive& archive, bool decode);
+
+// Lazy verification, a no-op unless the archive has block_checks: true if reading the block
+// already failed once, so reads of it can fail without decoding it again.
+inline bool BlockFailed(const Archive& archive, u32 block) {
+    return archive.block_checks &&
+           archive.block_checks[block].load(std::memory_order_relaxed) == BLOCK_BAD;
+}
+
+// Records the outcome of decoding a block, reporting the entry the first time one of its blocks
+// fails.
+void RecordBlock(const Archive& archive, u32 block, bool ok);
+
+} // namespace Fios2::Psarc
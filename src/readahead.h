@@ -0,0 +1,90 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "types.h"
+
+#include <algorithm>
+
+namespace Fios2 {
+
+// Per-handle access pattern detector. Once a handle has done a few sequential (or constant-stride)
+// reads, it asks for readahead into the read cache, doubling the window each time the reader
+// catches up with it; any read that breaks the pattern drops the window back to zero.
+class Readahead {
+public:
+    static constexpr u64 MIN_WINDOW = 128_KB;
+    static constexpr u32 CONFIRM_READS = 2;
+    // Past this stride, records are too far apart for one contiguous readahead to be worth it and
+    // each upcoming record is prefetched on its own instead.
+    static constexpr u64 MAX_CONTIGUOUS_STRIDE = 256_KB;
+    static constexpr u32 MAX_STRIDED_RECORDS = 16;
+
+    // Records a read of [offset, offset + length) and calls issue(offset, length) for every range
+    // that should be read ahead.
+    template <typename Issue>
+    void OnRead(u64 offset, u64 length, u64 max_window, Issue&& issue);
+
+    // True once the handle has been confirmed as a sequential stream.
+    bool Sequential() const {
+        return streak > CONFIRM_READS && stride == static_cast<s64>(last_length);
+    }
+
+private:
+    u64 last_offset = 0;
+    u64 last_length = 0;
+    s64 stride = 0;
+    u32 streak = 0;
+    u64 window = 0;
+    u64 issued_end = 0; // readahead has been requested up to here
+};
+
+template <typename Issue>
+void Readahead::OnRead(u64 offset, u64 length, u64 max_window, Issue&& issue) {
+    const s64 delta = static_cast<s64>(offset - last_offset);
+    const bool sequential = offset == last_offset + last_length;
+    if (streak > 0 && (sequential || delta == stride)) {
+        ++streak;
+    } else {
+        // Random access (or the first read): forget about any readahead in flight.
+        streak = 1;
+        window = 0;
+        issued_end = 0;
+    }
+    stride = delta;
+    last_offset = offset;
+    last_length = length;
+    if (streak <= CONFIRM_READS || length == 0 || stride <= 0) {
+        return;
+    }
+
+    const u64 read_end = offset + length;
+    if (stride > static_cast<s64>(MAX_CONTIGUOUS_STRIDE)) {
+        // Far-apart records: fetch the next few records themselves, not the gaps in between.
+        const u64 records = window == 0 ? 2 : std::min<u64>(window / length, MAX_STRIDED_RECORDS);
+        window = std::min<u64>(std::max(window * 2, MIN_WINDOW), max_window);
+        for (u64 i = 1; i <= records; ++i) {
+            const u64 record = offset + i * stride;
+            if (record + length > issued_end) {
+                issue(record, length);
+            }
+        }
+        issued_end = offset + records * stride + length;
+        return;
+    }
+
+    // Start the next window once the reader is within half a window of the end of the last one.
+    if (window != 0 && read_end + window / 2 <= issued_end) {
+        return;
+    }
+    window = std::min<u64>(std::max(window * 2, MIN_WINDOW), max_window);
+    const u64 start = std::max(issued_end, read_end);
+    const u64 end = read_end + window;
+    if (end > start) {
+        issue(start, end - start);
+        issued_end = end;
+    }
+}
+
+} // namespace Fios2
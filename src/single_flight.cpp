@@ -0,0 +1,96 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "single_flight.h"
+#include "io_queue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include <orbis/libkernel.h>
+
+namespace Fios2::SingleFlight {
+
+// A kernel read in progress. Lives on the stack of the thread doing the read, which doesn't return
+// until every follower has copied its part out of the buffer.
+struct Flight {
+    const Cache::File* file;
+    u64 offset;
+    u64 length;
+    const u8* buf;
+    s64 result = 0;
+    bool done = false;
+    u32 followers = 0;
+};
+
+// Heap allocated and never freed, see IoQueue::State.
+struct State {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<Flight*> flights; // only reads that haven't finished yet
+    std::atomic<u64> deduplicated_bytes{0};
+};
+
+State& state = *new State();
+
+static Flight* FindCovering(const Cache::File* file, u64 offset, u64 length) {
+    for (Flight* flight : state.flights) {
+        if (flight->file == file && flight->offset <= offset &&
+            offset + length <= flight->offset + flight->length) {
+            return flight;
+        }
+    }
+    return nullptr;
+}
+
+s64 Pread(const Cache::File* file, s32 fd, void* pBuf, u64 length, u64 offset) {
+    std::unique_lock l{state.mutex};
+    if (Flight* flight = FindCovering(file, offset, length)) {
+        ++flight->followers;
+        state.cv.wait(l, [flight] { return flight->done; });
+        const s64 result = flight->result;
+        u64 bytes = 0;
+        if (result >= 0) {
+            // A short leader read means end of file, which cuts this read short as well.
+            const u64 skip = offset - flight->offset;
+            bytes = static_cast<u64>(result) > skip ? std::min<u64>(length, result - skip) : 0;
+            std::memcpy(pBuf, flight->buf + skip, bytes);
+        }
+        if (--flight->followers == 0) {
+            state.cv.notify_all();
+        }
+        if (result >= 0) {
+            state.deduplicated_bytes.fetch_add(bytes, std::memory_order_relaxed);
+            return bytes;
+        }
+        // The leader failed, try again with a read of our own.
+    }
+
+    Flight flight{file, offset, length, static_cast<const u8*>(pBuf)};
+    state.flights.push_back(&flight);
+    l.unlock();
+    s64 ret;
+    {
+        IoQueue::DemandReadScope demand;
+        ret = sceKernelPread(fd, pBuf, length, offset);
+    }
+    l.lock();
+    state.flights.erase(std::find(state.flights.begin(), state.flights.end(), &flight));
+    flight.result = ret;
+    flight.done = true;
+    if (flight.followers > 0) {
+        state.cv.notify_all();
+        state.cv.wait(l, [&flight] { return flight.followers == 0; });
+    }
+    return ret;
+}
+
+u64 GetDeduplicatedBytes() {
+    return state.deduplicated_bytes.load(std::memory_order_relaxed);
+}
+
+} // namespace Fios2::SingleFlight
@@ -0,0 +1,22 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "types.h"
+
+namespace Fios2::Cache {
+struct File;
+}
+
+namespace Fios2::SingleFlight {
+
+// Demand read of [offset, offset + length) through fd. If another thread already has a kernel read
+// in flight on the same file that covers the whole range, waits for it and copies from its buffer
+// instead of issuing a second read. Returns the byte count or the kernel error, like pread.
+s64 Pread(const Cache::File* file, s32 fd, void* pBuf, u64 length, u64 offset);
+
+// Total bytes served by copying from another thread's read.
+u64 GetDeduplicatedBytes();
+
+} // namespace Fios2::SingleFlight
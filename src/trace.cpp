@@ -0,0 +1,316 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "trace.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <pthread.h>
+
+#include <orbis/libkernel.h>
+
+namespace Fios2::Trace {
+
+// Enough for 800k reads per second per thread, far more than any game does.
+constexpr u32 RING_SIZE = 8192; // records, a power of two
+constexpr u32 CALL_RING_SIZE = 4096;
+constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(10);
+
+// Single producer (the owning thread), single consumer (whoever holds State::write_mutex).
+template <typename T, u32 Size>
+struct Ring {
+    T records[Size];
+    std::atomic<u64> head{0}; // next record the owner writes
+    std::atomic<u64> tail{0}; // next record the flusher takes
+    std::atomic<u64> dropped{0};
+
+    void Push(const T& record) {
+        const u64 h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == Size) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        records[h % Size] = record;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    bool Empty() const {
+        return tail.load(std::memory_order_relaxed) == head.load(std::memory_order_relaxed);
+    }
+
+    // For a new owner, once the ring is empty and its old owner gone.
+    void Reset() {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+        dropped.store(0, std::memory_order_relaxed);
+    }
+};
+
+struct ThreadRings {
+    Ring<Record, RING_SIZE> reads;
+    Ring<Call, CALL_RING_SIZE> calls;
+    u32 thread = 0;
+    std::atomic<bool> released{false}; // owning thread exited
+    // The owner's last interned path, so repeated reads of one path skip State::mutex. Ids never
+    // change, so it stays valid for the next owner too.
+    std::string last_path;
+    u32 last_path_id = NO_PATH;
+};
+
+// Heap allocated and never freed, see Cache::State. A thread's rings go back to the free list once
+// the thread has exited and they have been written out, and are numbered anew when reused.
+struct State {
+    std::atomic<bool> enabled{false};
+    std::atomic<bool> calls{false};
+    std::chrono::steady_clock::time_point start;
+    s32 fd = -1;
+
+    std::mutex mutex; // guards the fields below
+    std::vector<ThreadRings*> rings;
+    std::vector<ThreadRings*> free_rings;
+    u32 next_thread = 0;
+    u64 released_dropped = 0; // dropped by rings since recycled
+    std::unordered_map<std::string, u32> paths;
+    std::vector<std::pair<u32, std::string>> new_paths; // not written out yet
+
+    std::mutex write_mutex; // one flush at a time, guards the fields below
+    std::vector<u8> out;
+    u64 reported_dropped = 0;
+};
+
+State& state = *new State();
+
+// Calls currently being recorded on this thread, only the outermost one is.
+thread_local u32 call_depth = 0;
+
+constexpr const char* API_NAMES[] = {
+    "ArchiveMount",    "ArchiveMountSync", "ArchiveUnmount",  "ArchiveUnmountSync", "DHOpen",
+    "DHOpenSync",      "DHClose",          "DHCloseSync",     "Exists",             "ExistsSync",
+    "FHOpen",          "FHOpenSync",       "FHClose",         "FHCloseSync",        "FHGetSize",
+    "FHPread",         "FHPreadSync",      "FHPreadv",        "FHPreadvSync",       "FHRead",
+    "FHReadSync",      "FHReadv",          "FHReadvSync",     "FHSeek",             "FileExists",
+    "FileExistsSync",  "FileGetSize",      "FileGetSizeSync", "FileRead",           "FileReadSync",
+    "OpDelete",        "OpSyncWait",       "OpSyncWaitForIO", "OpWait",             "Stat",
+    "StatSync",
+};
+static_assert(std::size(API_NAMES) == static_cast<size_t>(Api::Count));
+
+const char* ApiName(Api api) {
+    return api < Api::Count ? API_NAMES[static_cast<u32>(api)] : "?";
+}
+
+static u64 Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                                state.start)
+        .count();
+}
+
+// Marks a thread's rings for reuse when the thread exits. Through a pthread key, thread_local
+// destructors never run here (see __cxa_thread_atexit_impl in assert.cpp).
+static void ReleaseRings(void* rings) {
+    static_cast<ThreadRings*>(rings)->released.store(true, std::memory_order_release);
+}
+
+static ThreadRings& GetRings() {
+    thread_local ThreadRings* rings = nullptr;
+    if (rings == nullptr) [[unlikely]] {
+        static const pthread_key_t owner = [] {
+            pthread_key_t key;
+            pthread_key_create(&key, ReleaseRings);
+            return key;
+        }();
+        {
+            std::scoped_lock l{state.mutex};
+            if (state.free_rings.empty()) {
+                rings = new ThreadRings();
+            } else {
+                rings = state.free_rings.back();
+                state.free_rings.pop_back();
+            }
+            rings->thread = state.next_thread++;
+            state.rings.push_back(rings);
+        }
+        pthread_setspecific(owner, rings);
+    }
+    return *rings;
+}
+
+static void Append(std::vector<u8>& out, ChunkKind kind, const void* pData, u32 size,
+                   const void* pPrefix = nullptr, u32 prefix_size = 0) {
+    const ChunkHeader header{kind, prefix_size + size};
+    const u8* bytes = reinterpret_cast<const u8*>(&header);
+    out.insert(out.end(), bytes, bytes + sizeof(header));
+    out.insert(out.end(), static_cast<const u8*>(pPrefix),
+               static_cast<const u8*>(pPrefix) + prefix_size);
+    out.insert(out.end(), static_cast<const u8*>(pData), static_cast<const u8*>(pData) + size);
+}
+
+// Moves the unread part of a ring, in at most two pieces, into chunks of kind.
+template <typename T, u32 Size>
+static void Drain(Ring<T, Size>& ring, ChunkKind kind, const u32& thread, std::vector<u8>& out) {
+    const u64 tail = ring.tail.load(std::memory_order_relaxed);
+    const u64 head = ring.head.load(std::memory_order_acquire);
+    const u64 first = tail % Size;
+    const u64 count = head - tail;
+    const u64 before_wrap = std::min<u64>(count, Size - first);
+    if (count != 0) {
+        Append(out, kind, ring.records + first, static_cast<u32>(before_wrap * sizeof(T)), &thread,
+               sizeof(thread));
+    }
+    if (count > before_wrap) {
+        Append(out, kind, ring.records, static_cast<u32>((count - before_wrap) * sizeof(T)),
+               &thread, sizeof(thread));
+    }
+    ring.tail.store(head, std::memory_order_release);
+}
+
+void Flush() {
+    if (!state.enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    std::scoped_lock w{state.write_mutex};
+    std::vector<std::pair<u32, std::string>> new_paths;
+    std::vector<ThreadRings*> rings;
+    {
+        std::scoped_lock l{state.mutex};
+        new_paths.swap(state.new_paths);
+        rings = state.rings;
+    }
+    std::vector<u8>& out = state.out;
+    out.clear();
+    for (const auto& [id, path] : new_paths) {
+        Append(out, ChunkKind::Path, path.data(), static_cast<u32>(path.size()), &id, sizeof(id));
+    }
+    for (ThreadRings* ring : rings) {
+        Drain(ring->reads, ChunkKind::Records, ring->thread, out);
+        Drain(ring->calls, ChunkKind::Calls, ring->thread, out);
+    }
+    if (!out.empty() && sceKernelWrite(state.fd, out.data(), out.size()) < 0) {
+        LOG_ERROR(General, "Can't write the access trace");
+    }
+    u64 dropped = 0;
+    {
+        std::scoped_lock l{state.mutex};
+        for (auto it = state.rings.begin(); it != state.rings.end();) {
+            ThreadRings* ring = *it;
+            const u64 ring_dropped = ring->reads.dropped.load(std::memory_order_relaxed) +
+                                     ring->calls.dropped.load(std::memory_order_relaxed);
+            // The owner is gone, so once empty nothing can be added to the rings anymore.
+            if (ring->released.load(std::memory_order_acquire) && ring->reads.Empty() &&
+                ring->calls.Empty()) {
+                state.released_dropped += ring_dropped;
+                ring->reads.Reset();
+                ring->calls.Reset();
+                ring->released.store(false, std::memory_order_relaxed);
+                state.free_rings.push_back(ring);
+                it = state.rings.erase(it);
+                continue;
+            }
+            dropped += ring_dropped;
+            ++it;
+        }
+        dropped += state.released_dropped;
+    }
+    if (dropped != state.reported_dropped) {
+        LOG_WARNING(General, "Access trace dropped {} records, the flusher can't keep up", dropped);
+        state.reported_dropped = dropped;
+    }
+}
+
+static void FlushLoop() {
+    while (true) {
+        std::this_thread::sleep_for(FLUSH_INTERVAL);
+        Flush();
+    }
+}
+
+void Start(const char* path, bool calls) {
+    state.fd = sceKernelOpen(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (state.fd < 0) {
+        LOG_ERROR(General, "Can't create access trace {}: {:#x}", path, state.fd);
+        return;
+    }
+    const FileHeader header{MAGIC, VERSION};
+    sceKernelWrite(state.fd, &header, sizeof(header));
+    state.start = std::chrono::steady_clock::now();
+    state.calls.store(calls, std::memory_order_relaxed);
+    state.enabled.store(true, std::memory_order_release);
+    std::thread(FlushLoop).detach();
+    LOG_INFO(General, "Recording an access trace{} to {}", calls ? " with calls" : "", path);
+    // The last interval's records, often the end of a loading screen.
+    std::atexit(Flush);
+}
+
+bool Enabled() {
+    return state.enabled.load(std::memory_order_relaxed);
+}
+
+u32 Intern(std::string_view path) {
+    ThreadRings& rings = GetRings();
+    if (rings.last_path_id != NO_PATH && rings.last_path == path) {
+        return rings.last_path_id;
+    }
+    std::scoped_lock l{state.mutex};
+    auto [it, inserted] =
+        state.paths.emplace(std::string(path), static_cast<u32>(state.paths.size()));
+    if (inserted) {
+        state.new_paths.emplace_back(it->second, it->first);
+    }
+    rings.last_path = it->first;
+    rings.last_path_id = it->second;
+    return it->second;
+}
+
+void OnRead(u32 path, u64 offset, u64 length) {
+    GetRings().reads.Push(
+        {Now(), offset, static_cast<u32>(std::min<u64>(length, UINT32_MAX)), path});
+}
+
+CallScope::CallScope(Api api, const char* pPath, u64 arg0, u64 arg1, u64 arg2, u64 arg3) {
+    if (!state.calls.load(std::memory_order_relaxed)) {
+        return;
+    }
+    counted = true;
+    if (call_depth++ != 0) {
+        return;
+    }
+    active = true;
+    call.api = api;
+    call.path = pPath ? Intern(pPath) : NO_PATH;
+    call.args[0] = arg0;
+    call.args[1] = arg1;
+    call.args[2] = arg2;
+    call.args[3] = arg3;
+    call.time = Now();
+}
+
+CallScope::~CallScope() {
+    if (!counted) {
+        return;
+    }
+    --call_depth;
+    if (active) {
+        call.duration = Now() - call.time;
+        if (out_handle) {
+            call.args[2] = static_cast<u64>(*out_handle);
+        }
+        GetRings().calls.Push(call);
+    }
+}
+
+void CallScope::SetPathArg(u32 index, const char* pPath) {
+    if (active && pPath) {
+        call.args[index] = Intern(pPath);
+    }
+}
+
+} // namespace Fios2::Trace
@@ -0,0 +1,156 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "types.h"
+
+#include <string_view>
+
+namespace Fios2::Trace {
+
+// Access trace of the game's reads, for repacking archives in the order they are read (see
+// tools/trace_manifest.cpp), and optionally of its sceFios* calls, for replaying them off-console
+// (see tools/fios_replay.cpp). Each thread records into rings of its own and a background thread
+// appends the rings to the trace file, so a traced read costs a clock read and a few stores.
+
+// File format, little-endian: a FileHeader, then chunks, each a ChunkHeader and size bytes of
+// payload. A path's chunk isn't necessarily written before the records that use it. Readers skip
+// chunks of kinds they don't know.
+constexpr u32 MAGIC = 0x43525446; // "FTRC"
+constexpr u32 VERSION = 1;
+
+struct FileHeader {
+    u32 magic;
+    u32 version;
+};
+
+enum class ChunkKind : u32 {
+    Path = 1,    // u32 id, then the path as passed by the game, not NUL-terminated
+    Records = 2, // u32 thread, then (size - 4) / sizeof(Record) records of that thread
+    Calls = 3,   // u32 thread, then (size - 4) / sizeof(Call) calls made on that thread
+};
+
+struct ChunkHeader {
+    ChunkKind kind;
+    u32 size;
+};
+
+// Threads are numbered in the order of their first traced read.
+struct Record {
+    u64 time; // ns since recording started
+    u64 offset;
+    u32 length; // bytes read
+    u32 path;   // id from a Path chunk
+};
+static_assert(sizeof(Record) == 24);
+
+constexpr u32 NO_PATH = UINT32_MAX;
+
+// sceFios* functions recorded with Config::Options::trace_calls, with what Call::args hold for
+// each. A Sync function is recorded as itself, not as its async half and the wait, and the
+// WithOrder / WithMode variants as the plain function. A handle returned through an out pointer is
+// always args[2].
+enum class Api : u32 {
+    ArchiveMount, // mount point path id, buffer length, fh out, order
+    ArchiveMountSync,
+    ArchiveUnmount, // fh
+    ArchiveUnmountSync,
+    DHOpen, // buffer length, -, dh out
+    DHOpenSync,
+    DHClose, // dh
+    DHCloseSync,
+    Exists,
+    ExistsSync,
+    FHOpen, // open flags, native mode, fh out
+    FHOpenSync,
+    FHClose, // fh
+    FHCloseSync,
+    FHGetSize, // fh
+    FHPread,   // fh, length, offset
+    FHPreadSync,
+    FHPreadv, // fh, total length, offset, buffer count
+    FHPreadvSync,
+    FHRead, // fh, length
+    FHReadSync,
+    FHReadv, // fh, total length, -, buffer count
+    FHReadvSync,
+    FHSeek, // fh, offset, whence
+    FileExists,
+    FileExistsSync,
+    FileGetSize,
+    FileGetSizeSync,
+    FileRead, // length, offset
+    FileReadSync,
+    OpDelete,        // op
+    OpSyncWait,      // op
+    OpSyncWaitForIO, // op
+    OpWait,          // op
+    Stat,
+    StatSync,
+    Count,
+};
+
+// Name of the function without the sceFios prefix.
+const char* ApiName(Api api);
+
+struct Call {
+    u64 time;     // ns since recording started, when the call was made
+    u64 duration; // ns until it returned
+    s64 result;   // as returned, an op for the async functions
+    u64 args[4];  // see Api
+    u32 path;     // id from a Path chunk, or NO_PATH
+    Api api;
+};
+static_assert(sizeof(Call) == 64);
+
+// Starts recording into path, replacing the file, with the calls too if calls is set. Called on
+// the first FIOS call when the config sets trace_path.
+void Start(const char* path, bool calls = false);
+
+bool Enabled();
+
+// Id of a game path in the trace, written out with the next flush the first time it's seen. Only
+// locks for a path other than the one the calling thread interned last.
+u32 Intern(std::string_view path);
+
+// Records a read. Never blocks: if the flusher falls a whole ring behind, the record is dropped and
+// counted instead.
+void OnRead(u32 path, u64 offset, u64 length);
+
+// Records the sceFios* call it's created in when it goes out of scope. A no-op unless calls are
+// being recorded, and for calls made while another is being recorded on the same thread.
+class CallScope {
+public:
+    CallScope(Api api, const char* pPath, u64 arg0 = 0, u64 arg1 = 0, u64 arg2 = 0,
+              u64 arg3 = 0);
+    ~CallScope();
+
+    CallScope(const CallScope&) = delete;
+    CallScope& operator=(const CallScope&) = delete;
+
+    // The handle the call returns through pHandle, read when the call returns.
+    void SetOutHandle(const s32* pHandle) {
+        out_handle = pHandle;
+    }
+    // A second path, stored as its id.
+    void SetPathArg(u32 index, const char* pPath);
+
+    template <typename T>
+    T Return(T result) {
+        call.result = static_cast<s64>(result);
+        return result;
+    }
+
+private:
+    Call call{};
+    const s32* out_handle = nullptr;
+    bool counted = false; // in the thread's call depth
+    bool active = false;
+};
+
+// Writes everything recorded so far to the trace file. The background thread does this every few
+// milliseconds, this is for getting a complete trace before exiting.
+void Flush();
+
+} // namespace Fios2::Trace
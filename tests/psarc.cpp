@@ -0,0 +1,386 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Builds PSARC fixtures with the host zlib and liblzma, mounts them through sceFiosArchiveMount
+// and checks every read path against the original data, with one and several decompressor threads.
+//
+// Usage: psarc
+// Built by `make host` as build/host/tests/psarc and run by `make check`; fixtures are written to
+// $FIOS2_APP0 (default /tmp).
+// Exits with the number of failed checks.
+
+#include "config.h"
+#include "fios2.h"
+#include "fios2_error.h"
+#include "psarc_writer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+
+#include <orbis/libkernel.h>
+
+using namespace Fios2;
+using namespace Fios2::Test;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                                                \
+    do {                                                                                           \
+        if (!(cond)) {                                                                             \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);          \
+            ++failures;                                                                            \
+        }                                                                                          \
+    } while (0)
+
+static void CheckArchive(const std::string& app0, const char* archive_name, const char* mount,
+                         const std::vector<FixtureFile>& files, u32 block_size, u32 flags,
+                         bool lzma = false) {
+    WritePsarc(app0 + "/" + archive_name, files, block_size, flags, lzma);
+    const std::string archive_path = std::string("/app0/") + archive_name;
+    const s64 buffer_size = sceFiosArchiveGetMountBufferSizeSync(nullptr, archive_path.c_str(),
+                                                                 nullptr);
+    CHECK(buffer_size > 0);
+    // The index lives in here for as long as the archive is mounted, which is the rest of the run.
+    // The guard bytes past the requested size must stay untouched.
+    std::vector<u8>& mount_buffer = *new std::vector<u8>(buffer_size + 64, 0xAB);
+    OrbisFiosFH archive_fh = -1;
+    CHECK(sceFiosArchiveMountSync(nullptr, &archive_fh, archive_path.c_str(), mount,
+                                  {mount_buffer.data(), static_cast<u64>(buffer_size)},
+                                  nullptr) == ORBIS_OK);
+    CHECK(archive_fh >= 0);
+    CHECK(std::all_of(mount_buffer.begin() + buffer_size, mount_buffer.end(),
+                      [](u8 b) { return b == 0xAB; }));
+
+    for (const FixtureFile& file : files) {
+        std::string name = std::string(mount) + "/" + file.name;
+        if (flags & 1) {
+            std::transform(name.begin() + std::strlen(mount), name.end(),
+                           name.begin() + std::strlen(mount), ::toupper);
+        }
+        const s64 size = file.data.size();
+        CHECK(sceFiosExistsSync(nullptr, name.c_str()));
+        CHECK(sceFiosFileGetSizeSync(nullptr, name.c_str()) == size);
+        OrbisFiosStat stat{};
+        CHECK(sceFiosStatSync(nullptr, name.c_str(), &stat) == ORBIS_OK);
+        CHECK(stat.fileSize == size);
+
+        OrbisFiosFH fh = -1;
+        CHECK(sceFiosFHOpenSync(nullptr, &fh, name.c_str(), nullptr) == ORBIS_OK);
+        CHECK(sceFiosFHGetSize(fh) == size);
+        std::vector<u8> buf(size + 100);
+        // Sequential reads in odd sizes, straddling block boundaries.
+        s64 done = 0;
+        for (s64 chunk = 1; done < size; chunk = chunk * 3 + 7) {
+            s64 ret = sceFiosFHReadSync(nullptr, fh, buf.data() + done, chunk);
+            CHECK(ret == std::min(chunk, size - done));
+            if (ret <= 0) {
+                break;
+            }
+            done += ret;
+        }
+        CHECK(sceFiosFHReadSync(nullptr, fh, buf.data(), 10) == 0);
+        CHECK(std::memcmp(buf.data(), file.data.data(), size) == 0);
+
+        std::fill(buf.begin(), buf.end(), 0);
+        CHECK(sceFiosFHPreadSync(nullptr, fh, buf.data(), size + 100, 0) == size);
+        CHECK(std::memcmp(buf.data(), file.data.data(), size) == 0);
+        if (size > 10) {
+            const s64 offset = size / 2 + 3;
+            CHECK(sceFiosFHPreadSync(nullptr, fh, buf.data(), 10, offset) == 10);
+            CHECK(std::memcmp(buf.data(), file.data.data() + offset, 10) == 0);
+            CHECK(sceFiosFHSeek(fh, -10, SceFiosWhence::End) == size - 10);
+
+            std::vector<u8> first(size / 3), second(size - size / 3);
+            OrbisFiosBuffer iov[] = {{first.data(), first.size()}, {second.data(), second.size()}};
+            CHECK(sceFiosFHPreadvSync(nullptr, fh, iov, 2, 0) == size);
+            CHECK(std::memcmp(first.data(), file.data.data(), first.size()) == 0);
+            CHECK(std::memcmp(second.data(), file.data.data() + first.size(), second.size()) == 0);
+
+            CHECK(sceFiosFileReadSync(nullptr, name.c_str(), buf.data(), 10, offset) == 10);
+            CHECK(std::memcmp(buf.data(), file.data.data() + offset, 10) == 0);
+        }
+        // A negative length is refused before it can reach the decompressor or the stream.
+        CHECK(sceFiosFHPreadSync(nullptr, fh, buf.data(), -1, 0) == ORBIS_FIOS_ERROR_BAD_SIZE);
+        CHECK(sceFiosFHReadSync(nullptr, fh, buf.data(), -1) == ORBIS_FIOS_ERROR_BAD_SIZE);
+        CHECK(sceFiosFileReadSync(nullptr, name.c_str(), buf.data(), -1, 0) ==
+              ORBIS_FIOS_ERROR_BAD_SIZE);
+        CHECK(std::all_of(buf.begin() + size, buf.end(), [](u8 b) { return b == 0; }));
+        CHECK(sceFiosFHCloseSync(nullptr, fh) == ORBIS_OK);
+    }
+    CHECK(sceFiosExistsSync(nullptr, mount));
+    CHECK(!sceFiosExistsSync(nullptr, (std::string(mount) + "/missing.bin").c_str()));
+}
+
+// A patch layer mounted with a higher order shadows the base archive even when mounted first, and
+// unmounting it uncovers the base again.
+static void CheckLayers(const std::string& app0) {
+    const std::vector<u8> base_a = MakeData(10_KB, 7, true), base_b = MakeData(100_KB, 8, true);
+    const std::vector<u8> patch_b = MakeData(90_KB, 9, true), patch_c = MakeData(5_KB, 10, false);
+    WritePsarc(app0 + "/layer_base.psarc", {{"a.bin", base_a}, {"dir/b.bin", base_b}}, 64_KB, 0);
+    WritePsarc(app0 + "/layer_patch.psarc", {{"dir/b.bin", patch_b}, {"dir/c.bin", patch_c}},
+               64_KB, 0);
+
+    std::vector<u8> patch_buffer(sceFiosArchiveGetMountBufferSizeSync(
+        nullptr, "/app0/layer_patch.psarc", nullptr));
+    std::vector<u8>& base_buffer = *new std::vector<u8>(
+        sceFiosArchiveGetMountBufferSizeSync(nullptr, "/app0/layer_base.psarc", nullptr));
+    OrbisFiosFH patch_fh = -1, base_fh = -1;
+    CHECK(sceFiosArchiveMountWithOrderSync(nullptr, &patch_fh, "/app0/layer_patch.psarc",
+                                           "/app0/layers", {patch_buffer.data(),
+                                                            patch_buffer.size()},
+                                           nullptr, 1) == ORBIS_OK);
+    CHECK(sceFiosArchiveMountWithOrderSync(nullptr, &base_fh, "/app0/layer_base.psarc",
+                                           "/app0/layers", {base_buffer.data(), base_buffer.size()},
+                                           nullptr, 0) == ORBIS_OK);
+
+    CHECK(sceFiosFileGetSizeSync(nullptr, "/app0/layers/a.bin") == 10_KB);
+    CHECK(sceFiosFileGetSizeSync(nullptr, "/app0/layers/dir/b.bin") == 90_KB);
+    CHECK(sceFiosFileGetSizeSync(nullptr, "/app0/layers/dir/c.bin") == 5_KB);
+    CHECK(sceFiosExistsSync(nullptr, "/app0/layers/dir"));
+
+    // A handle into the patch outlives its unmount, and the game can reuse the mount buffer.
+    OrbisFiosFH fh = -1;
+    CHECK(sceFiosFHOpenSync(nullptr, &fh, "/app0/layers/dir/b.bin", nullptr) == ORBIS_OK);
+    CHECK(sceFiosArchiveUnmountSync(nullptr, patch_fh) == ORBIS_OK);
+    std::fill(patch_buffer.begin(), patch_buffer.end(), 0xCD);
+    std::vector<u8> buf(patch_b.size());
+    CHECK(sceFiosFHPreadSync(nullptr, fh, buf.data(), buf.size(), 0) == 90_KB);
+    CHECK(buf == patch_b);
+    CHECK(sceFiosFHCloseSync(nullptr, fh) == ORBIS_OK);
+
+    CHECK(sceFiosFileGetSizeSync(nullptr, "/app0/layers/dir/b.bin") == 100_KB);
+    CHECK(!sceFiosExistsSync(nullptr, "/app0/layers/dir/c.bin"));
+    CHECK(sceFiosArchiveUnmountSync(nullptr, patch_fh) == ORBIS_FIOS_ERROR_BAD_FH);
+    CHECK(sceFiosArchiveUnmountSync(nullptr, base_fh) == ORBIS_OK);
+    CHECK(!sceFiosExistsSync(nullptr, "/app0/layers/a.bin"));
+}
+
+// Unmounting while another thread is still reading the archive through an open handle, streamed
+// and by path, leaves those reads intact however the game reuses the mount buffer.
+static void CheckUnmountDuringRead(const std::string& app0) {
+    const std::vector<u8> data = MakeData(1_MB + 3, 11, true);
+    WritePsarc(app0 + "/unmount_race.psarc", {{"big.bin", data}}, 4_KB, 0);
+    for (int attempt = 0; attempt < 8; ++attempt) {
+        std::vector<u8> buffer(
+            sceFiosArchiveGetMountBufferSizeSync(nullptr, "/app0/unmount_race.psarc", nullptr));
+        OrbisFiosFH mount_fh = -1, fh = -1;
+        CHECK(sceFiosArchiveMountSync(nullptr, &mount_fh, "/app0/unmount_race.psarc",
+                                      "/app0/unmount_race", {buffer.data(), buffer.size()},
+                                      nullptr) == ORBIS_OK);
+        CHECK(sceFiosFHOpenSync(nullptr, &fh, "/app0/unmount_race/big.bin", nullptr) == ORBIS_OK);
+        std::atomic<bool> started{false};
+        bool intact = true;
+        std::thread reader([&] {
+            std::vector<u8> buf(data.size());
+            for (u64 offset = 0; offset < data.size(); offset += 8_KB) {
+                const s64 length = std::min<u64>(8_KB, data.size() - offset);
+                intact &= sceFiosFHReadSync(nullptr, fh, buf.data() + offset, length) == length;
+                started = true;
+            }
+            intact &= buf == data;
+        });
+        while (!started) {
+            std::this_thread::yield();
+        }
+        CHECK(sceFiosArchiveUnmountSync(nullptr, mount_fh) == ORBIS_OK);
+        std::fill(buffer.begin(), buffer.end(), 0xCD);
+        reader.join();
+        CHECK(intact);
+        CHECK(sceFiosFHCloseSync(nullptr, fh) == ORBIS_OK);
+    }
+}
+
+// With an override directory set, loose files under it replace the archive's files and add new
+// ones, while everything else still comes from the archive.
+static void CheckOverrides(const std::string& app0) {
+    const std::vector<u8> packed_a = MakeData(20_KB, 11, true);
+    const std::vector<u8> packed_b = MakeData(70_KB, 12, true);
+    const std::vector<u8> loose_b = MakeData(3000, 13, false), loose_new = MakeData(100, 14, true);
+    WritePsarc(app0 + "/modded.psarc", {{"a.bin", packed_a}, {"dir/b.bin", packed_b}}, 64_KB, 0);
+    const std::string mods = app0 + "/mods/modded";
+    mkdir((app0 + "/mods").c_str(), 0755);
+    mkdir(mods.c_str(), 0755);
+    mkdir((mods + "/dir").c_str(), 0755);
+    auto write = [](const std::string& path, const std::vector<u8>& data) {
+        FILE* f = std::fopen(path.c_str(), "wb");
+        std::fwrite(data.data(), 1, data.size(), f);
+        std::fclose(f);
+    };
+    write(mods + "/dir/b.bin", loose_b);
+    write(mods + "/new.bin", loose_new);
+
+    Config::Get().override_dir = "/app0/mods";
+    std::vector<u8>& mount_buffer = *new std::vector<u8>(64_KB);
+    OrbisFiosFH archive_fh = -1;
+    CHECK(sceFiosArchiveMountSync(nullptr, &archive_fh, "/app0/modded.psarc", "/app0/modded",
+                                  {mount_buffer.data(), mount_buffer.size()}, nullptr) == ORBIS_OK);
+    Config::Get().override_dir.clear();
+
+    CHECK(sceFiosFileGetSizeSync(nullptr, "/app0/modded/a.bin") == 20_KB);
+    CHECK(sceFiosFileGetSizeSync(nullptr, "/app0/modded/dir/b.bin") == 3000);
+    CHECK(sceFiosFileGetSizeSync(nullptr, "/app0/modded/new.bin") == 100);
+    std::vector<u8> buf(loose_b.size());
+    OrbisFiosFH fh = -1;
+    CHECK(sceFiosFHOpenSync(nullptr, &fh, "/app0/modded/dir/b.bin", nullptr) == ORBIS_OK);
+    CHECK(sceFiosFHPreadSync(nullptr, fh, buf.data(), buf.size(), 0) == 3000);
+    CHECK(buf == loose_b);
+    CHECK(sceFiosFHCloseSync(nullptr, fh) == ORBIS_OK);
+    buf.resize(packed_a.size());
+    CHECK(sceFiosFileReadSync(nullptr, "/app0/modded/a.bin", buf.data(), buf.size(), 0) == 20_KB);
+    CHECK(buf == packed_a);
+    CHECK(sceFiosArchiveUnmountSync(nullptr, archive_fh) == ORBIS_OK);
+
+    // Over a case-insensitive archive the override answers to the path in any case, as the
+    // archive's own file did.
+    WritePsarc(app0 + "/modded_nocase.psarc", {{"Dir/B.bin", packed_b}}, 64_KB, 1);
+    const std::string nocase_mods = app0 + "/mods/modded_nocase";
+    mkdir(nocase_mods.c_str(), 0755);
+    mkdir((nocase_mods + "/dir").c_str(), 0755);
+    write(nocase_mods + "/dir/b.bin", loose_b);
+    Config::Get().override_dir = "/app0/mods";
+    CHECK(sceFiosArchiveMountSync(nullptr, &archive_fh, "/app0/modded_nocase.psarc",
+                                  "/app0/modded_nocase", {mount_buffer.data(), mount_buffer.size()},
+                                  nullptr) == ORBIS_OK);
+    Config::Get().override_dir.clear();
+    for (const char* path : {"/app0/modded_nocase/dir/b.bin", "/app0/modded_nocase/DIR/B.BIN",
+                             "/app0/modded_nocase/Dir/B.bin"}) {
+        CHECK(sceFiosExistsSync(nullptr, path));
+        CHECK(sceFiosFileGetSizeSync(nullptr, path) == 3000);
+        buf.assign(loose_b.size(), 0);
+        CHECK(sceFiosFHOpenSync(nullptr, &fh, path, nullptr) == ORBIS_OK);
+        CHECK(sceFiosFHPreadSync(nullptr, fh, buf.data(), buf.size(), 0) == 3000);
+        CHECK(buf == loose_b);
+        CHECK(sceFiosFHCloseSync(nullptr, fh) == ORBIS_OK);
+    }
+    CHECK(sceFiosArchiveUnmountSync(nullptr, archive_fh) == ORBIS_OK);
+}
+
+// An archive whose last block is damaged: without verification only reads of that block fail,
+// verifying on mount fails every read of the damaged file up front, and lazy verification fails
+// the block again without decoding it. The other file reads fine throughout.
+static void CheckVerify(const std::string& app0) {
+    const std::vector<u8> good = MakeData(70_KB, 21, true), damaged = MakeData(200_KB, 22, true);
+    const std::string path = app0 + "/damaged.psarc";
+    WritePsarc(path, {{"good.bin", good}, {"damaged.bin", damaged}}, 64_KB, 0);
+    FILE* f = std::fopen(path.c_str(), "r+b");
+    std::fseek(f, -40, SEEK_END);
+    const u8 garbage[16] = {0xde, 0xad, 0xbe, 0xef, 0xde, 0xad, 0xbe, 0xef,
+                            0xde, 0xad, 0xbe, 0xef, 0xde, 0xad, 0xbe, 0xef};
+    std::fwrite(garbage, 1, sizeof(garbage), f);
+    std::fclose(f);
+
+    std::vector<u8> buf(damaged.size());
+    using Config::Verify;
+    for (Verify verify : {Verify::Off, Verify::Mount, Verify::Lazy}) {
+        Config::Get().verify_archives = verify;
+        std::vector<u8>& mount_buffer = *new std::vector<u8>(64_KB);
+        OrbisFiosFH archive_fh = -1;
+        CHECK(sceFiosArchiveMountSync(nullptr, &archive_fh, "/app0/damaged.psarc",
+                                      "/app0/damaged", {mount_buffer.data(), mount_buffer.size()},
+                                      nullptr) == ORBIS_OK);
+        CHECK(sceFiosFileReadSync(nullptr, "/app0/damaged/good.bin", buf.data(), good.size(), 0) ==
+              static_cast<s64>(good.size()));
+        CHECK(std::memcmp(buf.data(), good.data(), good.size()) == 0);
+        const s64 first_block = verify == Verify::Mount ? ORBIS_FIOS_ERROR_DECOMPRESSION : 1000;
+        CHECK(sceFiosFileReadSync(nullptr, "/app0/damaged/damaged.bin", buf.data(), 1000, 0) ==
+              first_block);
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            CHECK(sceFiosFileReadSync(nullptr, "/app0/damaged/damaged.bin", buf.data(), 1000,
+                                      damaged.size() - 1000) == ORBIS_FIOS_ERROR_DECOMPRESSION);
+        }
+        CHECK(sceFiosArchiveUnmountSync(nullptr, archive_fh) == ORBIS_OK);
+    }
+    Config::Get().verify_archives = Verify::Off;
+}
+
+// A handle reading an archive file front to back in small pieces switches to a stream with a ring
+// smaller than the file; seeking back and reading on, and reading past the end, still come out
+// right.
+static void CheckStream(const char* path, const std::vector<u8>& data) {
+    Config::Get().stream_blocks = 3;
+    OrbisFiosFH fh = -1;
+    CHECK(sceFiosFHOpenSync(nullptr, &fh, path, nullptr) == ORBIS_OK);
+    const s64 size = data.size();
+    std::vector<u8> buf(size);
+    for (s64 pass = 0; pass < 2; ++pass) {
+        const s64 start = pass == 0 ? 0 : size / 3;
+        CHECK(sceFiosFHSeek(fh, start, SceFiosWhence::Set) == start);
+        s64 done = start;
+        while (done < size) {
+            const s64 ret = sceFiosFHReadSync(nullptr, fh, buf.data() + done, 10000);
+            CHECK(ret == std::min<s64>(10000, size - done));
+            if (ret <= 0) {
+                break;
+            }
+            done += ret;
+        }
+        CHECK(std::memcmp(buf.data() + start, data.data() + start, size - start) == 0);
+    }
+    CHECK(sceFiosFHCloseSync(nullptr, fh) == ORBIS_OK);
+    Config::Get().stream_blocks = 8;
+}
+
+int main() {
+    const char* env = std::getenv("FIOS2_APP0");
+    const std::string app0 = env ? env : "/tmp";
+
+    std::vector<FixtureFile> files = {
+        {"readme.txt", MakeData(1234, 1, true)},
+        {"data/empty.bin", {}},
+        {"data/random.bin", MakeData(300_KB + 17, 2, false)},
+        {"data/levels/level1.dat", MakeData(1_MB + 5, 3, true)},
+        {"data/levels/exact.dat", MakeData(128_KB, 4, true)},
+    };
+    CheckArchive(app0, "fixture.psarc", "/app0/arc", files, 64_KB, 0);
+    CheckArchive(app0, "fixture_small_blocks.psarc", "/app0/small", files, 4_KB, 0);
+    CheckArchive(app0, "fixture_big_blocks.psarc", "/app0/big", files, 1_MB, 0);
+    CheckArchive(app0, "fixture_lzma.psarc", "/app0/lzma", files, 64_KB, 0, true);
+
+    // Same again with the blocks of each read spread over the decompressor threads.
+    CHECK(sceFiosArchiveSetDecompressorThreadCount(4) == ORBIS_OK);
+    CHECK(sceFiosArchiveGetDecompressorThreadCount() == 4);
+    CheckArchive(app0, "fixture_mt.psarc", "/app0/mt", files, 4_KB, 0);
+    CheckArchive(app0, "fixture_mt_lzma.psarc", "/app0/mt_lzma", files, 16_KB, 0, true);
+    CHECK(sceFiosArchiveSetDecompressorThreadCount(1) == ORBIS_OK);
+
+    // Case-insensitive archive with absolute paths in the manifest.
+    std::vector<FixtureFile> absolute = {
+        {"/Scripts/Main.lua", MakeData(5000, 5, true)},
+        {"/Scripts/Lib/Util.lua", MakeData(70_KB, 6, true)},
+    };
+    CheckArchive(app0, "fixture_nocase.psarc", "/app0/nocase", absolute, 64_KB, 3);
+
+    // Small reads into one compressed block decompress it once.
+    Fios2ExtBlockCacheStats before{}, after{};
+    fios2ExtGetBlockCacheStats(&before);
+    std::vector<u8> small(100);
+    for (u64 offset = 70_KB; offset < 120_KB; offset += 5_KB) {
+        CHECK(sceFiosFileReadSync(nullptr, "/app0/arc/data/levels/level1.dat", small.data(),
+                                  small.size(), offset) == static_cast<s64>(small.size()));
+        CHECK(std::memcmp(small.data(), files[3].data.data() + offset, small.size()) == 0);
+    }
+    fios2ExtGetBlockCacheStats(&after);
+    CHECK(after.misses - before.misses == 1);
+    CHECK(after.hits - before.hits == 9);
+
+    CheckStream("/app0/arc/data/levels/level1.dat", files[3].data);
+    CheckStream("/app0/lzma/data/levels/level1.dat", files[3].data);
+    CheckStream("/app0/small/data/random.bin", files[2].data);
+    CheckLayers(app0);
+    CheckUnmountDuringRead(app0);
+    CheckVerify(app0);
+    CheckOverrides(app0);
+    CHECK(sceFiosArchiveGetMountBufferSizeSync(nullptr, "/app0/missing.psarc", nullptr) == 0);
+    CHECK(sceFiosExistsSync(nullptr, "/app0/arc/data/levels"));
+    CHECK(!sceFiosExistsSync(nullptr, "/app0/arc/data/lev"));
+
+    std::printf("%s (%d failures)\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures;
+}
@@ -0,0 +1,155 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// PSARC fixture writer shared by the tests and benchmarks, built on the host zlib and liblzma.
+
+#pragma once
+
+#include "md5.h"
+#include "types.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <lzma.h>
+#include <zlib.h>
+
+namespace Fios2::Test {
+
+struct FixtureFile {
+    std::string name;
+    std::vector<u8> data;
+};
+
+inline void PutBE(std::vector<u8>& out, u64 value, u32 bytes) {
+    for (u32 i = bytes; i-- > 0;) {
+        out.push_back(static_cast<u8>(value >> (i * 8)));
+    }
+}
+
+// Deflates one block with the given zlib strategy.
+inline std::vector<u8> DeflateBlock(const u8* data, u64 size, int strategy) {
+    z_stream stream{};
+    deflateInit2(&stream, 9, Z_DEFLATED, 15, 9, strategy);
+    std::vector<u8> out(deflateBound(&stream, size));
+    stream.next_in = const_cast<u8*>(data);
+    stream.avail_in = static_cast<uInt>(size);
+    stream.next_out = out.data();
+    stream.avail_out = static_cast<uInt>(out.size());
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+// One LZMA "alone" stream per block, as written by the real packer, with the preset varied the way
+// the zlib strategy is.
+inline std::vector<u8> LzmaBlock(const u8* data, u64 size, u32 preset) {
+    lzma_options_lzma options;
+    lzma_lzma_preset(&options, preset);
+    lzma_stream stream = LZMA_STREAM_INIT;
+    if (lzma_alone_encoder(&stream, &options) != LZMA_OK) {
+        return {};
+    }
+    std::vector<u8> out(size + size / 2 + 1024);
+    stream.next_in = data;
+    stream.avail_in = size;
+    stream.next_out = out.data();
+    stream.avail_out = out.size();
+    const lzma_ret ret = lzma_code(&stream, LZMA_FINISH);
+    out.resize(ret == LZMA_STREAM_END ? stream.total_out : 0);
+    lzma_end(&stream);
+    return out;
+}
+
+// Returns the raw block if compressing doesn't make it smaller, the way the real packer does.
+inline std::vector<u8> CompressBlock(const u8* data, u64 size, bool lzma, u32 variant) {
+    const int strategies[] = {Z_DEFAULT_STRATEGY, Z_FIXED, Z_HUFFMAN_ONLY, Z_RLE, Z_FILTERED};
+    std::vector<u8> out = lzma ? LzmaBlock(data, size, variant % 2 == 0 ? 1 : 6)
+                               : DeflateBlock(data, size, strategies[variant % 5]);
+    if (out.empty() || out.size() >= size) {
+        out.assign(data, data + size);
+    }
+    return out;
+}
+
+inline void WritePsarc(const std::string& path, const std::vector<FixtureFile>& files,
+                       u32 block_size, u32 flags, bool lzma = false) {
+    std::string manifest;
+    for (const FixtureFile& file : files) {
+        manifest += file.name + "\n";
+    }
+    std::vector<FixtureFile> entries = {{"", std::vector<u8>(manifest.begin(), manifest.end())}};
+    entries.insert(entries.end(), files.begin(), files.end());
+
+    const u32 size_bytes = block_size <= 0x10000 ? 2 : block_size <= 0x1000000 ? 3 : 4;
+    std::vector<u8> blobs;
+    std::vector<u32> block_sizes;
+    std::vector<u8> toc;
+    for (u32 i = 0; i < entries.size(); ++i) {
+        const FixtureFile& entry = entries[i];
+        std::string hashed = entry.name;
+        if (flags & 1) {
+            std::transform(hashed.begin(), hashed.end(), hashed.begin(), ::toupper);
+        }
+        const u128 digest = i == 0 ? u128{} : Md5::Digest(hashed);
+        const u8* digest_bytes = reinterpret_cast<const u8*>(digest.data());
+        toc.insert(toc.end(), digest_bytes, digest_bytes + 16);
+        PutBE(toc, block_sizes.size(), 4);
+        PutBE(toc, entry.data.size(), 5);
+        PutBE(toc, blobs.size(), 5); // relative for now, fixed up below
+        for (u64 offset = 0; offset < entry.data.size(); offset += block_size) {
+            const u64 size = std::min<u64>(block_size, entry.data.size() - offset);
+            std::vector<u8> block = CompressBlock(entry.data.data() + offset, size, lzma,
+                                                  static_cast<u32>(block_sizes.size()));
+            blobs.insert(blobs.end(), block.begin(), block.end());
+            block_sizes.push_back(block.size() == block_size ? 0 : static_cast<u32>(block.size()));
+        }
+    }
+    const u32 toc_length =
+        32 + static_cast<u32>(toc.size() + block_sizes.size() * size_bytes);
+    for (u32 i = 0; i < entries.size(); ++i) {
+        u8* p = &toc[i * 30 + 25];
+        u64 offset = 0;
+        for (u32 b = 0; b < 5; ++b) {
+            offset = offset << 8 | p[b];
+        }
+        offset += toc_length;
+        for (u32 b = 5; b-- > 0;) {
+            p[b] = static_cast<u8>(offset);
+            offset >>= 8;
+        }
+    }
+
+    std::vector<u8> out = {'P', 'S', 'A', 'R', 0, 1, 0, 4};
+    const char* compression = lzma ? "lzma" : "zlib";
+    out.insert(out.end(), compression, compression + 4);
+    PutBE(out, toc_length, 4);
+    PutBE(out, 30, 4);
+    PutBE(out, entries.size(), 4);
+    PutBE(out, block_size, 4);
+    PutBE(out, flags, 4);
+    out.insert(out.end(), toc.begin(), toc.end());
+    for (u32 size : block_sizes) {
+        PutBE(out, size, size_bytes);
+    }
+    out.insert(out.end(), blobs.begin(), blobs.end());
+    FILE* f = std::fopen(path.c_str(), "wb");
+    std::fwrite(out.data(), 1, out.size(), f);
+    std::fclose(f);
+}
+
+inline std::vector<u8> MakeData(u64 size, u32 seed, bool compressible) {
+    std::vector<u8> data(size);
+    u32 state = seed * 2654435761u + 1;
+    for (u64 i = 0; i < size; ++i) {
+        state = state * 1103515245u + 12345u;
+        data[i] = compressible ? static_cast<u8>("fios2 psarc "[(i / 7 + (state >> 29)) % 12])
+                               : static_cast<u8>(state >> 24);
+    }
+    return data;
+}
+
+} // namespace Fios2::Test
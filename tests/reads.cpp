@@ -0,0 +1,283 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Reads of loose files: what the read cache reports as resident around prefetches and flushes, the
+// prefetch counters behind fios2ExtGetCacheStats, and vectored reads split between the cache, the
+// mapping and the kernel.
+//
+// Usage: reads
+// Built by `make host` as build/host/tests/reads and run by `make check`; test files are written to
+// $FIOS2_APP0 (default /tmp).
+// Exits with the number of failed checks.
+
+#include "config.h"
+#include "fios2.h"
+#include "fios2_error.h"
+#include "psarc_writer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <orbis/libkernel.h>
+
+using namespace Fios2;
+using namespace Fios2::Test;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                                                \
+    do {                                                                                           \
+        if (!(cond)) {                                                                             \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);          \
+            ++failures;                                                                            \
+        }                                                                                          \
+    } while (0)
+
+static void WriteFile(const std::string& path, const std::vector<u8>& data) {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    std::fwrite(data.data(), 1, data.size(), f);
+    std::fclose(f);
+}
+
+// Prefetching a range makes exactly the blocks it touches resident, flushing part of it drops only
+// the blocks that part touches, and the counters tell prefetched blocks a read used from ones that
+// were flushed unread.
+static void CheckResidency(const std::string& app0) {
+    const std::vector<u8> data = MakeData(300_KB + 5, 31, false);
+    WriteFile(app0 + "/resident.bin", data);
+    const char* path = "/app0/resident.bin";
+    const s64 size = data.size();
+
+    CHECK(!sceFiosCacheContainsFileRangeSync(nullptr, path, 0, 1));
+    CHECK(!sceFiosCacheContainsFileSync(nullptr, path));
+    Fios2ExtCacheStats before{}, after{};
+    fios2ExtGetCacheStats(&before);
+
+    CHECK(sceFiosCachePrefetchFileRangeSync(nullptr, path, 0, 128_KB) == ORBIS_OK);
+    CHECK(sceFiosCacheContainsFileRangeSync(nullptr, path, 0, 128_KB));
+    CHECK(sceFiosCacheContainsFileRangeSync(nullptr, path, 100_KB, 0));
+    CHECK(!sceFiosCacheContainsFileRangeSync(nullptr, path, 0, 128_KB + 1));
+    CHECK(!sceFiosCacheContainsFileSync(nullptr, path));
+    CHECK(!sceFiosCacheContainsFileRangeSync(nullptr, path, -1, 10));
+    CHECK(!sceFiosCacheContainsFileRangeSync(nullptr, path, 0, -1));
+
+    // One byte of the second block flushes all of it, and nothing of the first.
+    CHECK(sceFiosCacheFlushFileRangeSync(nullptr, path, 64_KB, 1) == ORBIS_OK);
+    CHECK(sceFiosCacheContainsFileRangeSync(nullptr, path, 0, 64_KB));
+    CHECK(!sceFiosCacheContainsFileRangeSync(nullptr, path, 60_KB, 8_KB));
+    CHECK(!sceFiosCacheContainsFileRangeSync(nullptr, path, 127_KB, 1_KB));
+    CHECK(sceFiosCacheFlushFileRangeSync(nullptr, path, -1, 1) == ORBIS_FIOS_ERROR_BAD_OFFSET);
+    CHECK(sceFiosCacheFlushFileRangeSync(nullptr, path, 0, -1) == ORBIS_FIOS_ERROR_BAD_SIZE);
+
+    std::vector<u8> buf(100);
+    CHECK(sceFiosFileReadSync(nullptr, path, buf.data(), buf.size(), 10) == 100);
+    CHECK(std::memcmp(buf.data(), data.data() + 10, buf.size()) == 0);
+    fios2ExtGetCacheStats(&after);
+    CHECK(after.prefetchedBytes - before.prefetchedBytes == 128_KB);
+    CHECK(after.prefetchUsedBytes - before.prefetchUsedBytes == 64_KB);
+    CHECK(after.prefetchEvictedBytes - before.prefetchEvictedBytes == 64_KB);
+    CHECK(after.hitBytes - before.hitBytes == 100);
+
+    // The rest of the file comes in around the block that is still resident.
+    CHECK(sceFiosCachePrefetchFileSync(nullptr, path) == ORBIS_OK);
+    CHECK(sceFiosCacheContainsFileSync(nullptr, path));
+    CHECK(sceFiosCacheContainsFileRangeSync(nullptr, path, size - 1, 100));
+    CHECK(!sceFiosCacheContainsFileRangeSync(nullptr, path, size, 1));
+    CHECK(!sceFiosCacheContainsFileRangeSync(nullptr, path, size + 100, 0));
+    fios2ExtGetCacheStats(&after);
+    CHECK(after.prefetchedBytes - before.prefetchedBytes == 128_KB + size - 64_KB);
+
+    // Dropping the whole file counts every block no read touched, not the one the read used.
+    CHECK(sceFiosCacheFlushFileSync(nullptr, path) == ORBIS_OK);
+    CHECK(!sceFiosCacheContainsFileSync(nullptr, path));
+    CHECK(!sceFiosCacheContainsFileRangeSync(nullptr, path, 0, 1));
+    fios2ExtGetCacheStats(&after);
+    CHECK(after.prefetchEvictedBytes - before.prefetchEvictedBytes == static_cast<u64>(size));
+    CHECK(after.prefetchUsedBytes - before.prefetchUsedBytes == 64_KB);
+
+    CHECK(sceFiosCachePrefetchFileRangeSync(nullptr, path, 0, 64_KB) == ORBIS_OK);
+    CHECK(sceFiosCacheFlushSync(nullptr) == ORBIS_OK);
+    CHECK(!sceFiosCacheContainsFileRangeSync(nullptr, path, 0, 1));
+
+    // An empty file has nothing to be resident.
+    WriteFile(app0 + "/empty.bin", {});
+    CHECK(sceFiosCachePrefetchFileSync(nullptr, "/app0/empty.bin") == ORBIS_OK);
+    CHECK(!sceFiosCacheContainsFileSync(nullptr, "/app0/empty.bin"));
+    CHECK(!sceFiosCacheContainsFileRangeSync(nullptr, "/app0/empty.bin", 0, 0));
+}
+
+// Each segment of a vectored read lands at its own place in the file, whether it comes from the
+// cache, the mapping or the kernel, and however many kernel calls the list takes.
+static void CheckReadv(const std::string& app0, bool mapped) {
+    const std::vector<u8> data = MakeData(200_KB + 3, mapped ? 33 : 32, false);
+    const std::string name = mapped ? "readv_mapped.bin" : "readv.bin";
+    WriteFile(app0 + "/" + name, data);
+    const std::string path = "/app0/" + name;
+    const s64 size = data.size();
+    Config::Get().mmap = mapped;
+    Config::Get().mmap_threshold = 1;
+    OrbisFiosFH fh = -1;
+    CHECK(sceFiosFHOpenSync(nullptr, &fh, path.c_str(), nullptr) == ORBIS_OK);
+    Config::Get().mmap = false;
+    Config::Get().mmap_threshold = 64_MB;
+
+    std::vector<u8> a(1000), b(70_KB), c(10_KB);
+    OrbisFiosBuffer iov[] = {{a.data(), a.size()}, {nullptr, 0}, {b.data(), b.size()}};
+    CHECK(sceFiosFHPreadvSync(nullptr, fh, iov, 3, 5000) == 1000 + 70_KB);
+    CHECK(std::memcmp(a.data(), data.data() + 5000, a.size()) == 0);
+    CHECK(std::memcmp(b.data(), data.data() + 6000, b.size()) == 0);
+
+    // The first segment is served from the resident first block, the kernel picks up the second
+    // right where it ends.
+    CHECK(sceFiosCachePrefetchFileRangeSync(nullptr, path.c_str(), 0, 64_KB) == ORBIS_OK);
+    OrbisFiosBuffer split[] = {{c.data(), c.size()}, {b.data(), b.size()}};
+    CHECK(sceFiosFHPreadvSync(nullptr, fh, split, 2, 30_KB) == 80_KB);
+    CHECK(std::memcmp(c.data(), data.data() + 30_KB, c.size()) == 0);
+    CHECK(std::memcmp(b.data(), data.data() + 40_KB, b.size()) == 0);
+    CHECK(sceFiosCacheFlushSync(nullptr) == ORBIS_OK);
+
+    // More segments than go to the kernel in one call.
+    std::vector<u8> many(1500 * 100);
+    std::vector<OrbisFiosBuffer> many_iov;
+    for (u64 i = 0; i < 1500; ++i) {
+        many_iov.push_back({many.data() + i * 100, 100});
+    }
+    CHECK(sceFiosFHPreadvSync(nullptr, fh, many_iov.data(), 1500, 1234) == 150000);
+    CHECK(std::memcmp(many.data(), data.data() + 1234, many.size()) == 0);
+
+    // Short at the end of the file.
+    OrbisFiosBuffer tail[] = {{a.data(), 60}, {c.data(), 60}, {b.data(), 60}};
+    CHECK(sceFiosFHPreadvSync(nullptr, fh, tail, 3, size - 100) == 100);
+    CHECK(std::memcmp(a.data(), data.data() + size - 100, 60) == 0);
+    CHECK(std::memcmp(c.data(), data.data() + size - 40, 40) == 0);
+    CHECK(sceFiosFHPreadvSync(nullptr, fh, tail, 3, size) == 0);
+
+    // sceFiosFHReadv reads from and advances the handle's position.
+    CHECK(sceFiosFHSeek(fh, 7, SceFiosWhence::Set) == 7);
+    OrbisFiosBuffer pair[] = {{a.data(), 10}, {c.data(), 20}};
+    CHECK(sceFiosFHReadvSync(nullptr, fh, pair, 2) == 30);
+    CHECK(std::memcmp(a.data(), data.data() + 7, 10) == 0);
+    CHECK(std::memcmp(c.data(), data.data() + 17, 20) == 0);
+    CHECK(sceFiosFHTell(fh) == 37);
+    CHECK(sceFiosFHReadvSync(nullptr, fh, pair, 2) == 30);
+    CHECK(std::memcmp(a.data(), data.data() + 37, 10) == 0);
+    CHECK(sceFiosFHTell(fh) == 67);
+
+    CHECK(sceFiosFHPreadvSync(nullptr, fh, pair, -1, 0) == ORBIS_FIOS_ERROR_BAD_IOVCNT);
+    CHECK(sceFiosFHPreadvSync(nullptr, fh, pair, 2, -1) == ORBIS_FIOS_ERROR_BAD_OFFSET);
+    CHECK(sceFiosFHPreadSync(nullptr, fh, a.data(), -1, 0) == ORBIS_FIOS_ERROR_BAD_SIZE);
+    if (mapped) {
+        const void* mapping = nullptr;
+        CHECK(fios2ExtFHGetMapping(fh, 0, -1, &mapping) == ORBIS_FIOS_ERROR_BAD_SIZE);
+        CHECK(fios2ExtFHGetMapping(fh, 100, 10, &mapping) == 10);
+        CHECK(mapping && std::memcmp(mapping, data.data() + 100, 10) == 0);
+        CHECK(sceFiosFHPreadSync(nullptr, fh, a.data(), 10, -1) == ORBIS_FIOS_ERROR_BAD_OFFSET);
+    }
+    CHECK(sceFiosFileReadSync(nullptr, path.c_str(), a.data(), -1, 0) ==
+          ORBIS_FIOS_ERROR_BAD_SIZE);
+    CHECK(sceFiosOpSyncWaitForIO(sceFiosFileRead(nullptr, path.c_str(), a.data(), -1, 0)) ==
+          ORBIS_FIOS_ERROR_BAD_SIZE);
+    CHECK(sceFiosFHCloseSync(nullptr, fh) == ORBIS_OK);
+}
+
+// Closing a handle while a chunked read on it is still running waits for the read, so none of its
+// chunks read a closed descriptor or one the next open has reused.
+static void CheckCloseDuringChunkedRead(const std::string& app0) {
+    const std::vector<u8> data = MakeData(8_MB + 11, 34, false), other = MakeData(1_MB, 35, false);
+    WriteFile(app0 + "/chunked.bin", data);
+    WriteFile(app0 + "/chunked_other.bin", other);
+    Config::Get().chunked_read_threshold = 1_MB;
+    Config::Get().chunk_size = 256_KB;
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        OrbisFiosFH fh = -1, other_fh = -1;
+        CHECK(sceFiosFHOpenSync(nullptr, &fh, "/app0/chunked.bin", nullptr) == ORBIS_OK);
+        std::vector<u8> buf(data.size());
+        const OrbisFiosOp op = sceFiosFHPread(nullptr, fh, buf.data(), buf.size(), 0);
+        CHECK(sceFiosFHCloseSync(nullptr, fh) == ORBIS_OK);
+        CHECK(sceFiosFHOpenSync(nullptr, &other_fh, "/app0/chunked_other.bin", nullptr) ==
+              ORBIS_OK);
+        CHECK(sceFiosOpSyncWaitForIO(op) == static_cast<s64>(data.size()));
+        CHECK(buf == data);
+        CHECK(sceFiosFHCloseSync(nullptr, other_fh) == ORBIS_OK);
+    }
+    Config::Get().chunked_read_threshold = 4_MB;
+    Config::Get().chunk_size = 1_MB;
+}
+
+// Threads sharing one handle each read a different part of the file, half of them with
+// sceFiosFHReadv: every position is read once, however the reads interleave while the library
+// waits on the kernel.
+static void CheckSharedHandle(const std::string& app0) {
+    constexpr u64 READ_SIZE = 4_KB, READS = 1024;
+    std::vector<u8> data(READ_SIZE * READS);
+    for (u64 i = 0; i < data.size() / sizeof(u32); ++i) {
+        const u32 word = static_cast<u32>(i * sizeof(u32));
+        std::memcpy(data.data() + i * sizeof(u32), &word, sizeof(word));
+    }
+    WriteFile(app0 + "/shared.bin", data);
+    OrbisFiosFH fh = -1;
+    CHECK(sceFiosFHOpenSync(nullptr, &fh, "/app0/shared.bin", nullptr) == ORBIS_OK);
+    std::vector<std::vector<u32>> offsets(4);
+    std::vector<std::thread> threads;
+    for (std::vector<u32>& thread_offsets : offsets) {
+        const bool vectored = &thread_offsets - offsets.data() >= 2;
+        threads.emplace_back([fh, vectored, &thread_offsets] {
+            std::vector<u8> buf(READ_SIZE);
+            OrbisFiosBuffer halves[] = {{buf.data(), READ_SIZE / 2},
+                                        {buf.data() + READ_SIZE / 2, READ_SIZE / 2}};
+            while ((vectored ? sceFiosFHReadvSync(nullptr, fh, halves, 2)
+                             : sceFiosFHReadSync(nullptr, fh, buf.data(), buf.size())) ==
+                   READ_SIZE) {
+                u32 offset;
+                std::memcpy(&offset, buf.data(), sizeof(offset));
+                thread_offsets.push_back(offset);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    std::vector<u32> all;
+    for (const std::vector<u32>& thread_offsets : offsets) {
+        all.insert(all.end(), thread_offsets.begin(), thread_offsets.end());
+    }
+    std::sort(all.begin(), all.end());
+    CHECK(all.size() == READS);
+    for (u64 i = 0; i < all.size(); ++i) {
+        CHECK(all[i] == i * READ_SIZE);
+    }
+    CHECK(sceFiosFHTell(fh) == static_cast<s64>(data.size()));
+    CHECK(sceFiosFHCloseSync(nullptr, fh) == ORBIS_OK);
+}
+
+// Config lines may carry comments and stray whitespace, and a blob store too large for its entries
+// to address is clamped.
+static void CheckConfig(const std::string& app0) {
+    const std::string text = "# comment\n  chunk_size = 512K # trailing\r\n\nblob_store_size=4G\n";
+    WriteFile(app0 + "/reads_test.ini", std::vector<u8>(text.begin(), text.end()));
+    const Config::Options saved = Config::Get();
+    Config::Load("/app0/reads_test.ini");
+    CHECK(Config::Get().chunk_size == 512_KB);
+    CHECK(Config::Get().blob_store_size == Config::MAX_BLOB_STORE_SIZE);
+    Config::Get() = saved;
+}
+
+int main() {
+    const char* env = std::getenv("FIOS2_APP0");
+    const std::string app0 = env ? env : "/tmp";
+
+    CheckConfig(app0);
+    CheckResidency(app0);
+    CheckReadv(app0, false);
+    CheckReadv(app0, true);
+    CheckCloseDuringChunkedRead(app0);
+    CheckSharedHandle(app0);
+
+    std::printf("%s (%d failures)\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures;
+}
@@ -0,0 +1,445 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Replays the sceFios* calls of a trace recorded with trace_calls (see src/trace.h) against a local
+// copy of the game's files, through the same library built for the host, and reports how long each
+// API took next to how long it took when it was recorded. Each recorded thread is replayed on a
+// thread of its own, at the recorded times divided by the speed factor, or back to back with -s 0.
+// Handles and ops are mapped from the recorded values to the replayed ones, across threads.
+//
+// Usage: fios_replay [-s speed, default 1] [-c] <trace> [app0 directory, default $FIOS2_APP0]
+//   -c  print the table as CSV
+// Host tool, built by make tools.
+
+#include "fios2.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace Fios2;
+using Trace::Api;
+using Clock = std::chrono::steady_clock;
+
+// How long a thread waits for another one to produce the handle or op it needs, before giving up
+// and passing the recorded value through.
+constexpr auto MAP_TIMEOUT = std::chrono::seconds(1);
+
+// Recorded handle or op -> replayed one, shared by every replay thread.
+class ValueMap {
+public:
+    void Set(s64 recorded, s32 replayed) {
+        {
+            std::scoped_lock l{mutex};
+            values[recorded] = replayed;
+        }
+        cv.notify_all();
+    }
+
+    s32 Get(s64 recorded) {
+        std::unique_lock l{mutex};
+        auto it = values.end();
+        cv.wait_for(l, MAP_TIMEOUT, [&] { return (it = values.find(recorded)) != values.end(); });
+        return it != values.end() ? it->second : static_cast<s32>(recorded);
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::unordered_map<s64, s32> values;
+};
+
+struct Replay {
+    std::unordered_map<u32, std::string> paths;
+    std::map<u32, std::vector<Trace::Call>> threads; // by recorded thread number
+    ValueMap handles;
+    ValueMap ops;
+
+    std::mutex buffers_mutex;
+    // Destinations of async reads, kept until the op is waited for or deleted.
+    std::unordered_map<s32, std::unique_ptr<u8[]>> op_buffers;
+    std::vector<std::unique_ptr<u8[]>> mount_buffers;
+};
+
+struct Sample {
+    Api api;
+    u64 ns;
+    bool failed; // replayed call failed where the recorded one didn't
+};
+
+static bool Load(const char* path, Replay& replay) {
+    FILE* f = std::fopen(path, "rb");
+    if (f == nullptr) {
+        std::fprintf(stderr, "can't open %s\n", path);
+        return false;
+    }
+    Trace::FileHeader header{};
+    if (std::fread(&header, sizeof(header), 1, f) != 1 || header.magic != Trace::MAGIC ||
+        header.version != Trace::VERSION) {
+        std::fprintf(stderr, "%s isn't a version %u access trace\n", path, Trace::VERSION);
+        std::fclose(f);
+        return false;
+    }
+    Trace::ChunkHeader chunk;
+    std::vector<u8> payload;
+    while (std::fread(&chunk, sizeof(chunk), 1, f) == 1) {
+        payload.resize(chunk.size);
+        if (std::fread(payload.data(), 1, chunk.size, f) != chunk.size) {
+            std::fprintf(stderr, "warning: trace is truncated\n");
+            break;
+        }
+        if (chunk.size < sizeof(u32)) {
+            continue;
+        }
+        u32 id;
+        std::copy_n(payload.data(), sizeof(id), reinterpret_cast<u8*>(&id));
+        if (chunk.kind == Trace::ChunkKind::Path) {
+            replay.paths[id].assign(payload.begin() + sizeof(id), payload.end());
+        } else if (chunk.kind == Trace::ChunkKind::Calls) {
+            std::vector<Trace::Call>& calls = replay.threads[id];
+            const u64 count = (chunk.size - sizeof(u32)) / sizeof(Trace::Call);
+            const u64 old_size = calls.size();
+            calls.resize(old_size + count);
+            std::copy_n(payload.data() + sizeof(u32), count * sizeof(Trace::Call),
+                        reinterpret_cast<u8*>(calls.data() + old_size));
+        }
+    }
+    std::fclose(f);
+    return true;
+}
+
+static bool IsSync(Api api) {
+    switch (api) {
+    case Api::ArchiveMountSync:
+    case Api::ArchiveUnmountSync:
+    case Api::DHOpenSync:
+    case Api::DHCloseSync:
+    case Api::ExistsSync:
+    case Api::FHOpenSync:
+    case Api::FHCloseSync:
+    case Api::FHGetSize:
+    case Api::FHPreadSync:
+    case Api::FHPreadvSync:
+    case Api::FHReadSync:
+    case Api::FHReadvSync:
+    case Api::FHSeek:
+    case Api::FileExistsSync:
+    case Api::FileGetSizeSync:
+    case Api::FileReadSync:
+    case Api::OpDelete:
+    case Api::OpSyncWait:
+    case Api::OpSyncWaitForIO:
+    case Api::OpWait:
+    case Api::StatSync:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Buffer for a read of length bytes: the thread's scratch buffer for a sync call, its own for an
+// async one, handed over to the op once the call returns.
+static u8* ReadBuffer(const Trace::Call& call, u64 length, std::vector<u8>& scratch,
+                      std::unique_ptr<u8[]>& owned) {
+    if (IsSync(call.api)) {
+        if (scratch.size() < length) {
+            scratch.resize(length);
+        }
+        return scratch.data();
+    }
+    owned = std::make_unique<u8[]>(std::max<u64>(length, 1));
+    return owned.get();
+}
+
+static s64 Issue(Replay& replay, const Trace::Call& call, std::vector<u8>& scratch,
+                 std::unique_ptr<u8[]>& owned) {
+    auto path_of = [&](u64 id) {
+        auto it = replay.paths.find(static_cast<u32>(id));
+        return it != replay.paths.end() ? it->second.c_str() : "";
+    };
+    const char* path = path_of(call.path);
+    const u64* args = call.args;
+    const bool sync = IsSync(call.api);
+    switch (call.api) {
+    case Api::ArchiveMount:
+    case Api::ArchiveMountSync: {
+        const s64 size = sceFiosArchiveGetMountBufferSizeSync(nullptr, path, nullptr);
+        if (size < 0) {
+            return size;
+        }
+        auto buffer = std::make_unique<u8[]>(std::max<s64>(size, 1));
+        const OrbisFiosBuffer mount_buffer{buffer.get(), static_cast<u64>(size)};
+        {
+            std::scoped_lock l{replay.buffers_mutex};
+            replay.mount_buffers.push_back(std::move(buffer));
+        }
+        OrbisFiosFH fh = -1;
+        const char* mount_point = path_of(args[0]);
+        const s32 order = static_cast<s32>(args[3]);
+        const s64 ret = sync ? sceFiosArchiveMountWithOrderSync(nullptr, &fh, path, mount_point,
+                                                                mount_buffer, nullptr, order)
+                             : sceFiosArchiveMountWithOrder(nullptr, &fh, path, mount_point,
+                                                            mount_buffer, nullptr, order);
+        replay.handles.Set(static_cast<s32>(args[2]), fh);
+        return ret;
+    }
+    case Api::ArchiveUnmount:
+        return sceFiosArchiveUnmount(nullptr, replay.handles.Get(args[0]));
+    case Api::ArchiveUnmountSync:
+        return sceFiosArchiveUnmountSync(nullptr, replay.handles.Get(args[0]));
+    case Api::DHOpen:
+    case Api::DHOpenSync: {
+        std::vector<u8>& buffer = scratch;
+        buffer.resize(std::max<u64>(buffer.size(), args[0]));
+        OrbisFiosDH dh = -1;
+        const OrbisFiosBuffer buf{buffer.data(), args[0]};
+        const s64 ret = sync ? sceFiosDHOpenSync(nullptr, &dh, path, buf)
+                             : sceFiosDHOpen(nullptr, &dh, path, buf);
+        replay.handles.Set(static_cast<s32>(args[2]), dh);
+        return ret;
+    }
+    case Api::DHClose:
+        return sceFiosDHClose(nullptr, replay.handles.Get(args[0]));
+    case Api::DHCloseSync:
+        return sceFiosDHCloseSync(nullptr, replay.handles.Get(args[0]));
+    case Api::Exists:
+        return sceFiosExists(nullptr, path, nullptr);
+    case Api::ExistsSync:
+        return sceFiosExistsSync(nullptr, path);
+    case Api::FHOpen:
+    case Api::FHOpenSync: {
+        OrbisFiosOpenParams params{};
+        params.openFlags = static_cast<u32>(args[0]);
+        OrbisFiosFH fh = -1;
+        const s32 mode = static_cast<s32>(args[1]);
+        const s64 ret = sync ? sceFiosFHOpenWithModeSync(nullptr, &fh, path, &params, mode)
+                             : sceFiosFHOpenWithMode(nullptr, &fh, path, &params, mode);
+        replay.handles.Set(static_cast<s32>(args[2]), fh);
+        return ret;
+    }
+    case Api::FHClose:
+        return sceFiosFHClose(nullptr, replay.handles.Get(args[0]));
+    case Api::FHCloseSync:
+        return sceFiosFHCloseSync(nullptr, replay.handles.Get(args[0]));
+    case Api::FHGetSize:
+        return sceFiosFHGetSize(replay.handles.Get(args[0]));
+    case Api::FHPread:
+    case Api::FHPreadSync: {
+        u8* buf = ReadBuffer(call, args[1], scratch, owned);
+        const OrbisFiosFH fh = replay.handles.Get(args[0]);
+        return sync ? sceFiosFHPreadSync(nullptr, fh, buf, args[1], args[2])
+                    : sceFiosFHPread(nullptr, fh, buf, args[1], args[2]);
+    }
+    case Api::FHPreadv:
+    case Api::FHPreadvSync:
+    case Api::FHReadv:
+    case Api::FHReadvSync: {
+        // The recorded buffers' lengths aren't known, only their total: split it evenly.
+        const u64 count = std::max<u64>(args[3], 1);
+        u8* buf = ReadBuffer(call, args[1], scratch, owned);
+        std::vector<OrbisFiosBuffer> iov(count);
+        for (u64 i = 0; i < count; ++i) {
+            const u64 begin = args[1] * i / count;
+            iov[i] = {buf + begin, args[1] * (i + 1) / count - begin};
+        }
+        const OrbisFiosFH fh = replay.handles.Get(args[0]);
+        const int iovcnt = static_cast<int>(count);
+        switch (call.api) {
+        case Api::FHPreadv:
+            return sceFiosFHPreadv(nullptr, fh, iov.data(), iovcnt, args[2]);
+        case Api::FHPreadvSync:
+            return sceFiosFHPreadvSync(nullptr, fh, iov.data(), iovcnt, args[2]);
+        case Api::FHReadv:
+            return sceFiosFHReadv(nullptr, fh, iov.data(), iovcnt);
+        default:
+            return sceFiosFHReadvSync(nullptr, fh, iov.data(), iovcnt);
+        }
+    }
+    case Api::FHRead:
+    case Api::FHReadSync: {
+        u8* buf = ReadBuffer(call, args[1], scratch, owned);
+        const OrbisFiosFH fh = replay.handles.Get(args[0]);
+        return sync ? sceFiosFHReadSync(nullptr, fh, buf, args[1])
+                    : sceFiosFHRead(nullptr, fh, buf, args[1]);
+    }
+    case Api::FHSeek:
+        return sceFiosFHSeek(replay.handles.Get(args[0]), args[1],
+                             static_cast<OrbisFiosWhence>(args[2]));
+    case Api::FileExists:
+        return sceFiosFileExists(nullptr, path);
+    case Api::FileExistsSync:
+        return sceFiosFileExistsSync(nullptr, path);
+    case Api::FileGetSize:
+        return sceFiosFileGetSize(nullptr, path);
+    case Api::FileGetSizeSync:
+        return sceFiosFileGetSizeSync(nullptr, path);
+    case Api::FileRead:
+    case Api::FileReadSync: {
+        u8* buf = ReadBuffer(call, args[0], scratch, owned);
+        return sync ? sceFiosFileReadSync(nullptr, path, buf, args[0], args[1])
+                    : sceFiosFileRead(nullptr, path, buf, args[0], args[1]);
+    }
+    case Api::OpDelete:
+        return sceFiosOpDelete(replay.ops.Get(args[0]));
+    case Api::OpSyncWait:
+        return sceFiosOpSyncWait(replay.ops.Get(args[0]));
+    case Api::OpSyncWaitForIO:
+        return sceFiosOpSyncWaitForIO(replay.ops.Get(args[0]));
+    case Api::OpWait:
+        return sceFiosOpWait(replay.ops.Get(args[0]));
+    case Api::Stat:
+    case Api::StatSync: {
+        OrbisFiosStat stat{};
+        // An async stat writes its result before returning, so a local will do.
+        return sync ? sceFiosStatSync(nullptr, path, &stat) : sceFiosStat(nullptr, path, &stat);
+    }
+    default:
+        return 0;
+    }
+}
+
+static void ReplayThread(Replay& replay, const std::vector<Trace::Call>& calls,
+                         Clock::time_point start, double speed, std::vector<Sample>& samples) {
+    std::vector<u8> scratch;
+    samples.reserve(calls.size());
+    std::this_thread::sleep_until(start);
+    for (const Trace::Call& call : calls) {
+        if (speed > 0) {
+            std::this_thread::sleep_until(
+                start + std::chrono::nanoseconds(static_cast<u64>(call.time / speed)));
+        }
+        std::unique_ptr<u8[]> owned;
+        const auto begin = Clock::now();
+        const s64 ret = Issue(replay, call, scratch, owned);
+        const u64 ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin)
+                           .count();
+
+        const bool sync = IsSync(call.api);
+        if (!sync) {
+            replay.ops.Set(call.result, static_cast<s32>(ret));
+        }
+        std::scoped_lock l{replay.buffers_mutex};
+        if (owned) {
+            replay.op_buffers[static_cast<s32>(ret)] = std::move(owned);
+        }
+        if (call.api == Api::OpDelete || call.api == Api::OpWait || call.api == Api::OpSyncWait ||
+            call.api == Api::OpSyncWaitForIO) {
+            replay.op_buffers.erase(replay.ops.Get(call.args[0]));
+        }
+        // Async calls return ops, which say nothing about success.
+        samples.push_back({call.api, ns, sync && ret < 0 && call.result >= 0});
+    }
+}
+
+static double Percentile(std::vector<u64>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[std::min<size_t>(sorted.size() - 1, static_cast<size_t>(sorted.size() * p))] /
+           1e3;
+}
+
+int main(int argc, char** argv) {
+    double speed = 1;
+    bool csv = false;
+    std::vector<const char*> positional;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-s" && i + 1 < argc) {
+            speed = std::strtod(argv[++i], nullptr);
+        } else if (arg == "-c") {
+            csv = true;
+        } else {
+            positional.push_back(argv[i]);
+        }
+    }
+    if (positional.empty() || positional.size() > 2 || speed < 0) {
+        std::fprintf(stderr, "usage: %s [-s speed] [-c] <trace> [app0 directory]\n", argv[0]);
+        return 2;
+    }
+    if (positional.size() == 2) {
+        setenv("FIOS2_APP0", positional[1], 1);
+    }
+    Replay replay;
+    if (!Load(positional[0], replay)) {
+        return 1;
+    }
+
+    std::vector<std::vector<Sample>> samples(replay.threads.size());
+    std::vector<std::thread> threads;
+    const auto start = Clock::now() + std::chrono::milliseconds(10);
+    u64 recorded_end = 0;
+    u32 t = 0;
+    for (auto& [thread, calls] : replay.threads) {
+        if (!calls.empty()) {
+            recorded_end = std::max(recorded_end, calls.back().time + calls.back().duration);
+        }
+        threads.emplace_back(ReplayThread, std::ref(replay), std::cref(calls), start, speed,
+                             std::ref(samples[t++]));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const double wall = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Recorded and replayed durations per API, in Api order.
+    const u32 num_apis = static_cast<u32>(Api::Count);
+    std::vector<std::vector<u64>> recorded(num_apis), replayed(num_apis);
+    std::vector<u64> failed(num_apis);
+    u64 total = 0;
+    for (const auto& [thread, calls] : replay.threads) {
+        for (const Trace::Call& call : calls) {
+            if (call.api < Api::Count) {
+                recorded[static_cast<u32>(call.api)].push_back(call.duration);
+            }
+        }
+    }
+    for (const std::vector<Sample>& thread_samples : samples) {
+        for (const Sample& sample : thread_samples) {
+            if (sample.api < Api::Count) {
+                replayed[static_cast<u32>(sample.api)].push_back(sample.ns);
+                failed[static_cast<u32>(sample.api)] += sample.failed;
+                ++total;
+            }
+        }
+    }
+
+    std::printf(csv ? "api,calls,failed,recorded_p50_us,recorded_p99_us,mean_us,p50_us,p90_us,"
+                      "p99_us,max_us\n"
+                    : "%-18s %8s %6s %10s %10s %10s %10s %10s %10s %10s\n",
+                "api", "calls", "failed", "rec p50", "rec p99", "mean", "p50", "p90", "p99",
+                "max");
+    for (u32 i = 0; i < num_apis; ++i) {
+        std::vector<u64>& times = replayed[i];
+        if (times.empty()) {
+            continue;
+        }
+        std::sort(times.begin(), times.end());
+        std::sort(recorded[i].begin(), recorded[i].end());
+        u64 sum = 0;
+        for (u64 ns : times) {
+            sum += ns;
+        }
+        std::printf(csv ? "%s,%zu,%llu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n"
+                        : "%-18s %8zu %6llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                    Trace::ApiName(static_cast<Api>(i)), times.size(),
+                    static_cast<unsigned long long>(failed[i]), Percentile(recorded[i], 0.5),
+                    Percentile(recorded[i], 0.99), sum / 1e3 / times.size(),
+                    Percentile(times, 0.5), Percentile(times, 0.9), Percentile(times, 0.99),
+                    times.back() / 1e3);
+    }
+    std::fprintf(stderr, "%llu calls on %zu threads in %.3f s, recorded in %.3f s (times in us)\n",
+                 static_cast<unsigned long long>(total), threads.size(), wall,
+                 recorded_end / 1e9);
+    return 0;
+}
@@ -0,0 +1,406 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Packs an unpacked tree into a PSARC with its entries laid out in the order the game reads them,
+// so loading turns into one sequential sweep of the archive instead of seeks all over it. The order
+// comes from a manifest, usually made by trace_manifest from an access trace: the files it lists
+// come first, in its order, the rest of the tree after them sorted by path.
+//
+// Usage: psarc_pack [options] <tree> <out.psarc>
+//   -m <manifest>  file order, one path relative to the tree per line
+//   -b <bytes>     block size, default 65536
+//   -l <0-9>       compression level, 0 stores every block raw, default 9
+//   -c zlib|lzma   codec, default zlib
+//   -j <threads>   compression threads, default one per core
+//   -i             case-insensitive names (PSARC flag 1)
+//   -a             absolute names (PSARC flag 2)
+// Host tool, built by make tools.
+
+#include "md5.h"
+#include "types.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <lzma.h>
+#include <zlib.h>
+
+using namespace Fios2;
+
+constexpr u32 HEADER_SIZE = 32;
+constexpr u32 TOC_ENTRY_SIZE = 30;
+constexpr u32 BLOCKS_PER_THREAD = 32; // per batch, read and compressed together
+
+struct Options {
+    std::string tree;
+    std::string out;
+    std::string manifest;
+    u32 block_size = 64_KB;
+    u32 level = 9;
+    bool lzma = false;
+    u32 threads = 0;
+    u32 flags = 0;
+};
+
+struct Entry {
+    std::string name;   // relative to the tree, '/' separated
+    std::string source; // file to read, empty for the manifest itself
+    u64 size = 0;
+    u64 offset = 0;
+    u32 first_block = 0;
+};
+
+struct Block {
+    u32 entry;
+    u64 offset; // into the entry
+    u32 size;   // uncompressed
+    std::vector<u8> data;
+};
+
+static void PutBE(std::vector<u8>& out, u64 value, u32 bytes) {
+    for (u32 i = bytes; i-- > 0;) {
+        out.push_back(static_cast<u8>(value >> (i * 8)));
+    }
+}
+
+static std::vector<u8> Deflate(const u8* data, u64 size, u32 level) {
+    z_stream stream{};
+    deflateInit2(&stream, static_cast<int>(level), Z_DEFLATED, 15, 9, Z_DEFAULT_STRATEGY);
+    std::vector<u8> out(deflateBound(&stream, size));
+    stream.next_in = const_cast<u8*>(data);
+    stream.avail_in = static_cast<uInt>(size);
+    stream.next_out = out.data();
+    stream.avail_out = static_cast<uInt>(out.size());
+    const int ret = deflate(&stream, Z_FINISH);
+    out.resize(ret == Z_STREAM_END ? stream.total_out : 0);
+    deflateEnd(&stream);
+    return out;
+}
+
+// One LZMA "alone" stream per block, which is what the official packer writes and the library's
+// decoder expects.
+static std::vector<u8> Lzma(const u8* data, u64 size, u32 level) {
+    lzma_options_lzma options;
+    lzma_lzma_preset(&options, level);
+    lzma_stream stream = LZMA_STREAM_INIT;
+    if (lzma_alone_encoder(&stream, &options) != LZMA_OK) {
+        return {};
+    }
+    std::vector<u8> out(size + size / 2 + 1024);
+    stream.next_in = data;
+    stream.avail_in = size;
+    stream.next_out = out.data();
+    stream.avail_out = out.size();
+    const lzma_ret ret = lzma_code(&stream, LZMA_FINISH);
+    out.resize(ret == LZMA_STREAM_END ? stream.total_out : 0);
+    lzma_end(&stream);
+    return out;
+}
+
+// Replaces the block's data with its compressed form, unless that isn't smaller. A block stored at
+// its own size is raw to the reader.
+static void CompressBlock(Block& block, const Options& options) {
+    if (options.level == 0) {
+        return;
+    }
+    std::vector<u8> out = options.lzma ? Lzma(block.data.data(), block.size, options.level)
+                                       : Deflate(block.data.data(), block.size, options.level);
+    if (!out.empty() && out.size() < block.size) {
+        block.data = std::move(out);
+    }
+}
+
+static std::string Normalize(std::string line) {
+    while (!line.empty() && (line.back() == '\r' || line.back() == '/')) {
+        line.pop_back();
+    }
+    if (line.compare(0, 2, "./") == 0) {
+        line.erase(0, 2);
+    }
+    while (!line.empty() && line.front() == '/') {
+        line.erase(0, 1);
+    }
+    return line;
+}
+
+// Every regular file under the tree, manifest order first.
+static bool CollectEntries(const Options& options, std::vector<Entry>* pEntries) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> names;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(options.tree, ec);
+         !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (it->is_regular_file()) {
+            names.push_back(it->path().lexically_relative(options.tree).generic_string());
+        }
+    }
+    if (ec) {
+        std::fprintf(stderr, "can't walk %s: %s\n", options.tree.c_str(), ec.message().c_str());
+        return false;
+    }
+    std::sort(names.begin(), names.end());
+    const std::unordered_set<std::string> present(names.begin(), names.end());
+
+    std::vector<std::string> order;
+    std::unordered_set<std::string> listed;
+    if (!options.manifest.empty()) {
+        FILE* f = std::fopen(options.manifest.c_str(), "r");
+        if (f == nullptr) {
+            std::fprintf(stderr, "can't open %s\n", options.manifest.c_str());
+            return false;
+        }
+        char line[4096];
+        u32 missing = 0;
+        while (std::fgets(line, sizeof(line), f) != nullptr) {
+            std::string name = line;
+            if (!name.empty() && name.back() == '\n') {
+                name.pop_back();
+            }
+            name = Normalize(std::move(name));
+            if (name.empty() || listed.count(name) != 0) {
+                continue;
+            }
+            if (present.count(name) == 0) {
+                ++missing;
+                continue;
+            }
+            listed.insert(name);
+            order.push_back(std::move(name));
+        }
+        std::fclose(f);
+        if (missing != 0) {
+            std::fprintf(stderr, "warning: %u manifest paths aren't in the tree\n", missing);
+        }
+    }
+    const u64 num_listed = order.size();
+    for (std::string& name : names) {
+        if (listed.count(name) == 0) {
+            order.push_back(std::move(name));
+        }
+    }
+    std::fprintf(stderr, "%llu files, %llu in manifest order\n",
+                 static_cast<unsigned long long>(order.size()),
+                 static_cast<unsigned long long>(num_listed));
+
+    // Entry 0 is the archive's own manifest, the names in entry order.
+    pEntries->assign(1, Entry{});
+    for (std::string& name : order) {
+        Entry entry;
+        entry.source = options.tree + "/" + name;
+        entry.size = fs::file_size(entry.source, ec);
+        if (ec) {
+            std::fprintf(stderr, "can't stat %s\n", entry.source.c_str());
+            return false;
+        }
+        entry.name = options.flags & 2 ? "/" + name : std::move(name);
+        pEntries->push_back(std::move(entry));
+    }
+    return true;
+}
+
+static bool ParseOptions(int argc, char** argv, Options* pOptions) {
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "-m" && has_value) {
+            pOptions->manifest = argv[++i];
+        } else if (arg == "-b" && has_value) {
+            pOptions->block_size = static_cast<u32>(std::strtoul(argv[++i], nullptr, 0));
+        } else if (arg == "-l" && has_value) {
+            pOptions->level = static_cast<u32>(std::strtoul(argv[++i], nullptr, 0));
+        } else if (arg == "-c" && has_value) {
+            const std::string codec = argv[++i];
+            if (codec != "zlib" && codec != "lzma") {
+                return false;
+            }
+            pOptions->lzma = codec == "lzma";
+        } else if (arg == "-j" && has_value) {
+            pOptions->threads = static_cast<u32>(std::strtoul(argv[++i], nullptr, 0));
+        } else if (arg == "-i") {
+            pOptions->flags |= 1;
+        } else if (arg == "-a") {
+            pOptions->flags |= 2;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            return false;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() != 2 || pOptions->block_size == 0 || pOptions->level > 9) {
+        return false;
+    }
+    pOptions->tree = positional[0];
+    pOptions->out = positional[1];
+    if (pOptions->threads == 0) {
+        pOptions->threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, &options)) {
+        std::fprintf(stderr,
+                     "usage: %s [-m manifest] [-b block_size] [-l level] [-c zlib|lzma] "
+                     "[-j threads] [-i] [-a] <tree> <out.psarc>\n",
+                     argv[0]);
+        return 2;
+    }
+    std::vector<Entry> entries;
+    if (!CollectEntries(options, &entries)) {
+        return 1;
+    }
+    std::string manifest;
+    for (u32 i = 1; i < entries.size(); ++i) {
+        manifest += entries[i].name + "\n";
+    }
+    entries[0].size = manifest.size();
+
+    // Block sizes are the only part of the TOC that depends on compression, and their count is
+    // known up front, so the blocks go straight to their final offsets and the TOC is written last.
+    const u32 block_size = options.block_size;
+    const u32 size_bytes = block_size <= 0x10000 ? 2 : block_size <= 0x1000000 ? 3 : 4;
+    u64 num_blocks = 0;
+    for (Entry& entry : entries) {
+        entry.first_block = static_cast<u32>(num_blocks);
+        num_blocks += (entry.size + block_size - 1) / block_size;
+    }
+    const u64 toc_length =
+        HEADER_SIZE + entries.size() * TOC_ENTRY_SIZE + num_blocks * size_bytes;
+    if (num_blocks > UINT32_MAX || toc_length > UINT32_MAX) {
+        std::fprintf(stderr, "too many blocks, use a larger block size\n");
+        return 1;
+    }
+
+    FILE* out = std::fopen(options.out.c_str(), "wb");
+    if (out == nullptr) {
+        std::fprintf(stderr, "can't create %s\n", options.out.c_str());
+        return 1;
+    }
+    std::vector<u8> zeros(toc_length);
+    std::fwrite(zeros.data(), 1, zeros.size(), out);
+
+    // Batches of blocks are read in order on this thread, compressed on all of them, then written
+    // in order. The first block of an entry fixes its offset.
+    std::vector<u32> block_sizes;
+    block_sizes.reserve(num_blocks);
+    u64 out_offset = toc_length;
+    u64 raw_bytes = 0;
+    u32 entry_index = 0;
+    u64 entry_offset = 0;
+    FILE* in = nullptr;
+    const u64 batch_blocks = static_cast<u64>(options.threads) * BLOCKS_PER_THREAD;
+    std::vector<Block> batch;
+    while (block_sizes.size() < num_blocks) {
+        batch.clear();
+        while (batch.size() < batch_blocks && entry_index < entries.size()) {
+            const Entry& entry = entries[entry_index];
+            if (entry_offset == entry.size) {
+                if (in != nullptr) {
+                    std::fclose(in);
+                    in = nullptr;
+                }
+                ++entry_index;
+                entry_offset = 0;
+                continue;
+            }
+            Block block{entry_index, entry_offset,
+                        static_cast<u32>(std::min<u64>(block_size, entry.size - entry_offset)), {}};
+            block.data.resize(block.size);
+            if (entry_index == 0) {
+                std::copy_n(manifest.data() + entry_offset, block.size, block.data.data());
+            } else {
+                if (in == nullptr && (in = std::fopen(entry.source.c_str(), "rb")) == nullptr) {
+                    std::fprintf(stderr, "can't open %s\n", entry.source.c_str());
+                    return 1;
+                }
+                if (std::fread(block.data.data(), 1, block.size, in) != block.size) {
+                    std::fprintf(stderr, "%s changed while packing\n", entry.source.c_str());
+                    return 1;
+                }
+            }
+            entry_offset += block.size;
+            batch.push_back(std::move(block));
+        }
+
+        std::atomic<u64> next{0};
+        auto worker = [&] {
+            for (u64 i; (i = next.fetch_add(1, std::memory_order_relaxed)) < batch.size();) {
+                CompressBlock(batch[i], options);
+            }
+        };
+        std::vector<std::thread> threads;
+        for (u32 t = 1; t < std::min<u64>(options.threads, batch.size()); ++t) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        for (const Block& block : batch) {
+            if (block.offset == 0) {
+                entries[block.entry].offset = out_offset;
+            }
+            std::fwrite(block.data.data(), 1, block.data.size(), out);
+            out_offset += block.data.size();
+            raw_bytes += block.size;
+            // A full-size raw block is stored as 0, block_size may not fit in size_bytes.
+            block_sizes.push_back(block.data.size() == block_size
+                                      ? 0
+                                      : static_cast<u32>(block.data.size()));
+        }
+    }
+    if (in != nullptr) {
+        std::fclose(in);
+    }
+    // Empty entries start where the next block would.
+    for (Entry& entry : entries) {
+        if (entry.size == 0) {
+            entry.offset = out_offset;
+        }
+    }
+
+    std::vector<u8> toc = {'P', 'S', 'A', 'R', 0, 1, 0, 4};
+    const char* compression = options.lzma ? "lzma" : "zlib";
+    toc.insert(toc.end(), compression, compression + 4);
+    PutBE(toc, toc_length, 4);
+    PutBE(toc, TOC_ENTRY_SIZE, 4);
+    PutBE(toc, entries.size(), 4);
+    PutBE(toc, block_size, 4);
+    PutBE(toc, options.flags, 4);
+    for (u32 i = 0; i < entries.size(); ++i) {
+        const Entry& entry = entries[i];
+        std::string hashed = entry.name;
+        if (options.flags & 1) {
+            std::transform(hashed.begin(), hashed.end(), hashed.begin(),
+                           [](char c) { return static_cast<char>(std::toupper(c)); });
+        }
+        const u128 digest = i == 0 ? u128{} : Md5::Digest(hashed);
+        const u8* digest_bytes = reinterpret_cast<const u8*>(digest.data());
+        toc.insert(toc.end(), digest_bytes, digest_bytes + 16);
+        PutBE(toc, entry.first_block, 4);
+        PutBE(toc, entry.size, 5);
+        PutBE(toc, entry.offset, 5);
+    }
+    for (u32 size : block_sizes) {
+        PutBE(toc, size, size_bytes);
+    }
+    std::fseek(out, 0, SEEK_SET);
+    std::fwrite(toc.data(), 1, toc.size(), out);
+    if (std::fclose(out) != 0) {
+        std::fprintf(stderr, "can't write %s\n", options.out.c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "%llu blocks, %.1f MB -> %.1f MB\n",
+                 static_cast<unsigned long long>(num_blocks), raw_bytes / 1e6, out_offset / 1e6);
+    return 0;
+}
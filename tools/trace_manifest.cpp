@@ -0,0 +1,115 @@
+// SPDX-FileCopyrightText: Copyright 2025 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Turns an access trace (config key trace_path, see src/trace.h) into a file-order manifest for
+// repacking: every file the game read, one per line, in the order of its first read. With a prefix
+// (usually an archive's mount point) only files under it are listed, relative to it, which is what
+// a PSARC manifest holds. A summary of each file's reads goes to stderr.
+//
+// Usage: trace_manifest <trace> [prefix] > manifest.txt
+// Host tool, built by make tools.
+
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace Fios2;
+
+struct FileAccess {
+    std::string path;
+    u64 first_time = UINT64_MAX;
+    u64 reads = 0;
+    u64 bytes = 0;
+    u64 end = 0; // furthest byte read
+};
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <trace> [prefix]\n", argv[0]);
+        return 2;
+    }
+    std::string_view prefix = argc > 2 ? argv[2] : "";
+    while (!prefix.empty() && prefix.back() == '/') {
+        prefix.remove_suffix(1);
+    }
+    FILE* f = std::fopen(argv[1], "rb");
+    if (f == nullptr) {
+        std::fprintf(stderr, "can't open %s\n", argv[1]);
+        return 1;
+    }
+    Trace::FileHeader header{};
+    if (std::fread(&header, sizeof(header), 1, f) != 1 || header.magic != Trace::MAGIC ||
+        header.version != Trace::VERSION) {
+        std::fprintf(stderr, "%s isn't a version %u access trace\n", argv[1], Trace::VERSION);
+        return 1;
+    }
+
+    // Paths and records can come in either order, so collect both first.
+    std::unordered_map<u32, std::string> paths;
+    std::vector<Trace::Record> records;
+    Trace::ChunkHeader chunk;
+    std::vector<u8> payload;
+    while (std::fread(&chunk, sizeof(chunk), 1, f) == 1) {
+        payload.resize(chunk.size);
+        if (std::fread(payload.data(), 1, chunk.size, f) != chunk.size) {
+            std::fprintf(stderr, "warning: trace is truncated\n");
+            break;
+        }
+        if (chunk.kind == Trace::ChunkKind::Path && chunk.size >= sizeof(u32)) {
+            u32 id;
+            std::copy_n(payload.data(), sizeof(id), reinterpret_cast<u8*>(&id));
+            paths[id].assign(payload.begin() + sizeof(id), payload.end());
+        } else if (chunk.kind == Trace::ChunkKind::Records && chunk.size >= sizeof(u32)) {
+            const u64 count = (chunk.size - sizeof(u32)) / sizeof(Trace::Record);
+            const u64 old_size = records.size();
+            records.resize(old_size + count);
+            std::copy_n(payload.data() + sizeof(u32), count * sizeof(Trace::Record),
+                        reinterpret_cast<u8*>(records.data() + old_size));
+        }
+    }
+    std::fclose(f);
+
+    std::unordered_map<u32, FileAccess> files;
+    for (const Trace::Record& record : records) {
+        FileAccess& file = files[record.path];
+        file.first_time = std::min(file.first_time, record.time);
+        file.reads += 1;
+        file.bytes += record.length;
+        file.end = std::max(file.end, record.offset + record.length);
+    }
+    std::vector<FileAccess> order;
+    for (auto& [id, file] : files) {
+        auto it = paths.find(id);
+        if (it == paths.end()) {
+            continue;
+        }
+        std::string_view path = it->second;
+        if (!prefix.empty()) {
+            if (path.compare(0, prefix.size(), prefix) != 0 || path.size() <= prefix.size() ||
+                path[prefix.size()] != '/') {
+                continue;
+            }
+            path.remove_prefix(prefix.size() + 1);
+        }
+        file.path = path;
+        order.push_back(std::move(file));
+    }
+    std::sort(order.begin(), order.end(), [](const FileAccess& a, const FileAccess& b) {
+        return a.first_time < b.first_time;
+    });
+
+    for (const FileAccess& file : order) {
+        std::printf("%s\n", file.path.c_str());
+        std::fprintf(stderr, "%10.3f ms %6llu reads %12llu bytes, up to %12llu  %s\n",
+                     file.first_time / 1e6, static_cast<unsigned long long>(file.reads),
+                     static_cast<unsigned long long>(file.bytes),
+                     static_cast<unsigned long long>(file.end), file.path.c_str());
+    }
+    std::fprintf(stderr, "%zu records, %zu files listed\n", records.size(), order.size());
+    return 0;
+}